@@ -0,0 +1,78 @@
+#include "DeltaEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+Serum_Rect ChangedRegion(const uint16_t* previous, const uint16_t* current,
+                         uint32_t width, uint32_t height) {
+  Serum_Rect rect = {};
+  uint32_t minX = width, maxX = 0, minY = height, maxY = 0;
+  for (uint32_t y = 0; y < height; y++) {
+    const uint16_t* before = previous + y * width;
+    const uint16_t* after = current + y * width;
+    if (memcmp(before, after, width * sizeof(uint16_t)) == 0) continue;
+    uint32_t left = 0;
+    while (before[left] == after[left]) left++;
+    uint32_t right = width - 1;
+    while (before[right] == after[right]) right--;
+    minX = std::min(minX, left);
+    maxX = std::max(maxX, right);
+    if (minY == height) minY = y;
+    maxY = y;
+  }
+  if (minY == height) return rect;
+  rect.x = (uint16_t)minX;
+  rect.y = (uint16_t)minY;
+  rect.width = (uint16_t)(maxX - minX + 1);
+  rect.height = (uint16_t)(maxY - minY + 1);
+  return rect;
+}
+
+void DeltaEncoder::Encode(const uint16_t* frame, uint32_t width,
+                          uint32_t height, bool bigEndianPixels) {
+  const uint32_t pixels = width * height;
+  if (m_previous.size() != pixels) {
+    m_previous.assign(pixels, 0);
+  }
+  m_stream.clear();
+  m_dirty = ChangedRegion(m_previous.data(), frame, width, height);
+  if (m_dirty.width == 0) return;
+
+  uint16_t* previous = m_previous.data();
+  uint32_t runEnd = 0;
+  uint32_t i = 0;
+  while (i < pixels) {
+    // Unchanged stretches are skipped 4 pixels at a time.
+    while (i + 4 <= pixels &&
+           memcmp(frame + i, previous + i, 4 * sizeof(uint16_t)) == 0) {
+      i += 4;
+    }
+    while (i < pixels && frame[i] == previous[i]) i++;
+    if (i == pixels) break;
+
+    const uint32_t start = i;
+    uint32_t last = i;
+    for (uint32_t j = i; j < pixels && j - last <= kMergeGap + 1; j++) {
+      if (frame[j] != previous[j]) last = j;
+    }
+    const uint32_t count = last - start + 1;
+    Put16((uint16_t)(start - runEnd));
+    Put16((uint16_t)count);
+    for (uint32_t j = start; j <= last; j++) {
+      if (bigEndianPixels) {
+        Put16BigEndian(frame[j]);
+      } else {
+        Put16(frame[j]);
+      }
+    }
+    memcpy(previous + start, frame + start, count * sizeof(uint16_t));
+    runEnd = last + 1;
+    i = runEnd;
+  }
+}
+
+void DeltaEncoder::Reset() {
+  std::vector<uint16_t>().swap(m_previous);
+  std::vector<uint8_t>().swap(m_stream);
+  m_dirty = {};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "serum.h"
+
+// Bounding rectangle of the pixels that differ between previous and current,
+// both width x height. The rectangle is empty if nothing changed.
+Serum_Rect ChangedRegion(const uint16_t* previous, const uint16_t* current,
+                         uint32_t width, uint32_t height);
+
+// Change stream of one RGB565 output plane against the previously encoded
+// frame of that plane, for display drivers on serial or USB links. The
+// stream is a sequence of runs in row-major pixel order:
+//
+//   uint16_t skip;             // unchanged pixels since the previous run
+//   uint16_t count;            // pixels in this run
+//   uint16_t pixels[count];    // their new RGB565 values
+//
+// skip and count are little-endian, the pixels too unless Encode() is asked
+// for big-endian ones. Runs separated by a gap short enough that a new run
+// header would cost more than resending the gap are merged. The first frame
+// after Reset() is encoded against a black plane.
+class DeltaEncoder {
+ public:
+  void Encode(const uint16_t* frame, uint32_t width, uint32_t height,
+              bool bigEndianPixels = false);
+  // Forgets the previous frame and frees the buffers.
+  void Reset();
+
+  const uint8_t* Stream() const {
+    return m_stream.empty() ? nullptr : m_stream.data();
+  }
+  uint32_t StreamSize() const { return (uint32_t)m_stream.size(); }
+  // Bounding rectangle of the changed pixels, empty if nothing changed.
+  Serum_Rect Dirty() const { return m_dirty; }
+
+ private:
+  // A gap of this many unchanged pixels costs as much as a run header.
+  static constexpr uint32_t kMergeGap = 2;
+
+  void Put16(uint16_t value) {
+    m_stream.push_back((uint8_t)value);
+    m_stream.push_back((uint8_t)(value >> 8));
+  }
+  void Put16BigEndian(uint16_t value) {
+    m_stream.push_back((uint8_t)(value >> 8));
+    m_stream.push_back((uint8_t)value);
+  }
+
+  std::vector<uint16_t> m_previous;
+  std::vector<uint8_t> m_stream;
+  Serum_Rect m_dirty = {};
+};
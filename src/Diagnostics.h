@@ -0,0 +1,14 @@
+#pragma once
+
+// Debug tracing and profiling switched on through the SERUM_DEBUG_* and
+// SERUM_PROFILE_* environment variables. Without SERUM_ENABLE_DIAGNOSTICS the
+// environment is never read: kSerumDiagnostics is false and the toggles
+// declared with SERUM_DIAGNOSTIC_STATE become constants, so every check on
+// them folds away and the hot paths carry no branches for them.
+#ifdef SERUM_ENABLE_DIAGNOSTICS
+inline constexpr bool kSerumDiagnostics = true;
+#define SERUM_DIAGNOSTIC_STATE static
+#else
+inline constexpr bool kSerumDiagnostics = false;
+#define SERUM_DIAGNOSTIC_STATE static constexpr
+#endif
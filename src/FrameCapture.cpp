@@ -0,0 +1,259 @@
+#include "FrameCapture.h"
+
+#include <cstring>
+
+#include "lz4/lz4.h"
+
+namespace {
+
+constexpr char kCaptureMagic[4] = {'S', 'C', 'A', 'P'};
+constexpr uint16_t kCaptureVersion = 1;
+// Blocks are flushed once they pass this size; a few hundred 128x32 frames
+// fit and compress well against each other.
+constexpr size_t kCaptureBlockSize = 256 * 1024;
+constexpr size_t kMaxCaptureBlockSize = 64 * 1024 * 1024;
+constexpr size_t kRecordResultOffset = 1 + sizeof(uint32_t);
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xff);
+  out.push_back(value >> 8);
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+uint16_t GetU16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+uint32_t GetU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+bool WriteU32(FILE* fp, uint32_t value) {
+  uint8_t bytes[4];
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = (value >> (8 * i)) & 0xff;
+  }
+  return fwrite(bytes, 1, 4, fp) == 4;
+}
+
+bool ReadU32(FILE* fp, uint32_t& value) {
+  uint8_t bytes[4];
+  if (fread(bytes, 1, 4, fp) != 4) {
+    return false;
+  }
+  value = GetU32(bytes);
+  return true;
+}
+
+}  // namespace
+
+bool FrameCapture::Start(const char* filename, uint32_t nowMs) {
+  Stop();
+  if (!filename) {
+    return false;
+  }
+  m_file = fopen(filename, "wb");
+  if (!m_file) {
+    return false;
+  }
+  uint8_t header[8];
+  memcpy(header, kCaptureMagic, 4);
+  header[4] = kCaptureVersion & 0xff;
+  header[5] = kCaptureVersion >> 8;
+  header[6] = 0;
+  header[7] = 0;
+  if (fwrite(header, 1, sizeof(header), m_file) != sizeof(header)) {
+    fclose(m_file);
+    m_file = nullptr;
+    return false;
+  }
+  m_startMs = nowMs;
+  m_block.clear();
+  m_block.reserve(kCaptureBlockSize + 64 * 1024);
+  m_pending = false;
+  return true;
+}
+
+void FrameCapture::Stop() {
+  if (!m_file) {
+    return;
+  }
+  FlushBlock();
+  fclose(m_file);
+  m_file = nullptr;
+  m_pending = false;
+}
+
+void FrameCapture::Begin(CaptureRecordType type, uint32_t nowMs) {
+  m_pendingOffset = m_block.size();
+  m_pending = true;
+  m_block.push_back(static_cast<uint8_t>(type));
+  PutU32(m_block, nowMs - m_startMs);
+  PutU32(m_block, 0);
+}
+
+void FrameCapture::BeginColorize(const uint8_t* frame, uint16_t width,
+                                 uint16_t height, uint32_t nowMs) {
+  Begin(CaptureRecordType::Colorize, nowMs);
+  PutU16(m_block, width);
+  PutU16(m_block, height);
+  const size_t pixels = static_cast<size_t>(width) * height;
+  if (frame) {
+    m_block.insert(m_block.end(), frame, frame + pixels);
+  } else {
+    m_block.resize(m_block.size() + pixels, 0);
+  }
+}
+
+void FrameCapture::BeginRotate(uint32_t nowMs) {
+  Begin(CaptureRecordType::Rotate, nowMs);
+}
+
+void FrameCapture::BeginSceneTrigger(uint16_t sceneId, uint32_t nowMs) {
+  Begin(CaptureRecordType::SceneTrigger, nowMs);
+  PutU16(m_block, sceneId);
+}
+
+void FrameCapture::Commit(uint32_t result) {
+  if (!m_file || !m_pending) {
+    return;
+  }
+  for (int i = 0; i < 4; ++i) {
+    m_block[m_pendingOffset + kRecordResultOffset + i] =
+        (result >> (8 * i)) & 0xff;
+  }
+  m_pending = false;
+  if (m_block.size() >= kCaptureBlockSize && !FlushBlock()) {
+    Stop();
+  }
+}
+
+bool FrameCapture::FlushBlock() {
+  if (m_block.empty()) {
+    return true;
+  }
+  std::vector<char> compressed(LZ4_compressBound((int)m_block.size()));
+  const int compressedSize =
+      LZ4_compress_default(reinterpret_cast<const char*>(m_block.data()),
+                           compressed.data(), (int)m_block.size(),
+                           (int)compressed.size());
+  const bool ok =
+      compressedSize > 0 && WriteU32(m_file, (uint32_t)m_block.size()) &&
+      WriteU32(m_file, (uint32_t)compressedSize) &&
+      fwrite(compressed.data(), 1, compressedSize, m_file) ==
+          (size_t)compressedSize;
+  fflush(m_file);
+  m_block.clear();
+  return ok;
+}
+
+CaptureReader::~CaptureReader() {
+  if (m_file) {
+    fclose(m_file);
+  }
+}
+
+bool CaptureReader::Open(const char* filename) {
+  m_file = fopen(filename, "rb");
+  if (!m_file) {
+    return false;
+  }
+  uint8_t header[8];
+  if (fread(header, 1, sizeof(header), m_file) != sizeof(header) ||
+      memcmp(header, kCaptureMagic, 4) != 0 ||
+      GetU16(header + 4) > kCaptureVersion) {
+    fclose(m_file);
+    m_file = nullptr;
+    return false;
+  }
+  m_block.clear();
+  m_offset = 0;
+  m_error = false;
+  return true;
+}
+
+bool CaptureReader::LoadBlock() {
+  uint32_t rawSize = 0;
+  uint32_t compressedSize = 0;
+  if (!ReadU32(m_file, rawSize)) {
+    return false;  // clean end of file
+  }
+  if (!ReadU32(m_file, compressedSize) || rawSize == 0 ||
+      rawSize > kMaxCaptureBlockSize ||
+      compressedSize > (uint32_t)LZ4_compressBound((int)rawSize)) {
+    m_error = true;
+    return false;
+  }
+  std::vector<char> compressed(compressedSize);
+  if (fread(compressed.data(), 1, compressedSize, m_file) != compressedSize) {
+    m_error = true;
+    return false;
+  }
+  m_block.resize(rawSize);
+  if (LZ4_decompress_safe(compressed.data(),
+                          reinterpret_cast<char*>(m_block.data()),
+                          (int)compressedSize, (int)rawSize) != (int)rawSize) {
+    m_error = true;
+    return false;
+  }
+  m_offset = 0;
+  return true;
+}
+
+bool CaptureReader::Next(CaptureRecord& record) {
+  if (!m_file || m_error) {
+    return false;
+  }
+  if (m_offset >= m_block.size() && !LoadBlock()) {
+    return false;
+  }
+  const size_t headerSize = 1 + 2 * sizeof(uint32_t);
+  if (m_block.size() - m_offset < headerSize) {
+    m_error = true;
+    return false;
+  }
+  const uint8_t* p = m_block.data() + m_offset;
+  record.type = static_cast<CaptureRecordType>(p[0]);
+  record.timestampMs = GetU32(p + 1);
+  record.result = GetU32(p + kRecordResultOffset);
+  m_offset += headerSize;
+  p += headerSize;
+  const size_t remaining = m_block.size() - m_offset;
+
+  switch (record.type) {
+    case CaptureRecordType::Colorize: {
+      if (remaining < 4) {
+        m_error = true;
+        return false;
+      }
+      record.width = GetU16(p);
+      record.height = GetU16(p + 2);
+      const size_t pixels = static_cast<size_t>(record.width) * record.height;
+      if (remaining - 4 < pixels) {
+        m_error = true;
+        return false;
+      }
+      record.frame.assign(p + 4, p + 4 + pixels);
+      m_offset += 4 + pixels;
+      break;
+    }
+    case CaptureRecordType::Rotate:
+      break;
+    case CaptureRecordType::SceneTrigger:
+      if (remaining < 2) {
+        m_error = true;
+        return false;
+      }
+      record.sceneId = GetU16(p);
+      m_offset += 2;
+      break;
+    default:
+      m_error = true;
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Capture files record the API call stream of a session so serum_replay can
+// play it back against a cROMc:
+//
+//   "SCAP", uint16 version, uint16 reserved
+//   blocks of: uint32 raw size, uint32 compressed size, LZ4 block
+//
+// Blocks hold whole records: uint8 type, uint32 timestamp (ms since capture
+// start), uint32 return value and a type specific payload (Colorize: uint16
+// width, uint16 height, width * height pixels, 256x64 for files made for
+// 256x64 ROMs; SceneTrigger: uint16 scene id). All integers are little
+// endian.
+
+enum class CaptureRecordType : uint8_t {
+  Colorize = 1,
+  Rotate = 2,
+  SceneTrigger = 3,
+};
+
+struct CaptureRecord {
+  CaptureRecordType type = CaptureRecordType::Colorize;
+  uint32_t timestampMs = 0;
+  uint32_t result = 0;
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint16_t sceneId = 0;
+  std::vector<uint8_t> frame;
+};
+
+class FrameCapture {
+ public:
+  ~FrameCapture() { Stop(); }
+
+  bool Start(const char* filename, uint32_t nowMs);
+  void Stop();
+  bool IsActive() const { return m_file != nullptr; }
+
+  // Begin* appends a record before the call runs, Commit() fills in the
+  // return value once it is known.
+  void BeginColorize(const uint8_t* frame, uint16_t width, uint16_t height,
+                     uint32_t nowMs);
+  void BeginRotate(uint32_t nowMs);
+  void BeginSceneTrigger(uint16_t sceneId, uint32_t nowMs);
+  void Commit(uint32_t result);
+
+ private:
+  void Begin(CaptureRecordType type, uint32_t nowMs);
+  bool FlushBlock();
+
+  FILE* m_file = nullptr;
+  uint32_t m_startMs = 0;
+  std::vector<uint8_t> m_block;
+  size_t m_pendingOffset = 0;
+  bool m_pending = false;
+};
+
+class CaptureReader {
+ public:
+  ~CaptureReader();
+
+  bool Open(const char* filename);
+  // Returns false at the end of the capture or on a damaged file.
+  bool Next(CaptureRecord& record);
+  bool HasError() const { return m_error; }
+
+ private:
+  bool LoadBlock();
+
+  FILE* m_file = nullptr;
+  std::vector<uint8_t> m_block;
+  size_t m_offset = 0;
+  bool m_error = false;
+};
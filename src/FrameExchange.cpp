@@ -0,0 +1,96 @@
+#include "FrameExchange.h"
+
+namespace {
+
+// Copies count elements of src into dst, reusing its storage. Returns the
+// copy, or nullptr if there is nothing to copy.
+template <typename T>
+T* CopyBuffer(std::vector<T>& dst, const T* src, size_t count) {
+  if (!src || count == 0) {
+    return nullptr;
+  }
+  dst.assign(src, src + count);
+  return dst.data();
+}
+
+}  // namespace
+
+void FrameExchange::SetEnabled(bool enabled) {
+  if (enabled == IsEnabled()) {
+    return;
+  }
+  if (!enabled) {
+    Clear();
+  }
+  m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void FrameExchange::Publish(const Serum_Frame_Struc& frame,
+                            uint32_t v1FramePixels, uint32_t outputBytes32,
+                            uint32_t outputBytes64) {
+  Slot& slot = m_slots[m_back];
+  const size_t pixels32 = 32 * (size_t)frame.width32;
+  const size_t pixels64 = 64 * (size_t)frame.width64;
+  const size_t rotationColors =
+      MAX_COLOR_ROTATION_V2 * MAX_LENGTH_COLOR_ROTATION;
+
+  slot.frame = frame;
+  slot.frame.frame = CopyBuffer(slot.v1Frame, frame.frame, v1FramePixels);
+  slot.frame.palette = CopyBuffer(slot.palette, frame.palette, PALETTE_SIZE);
+  slot.frame.rotations =
+      CopyBuffer(slot.rotations, frame.rotations, ROTATION_SIZE);
+  slot.frame.frame32 = CopyBuffer(slot.frame32, frame.frame32, pixels32);
+  slot.frame.rotations32 =
+      CopyBuffer(slot.rotations32, frame.rotations32, rotationColors);
+  slot.frame.rotationsinframe32 = CopyBuffer(
+      slot.rotationsinframe32, frame.rotationsinframe32, 2 * pixels32);
+  slot.frame.modifiedelements32 = CopyBuffer(
+      slot.modifiedelements32, frame.modifiedelements32, pixels32);
+  slot.frame.frame64 = CopyBuffer(slot.frame64, frame.frame64, pixels64);
+  slot.frame.rotations64 =
+      CopyBuffer(slot.rotations64, frame.rotations64, rotationColors);
+  slot.frame.rotationsinframe64 = CopyBuffer(
+      slot.rotationsinframe64, frame.rotationsinframe64, 2 * pixels64);
+  slot.frame.modifiedelements64 = CopyBuffer(
+      slot.modifiedelements64, frame.modifiedelements64, pixels64);
+  slot.frame.output32 =
+      CopyBuffer(slot.output32, frame.output32, outputBytes32);
+  slot.frame.output64 =
+      CopyBuffer(slot.output64, frame.output64, outputBytes64);
+  slot.frame.index32 = CopyBuffer(slot.index32, frame.index32, pixels32);
+  slot.frame.palette32 =
+      CopyBuffer(slot.palette32, frame.palette32, frame.palettesize32);
+  slot.frame.index64 = CopyBuffer(slot.index64, frame.index64, pixels64);
+  slot.frame.palette64 =
+      CopyBuffer(slot.palette64, frame.palette64, frame.palettesize64);
+  // Deltas only apply on top of every previous frame, which a reader that
+  // skips frames doesn't have.
+  slot.frame.delta32 = slot.frame.delta64 = nullptr;
+  slot.frame.deltasize32 = slot.frame.deltasize64 = 0;
+  slot.valid = true;
+  PublishBack();
+}
+
+void FrameExchange::Clear() {
+  m_slots[m_back].valid = false;
+  PublishBack();
+}
+
+void FrameExchange::PublishBack() {
+  // Release makes the slot contents visible to the reader's acquire below,
+  // acquire hands the writer a slot the reader is done with.
+  m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) &
+           kIndexMask;
+}
+
+const Serum_Frame_Struc* FrameExchange::Acquire() {
+  if (!m_held && (m_middle.load(std::memory_order_relaxed) & kFresh)) {
+    m_front =
+        m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+  }
+  m_held = true;
+  const Slot& slot = m_slots[m_front];
+  return slot.valid ? &slot.frame : nullptr;
+}
+
+void FrameExchange::Release() { m_held = false; }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "serum.h"
+
+// Triple-buffered copy of the output planes for hosts that display on a
+// separate render thread. The API thread copies every new output into the
+// back slot and publishes it by swapping the slot index with the shared
+// middle index; the render thread swaps the middle slot into its front slot
+// when a newer frame is there. Neither side ever waits for the other, and
+// the writer never touches the slot the reader holds.
+//
+// Publish(), Clear() and SetEnabled() run on the API thread with the API
+// mutex held. Acquire() and Release() don't take any lock and must only be
+// called from one reader thread.
+class FrameExchange {
+ public:
+  // Disabling publishes "no frame"; the slot buffers are kept, so a frame
+  // the reader still holds stays readable.
+  void SetEnabled(bool enabled);
+  bool IsEnabled() const {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  // Copies the output buffers of frame into the back slot and makes it the
+  // latest frame. v1FramePixels is the size of frame.frame (0 if unused),
+  // outputBytes32/64 the sizes of frame.output32/64.
+  void Publish(const Serum_Frame_Struc& frame, uint32_t v1FramePixels,
+               uint32_t outputBytes32, uint32_t outputBytes64);
+  // Publishes "no frame", e.g. when the Serum file is disposed.
+  void Clear();
+
+  // Latest published frame, nullptr if there is none. The returned structure
+  // and its buffers stay unchanged until Release(); acquiring again before
+  // that returns the same frame.
+  const Serum_Frame_Struc* Acquire();
+  void Release();
+
+ private:
+  struct Slot {
+    bool valid = false;
+    Serum_Frame_Struc frame = {};
+    std::vector<uint8_t> v1Frame;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> rotations;
+    std::vector<uint16_t> frame32;
+    std::vector<uint16_t> rotations32;
+    std::vector<uint16_t> rotationsinframe32;
+    std::vector<uint8_t> modifiedelements32;
+    std::vector<uint16_t> frame64;
+    std::vector<uint16_t> rotations64;
+    std::vector<uint16_t> rotationsinframe64;
+    std::vector<uint8_t> modifiedelements64;
+    std::vector<uint8_t> output32;
+    std::vector<uint8_t> output64;
+    std::vector<uint8_t> index32;
+    std::vector<uint16_t> palette32;
+    std::vector<uint8_t> index64;
+    std::vector<uint16_t> palette64;
+  };
+
+  // Set in m_middle when the writer published a slot the reader hasn't
+  // picked up yet.
+  static constexpr uint8_t kFresh = 4;
+  static constexpr uint8_t kIndexMask = 3;
+
+  void PublishBack();
+
+  std::atomic<bool> m_enabled{false};
+  Slot m_slots[3];
+  uint8_t m_back = 0;  // writer only
+  std::atomic<uint8_t> m_middle{1};
+  uint8_t m_front = 2;  // reader only
+  bool m_held = false;  // reader only
+};
@@ -0,0 +1,90 @@
+#include "FrameQueue.h"
+
+#include <cstring>
+
+#include "WorkerLock.h"
+
+bool FrameQueue::Start(uint32_t framePixels, bool coalesce) {
+  if (framePixels == 0 || framePixels > kMaxFramePixels) {
+    return false;
+  }
+  Stop();
+  m_coalesce = coalesce;
+  m_framePixels.store(framePixels, std::memory_order_relaxed);
+  m_head.store(0, std::memory_order_relaxed);
+  m_tail.store(0, std::memory_order_relaxed);
+  m_processed = 0;
+  m_coalesced = 0;
+  m_dropped.store(0, std::memory_order_relaxed);
+  m_stop.store(false, std::memory_order_relaxed);
+  m_thread = std::thread(&FrameQueue::WorkerLoop, this);
+  m_running.store(true, std::memory_order_release);
+  return true;
+}
+
+void FrameQueue::Stop() {
+  // Sequentially consistent with Submit(): either it sees the queue stopped
+  // or this sees it submitting.
+  m_running.store(false);
+  while (m_submitting.load() != 0) {
+    std::this_thread::yield();
+  }
+  if (!m_thread.joinable()) {
+    return;
+  }
+  m_stop.store(true, std::memory_order_relaxed);
+  m_signal.fetch_add(1, std::memory_order_release);
+  m_signal.notify_one();
+  m_thread.join();
+}
+
+bool FrameQueue::Submit(const uint8_t* frame, uint32_t timestampMs) {
+  m_submitting.fetch_add(1);
+  const bool submitted = m_running.load() && Enqueue(frame, timestampMs);
+  m_submitting.fetch_sub(1, std::memory_order_release);
+  return submitted;
+}
+
+bool FrameQueue::Enqueue(const uint8_t* frame, uint32_t timestampMs) {
+  const uint32_t head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) >= kSlots) {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Slot& slot = m_slots[head % kSlots];
+  slot.timestampMs = timestampMs;
+  memcpy(slot.frame, frame, m_framePixels.load(std::memory_order_relaxed));
+  m_head.store(head + 1, std::memory_order_release);
+  m_signal.fetch_add(1, std::memory_order_release);
+  m_signal.notify_one();
+  return true;
+}
+
+void FrameQueue::WorkerLoop() {
+  uint32_t tail = m_tail.load(std::memory_order_relaxed);
+  while (true) {
+    const uint32_t signal = m_signal.load(std::memory_order_acquire);
+    if (m_stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    const uint32_t head = m_head.load(std::memory_order_acquire);
+    if (head == tail) {
+      m_signal.wait(signal, std::memory_order_acquire);
+      continue;
+    }
+    auto api = TryLockWorker(m_apiMutex);
+    if (!api.owns_lock()) {
+      continue;
+    }
+    if (m_coalesce && head - tail > 1) {
+      // Hand the skipped slots back to the producer right away.
+      m_coalesced += head - tail - 1;
+      tail = head - 1;
+      m_tail.store(tail, std::memory_order_release);
+    }
+    Slot& slot = m_slots[tail % kSlots];
+    m_process(slot.frame, slot.timestampMs);
+    ++m_processed;
+    m_tail.store(++tail, std::memory_order_release);
+  }
+}
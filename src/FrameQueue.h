@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Bounded single-producer/single-consumer ring of input frames for
+// Serum_SubmitFrame(). The host's capture thread only copies the frame into
+// a free slot and bumps the head index; a worker thread takes the API mutex
+// and runs the colorization pipeline on it.
+//
+// The worker takes the API mutex as described in WorkerLock.h.
+// Start() and Stop() run on the API thread with the mutex held, Submit() on
+// one producer thread without it. Stop() waits for a Submit() in progress
+// to finish, so the host may keep submitting while the queue is restarted;
+// those frames are rejected.
+class FrameQueue {
+ public:
+  static constexpr uint32_t kSlots = 8;
+  static constexpr uint32_t kMaxFramePixels = 256 * 64;
+
+  // Called on the worker thread with the API mutex held.
+  using ProcessFunction =
+      std::function<void(uint8_t* frame, uint32_t timestampMs)>;
+
+  FrameQueue(std::recursive_mutex& apiMutex, ProcessFunction process)
+      : m_apiMutex(apiMutex), m_process(std::move(process)) {}
+  ~FrameQueue() { Stop(); }
+
+  // Starts the worker for frames of framePixels bytes. With coalesce, the
+  // worker skips every queued frame that already has a newer one behind it.
+  bool Start(uint32_t framePixels, bool coalesce);
+  // Finishes the worker; frames still queued are discarded.
+  void Stop();
+  bool IsRunning() const { return m_thread.joinable(); }
+
+  // Returns false if the queue isn't running or is full.
+  bool Submit(const uint8_t* frame, uint32_t timestampMs);
+
+  uint64_t ProcessedFrames() const { return m_processed; }
+  uint64_t CoalescedFrames() const { return m_coalesced; }
+  uint64_t DroppedFrames() const {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    uint32_t timestampMs = 0;
+    uint8_t frame[kMaxFramePixels];
+  };
+
+  bool Enqueue(const uint8_t* frame, uint32_t timestampMs);
+  void WorkerLoop();
+
+  std::recursive_mutex& m_apiMutex;
+  ProcessFunction m_process;
+  std::thread m_thread;
+  bool m_coalesce = false;
+
+  std::atomic<bool> m_running{false};
+  // Submit() calls in progress; Stop() waits for them before Start() may
+  // reset the indices.
+  std::atomic<uint32_t> m_submitting{0};
+  std::atomic<bool> m_stop{false};
+  std::atomic<uint32_t> m_framePixels{0};
+  // Free-running indices, the slot is index % kSlots. m_head is written by
+  // the producer, m_tail by the worker.
+  std::atomic<uint32_t> m_head{0};
+  std::atomic<uint32_t> m_tail{0};
+  // Bumped by Submit() and Stop(); the idle worker waits on it.
+  std::atomic<uint32_t> m_signal{0};
+  Slot m_slots[kSlots];
+
+  // Worker only, read after Stop().
+  uint64_t m_processed = 0;
+  uint64_t m_coalesced = 0;
+  std::atomic<uint64_t> m_dropped{0};
+};
@@ -0,0 +1,111 @@
+#include "GeometryKernels.h"
+
+namespace {
+
+// A zero template size selects the runtime size.
+template <uint32_t kPixels>
+inline uint32_t PixelCount(uint32_t pixels) {
+  return kPixels ? kPixels : pixels;
+}
+
+template <uint32_t kPixels, bool kShape>
+uint32_t Crc32(const uint32_t* table, const uint8_t* source, uint32_t pixels) {
+  const uint32_t n = PixelCount<kPixels>(pixels);
+  uint32_t crc = 0xffffffff;
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t val = source[i];
+    if (kShape && val > 1) val = 1;
+    crc = (crc >> 8) ^ table[(val ^ crc) & 0xFF];
+  }
+  return ~crc;
+}
+
+template <uint32_t kPixels, bool kShape>
+uint32_t Crc32Mask(const uint32_t* table, const uint8_t* source,
+                   const uint8_t* mask, uint32_t pixels) {
+  const uint32_t n = PixelCount<kPixels>(pixels);
+  uint32_t crc = 0xffffffff;
+  for (uint32_t i = 0; i < n; i++) {
+    if (mask[i] != 0) continue;
+    uint8_t val = source[i];
+    if (kShape && val > 1) val = 1;
+    crc = (crc >> 8) ^ table[(val ^ crc) & 0xFF];
+  }
+  return ~crc;
+}
+
+template <uint32_t kWidth, uint32_t kHeight>
+void CollectRowDwords(const uint8_t* frame, uint32_t width, uint32_t height,
+                      std::unordered_set<uint32_t>& dwords) {
+  const uint32_t w = kWidth ? kWidth : width;
+  const uint32_t h = kHeight ? kHeight : height;
+  if (w < 4) {
+    return;
+  }
+  for (uint32_t y = 0; y < h; ++y) {
+    const uint8_t* row = frame + y * w;
+    uint32_t dword = (uint32_t)(row[0] << 8) | (uint32_t)(row[1] << 16) |
+                     (uint32_t)(row[2] << 24);
+    for (uint32_t x = 0; x <= w - 4; ++x) {
+      dword = (dword >> 8) | (uint32_t)(row[x + 3] << 24);
+      dwords.insert(dword);
+    }
+  }
+}
+
+template <uint32_t kPixels>
+void ApplyRotation(uint16_t* frame, const uint16_t* rotationsInFrame,
+                   uint8_t* modified, uint16_t slot, const uint16_t* rotation,
+                   uint32_t shift, uint32_t pixels) {
+  const uint32_t n = PixelCount<kPixels>(pixels);
+  const uint32_t length = rotation[0];
+  const uint16_t* colors = rotation + 2;
+  if (modified) {
+    for (uint32_t i = 0; i < n; i++) {
+      if (rotationsInFrame[i * 2] == slot) {
+        frame[i] = colors[(rotationsInFrame[i * 2 + 1] + shift) % length];
+        modified[i] = 1;
+      }
+    }
+  } else {
+    for (uint32_t i = 0; i < n; i++) {
+      if (rotationsInFrame[i * 2] == slot) {
+        frame[i] = colors[(rotationsInFrame[i * 2 + 1] + shift) % length];
+      }
+    }
+  }
+}
+
+template <uint32_t kWidth, uint32_t kHeight>
+constexpr GeometryKernels MakeKernels() {
+  constexpr uint32_t kPixels = kWidth * kHeight;
+  return {kWidth,
+          kHeight,
+          &Crc32<kPixels, false>,
+          &Crc32<kPixels, true>,
+          &Crc32Mask<kPixels, false>,
+          &Crc32Mask<kPixels, true>,
+          &CollectRowDwords<kWidth, kHeight>,
+          &ApplyRotation<kPixels>};
+}
+
+constexpr GeometryKernels kGenericKernels = MakeKernels<0, 0>();
+constexpr GeometryKernels kSpecializedKernels[] = {
+    MakeKernels<128, 32>(),
+    MakeKernels<128, 16>(),
+    MakeKernels<192, 64>(),
+    MakeKernels<256, 64>(),
+};
+
+}  // namespace
+
+const GeometryKernels& GenericGeometryKernels() { return kGenericKernels; }
+
+const GeometryKernels& SelectGeometryKernels(uint32_t width, uint32_t height) {
+  for (const GeometryKernels& kernels : kSpecializedKernels) {
+    if (kernels.width == width && kernels.height == height) {
+      return kernels;
+    }
+  }
+  return kGenericKernels;
+}
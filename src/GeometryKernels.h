@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+
+// Per-pixel kernels of the identify, sprite and rotation hot paths, built
+// once per common DMD geometry (128x32, 128x16, 192x64 and 256x64) so their
+// loops run with compile-time trip counts the compiler can unroll and
+// vectorize. SelectGeometryKernels() is called once at load; any other size
+// gets the generic table, whose kernels take the size at runtime.
+//
+// All kernels ignore their runtime size arguments when the table is
+// specialized, so callers must only use a table for the geometry it was
+// selected for.
+struct GeometryKernels {
+  // Geometry the table is specialized for, 0x0 for the generic table.
+  uint32_t width;
+  uint32_t height;
+
+  // CRC32 of a frame using the caller's table. The shape variants reduce
+  // pixels to 0/1 first, the mask variants skip pixels where mask != 0.
+  uint32_t (*crc32)(const uint32_t* table, const uint8_t* source,
+                    uint32_t pixels);
+  uint32_t (*crc32Shape)(const uint32_t* table, const uint8_t* source,
+                         uint32_t pixels);
+  uint32_t (*crc32Mask)(const uint32_t* table, const uint8_t* source,
+                        const uint8_t* mask, uint32_t pixels);
+  uint32_t (*crc32MaskShape)(const uint32_t* table, const uint8_t* source,
+                             const uint8_t* mask, uint32_t pixels);
+
+  // Inserts every 4-pixel horizontal run of the frame, packed little-endian
+  // into a dword, into dwords.
+  void (*collectRowDwords)(const uint8_t* frame, uint32_t width,
+                           uint32_t height,
+                           std::unordered_set<uint32_t>& dwords);
+
+  // Advances one color rotation on an output plane: every pixel whose
+  // rotationsInFrame slot is `slot` gets the rotation color at its position
+  // plus shift, and is flagged in modified (if not null).
+  void (*applyRotation)(uint16_t* frame, const uint16_t* rotationsInFrame,
+                        uint8_t* modified, uint16_t slot,
+                        const uint16_t* rotation, uint32_t shift,
+                        uint32_t pixels);
+};
+
+const GeometryKernels& GenericGeometryKernels();
+const GeometryKernels& SelectGeometryKernels(uint32_t width, uint32_t height);
@@ -0,0 +1,95 @@
+#include "IndexedOutput.h"
+
+#include <algorithm>
+#include <cstring>
+
+void IndexedOutput::NextStamp() {
+  if (m_colorStamps.empty()) {
+    m_colorStamps.assign(0x10000, 0);
+    m_colorIndexes.assign(0x10000, 0);
+    m_rotationStamps.assign(kRotationEntries, 0);
+    m_rotationIndexes.assign(kRotationEntries, 0);
+  }
+  if (++m_stamp == 0) {
+    std::fill(m_colorStamps.begin(), m_colorStamps.end(), 0);
+    std::fill(m_rotationStamps.begin(), m_rotationStamps.end(), 0);
+    m_stamp = 1;
+  }
+}
+
+void IndexedOutput::Build(const uint16_t* frame,
+                          const uint16_t* rotationsInFrame, uint32_t pixels,
+                          const uint32_t* shifts) {
+  NextStamp();
+  m_built = true;
+  m_paletteSize = 0;
+  m_rotationEntries.clear();
+  memcpy(m_shifts, shifts, sizeof(m_shifts));
+  m_index.resize(pixels);
+
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < pixels; i++) {
+    const uint16_t color = frame[i];
+    const uint16_t rotation =
+        rotationsInFrame ? rotationsInFrame[i * 2] : 0xffff;
+    if (rotation == 0xffff) {
+      int index = Lookup(m_colorStamps, m_colorIndexes, color);
+      if (index < 0) {
+        if (size == kMaxPaletteSize) return;
+        index = (int)size;
+        m_palette[size++] = color;
+        m_colorStamps[color] = m_stamp;
+        m_colorIndexes[color] = (uint8_t)index;
+      }
+      m_index[i] = (uint8_t)index;
+      continue;
+    }
+
+    const uint16_t position = rotationsInFrame[i * 2 + 1];
+    if (rotation >= MAX_COLOR_ROTATION_V2 ||
+        position >= MAX_LENGTH_COLOR_ROTATION) {
+      return;
+    }
+    const uint32_t key = rotation * MAX_LENGTH_COLOR_ROTATION + position;
+    int index = Lookup(m_rotationStamps, m_rotationIndexes, key);
+    if (index < 0) {
+      if (size == kMaxPaletteSize) return;
+      index = (int)size;
+      m_palette[size++] = color;
+      m_rotationStamps[key] = m_stamp;
+      m_rotationIndexes[key] = (uint8_t)index;
+      m_rotationEntries.push_back(
+          {(uint8_t)index, (uint8_t)rotation, (uint8_t)position});
+    } else if (m_palette[index] != color) {
+      // Pixels of one rotation position that differ can't share an entry.
+      return;
+    }
+    m_index[i] = (uint8_t)index;
+  }
+  m_paletteSize = size;
+}
+
+void IndexedOutput::UpdateRotations(const uint16_t* rotations,
+                                    const uint32_t* shifts) {
+  if (m_paletteSize == 0) {
+    return;
+  }
+  for (const RotationEntry& entry : m_rotationEntries) {
+    if (shifts[entry.rotation] == m_shifts[entry.rotation]) continue;
+    // Same color Serum_ApplyRotationsv2() gives the pixels of the entry.
+    const uint16_t* rotation =
+        rotations + entry.rotation * MAX_LENGTH_COLOR_ROTATION;
+    const uint32_t length = rotation[0];
+    if (length == 0) continue;
+    m_palette[entry.paletteIndex] =
+        rotation[2 + (entry.position + shifts[entry.rotation]) % length];
+  }
+  memcpy(m_shifts, shifts, sizeof(m_shifts));
+}
+
+void IndexedOutput::Reset() {
+  m_built = false;
+  m_paletteSize = 0;
+  std::vector<uint8_t>().swap(m_index);
+  std::vector<RotationEntry>().swap(m_rotationEntries);
+}
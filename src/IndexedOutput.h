@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "serum.h"
+
+// 8-bit indexed copy of one RGB565 output plane for hosts that send frames
+// over bandwidth-bound links. Every distinct static color gets one palette
+// entry, and so does every (rotation, position) pair of the rotating pixels:
+// those pixels always share their color, so a rotation tick only rewrites
+// their palette entries and leaves the index plane untouched.
+//
+// A plane that needs more than 256 entries has no indexed copy; PaletteSize()
+// is 0 until the next Build() that fits.
+class IndexedOutput {
+ public:
+  static constexpr uint32_t kMaxPaletteSize = 256;
+
+  // Rebuilds the index plane and palette of a new output frame. shifts are
+  // the current shifts of the MAX_COLOR_ROTATION_V2 rotations of the plane.
+  void Build(const uint16_t* frame, const uint16_t* rotationsInFrame,
+             uint32_t pixels, const uint32_t* shifts);
+  // Updates the palette entries of the rotations whose shift changed since
+  // the last Build() or UpdateRotations(). rotations is the plane's
+  // MAX_COLOR_ROTATION_V2 * MAX_LENGTH_COLOR_ROTATION rotation table.
+  void UpdateRotations(const uint16_t* rotations, const uint32_t* shifts);
+  // Frees the buffers.
+  void Reset();
+
+  bool HasFrame() const { return m_built; }
+  uint8_t* Index() { return m_paletteSize ? m_index.data() : nullptr; }
+  uint16_t* Palette() { return m_paletteSize ? m_palette : nullptr; }
+  uint32_t PaletteSize() const { return m_paletteSize; }
+
+ private:
+  static constexpr uint32_t kRotationEntries =
+      MAX_COLOR_ROTATION_V2 * MAX_LENGTH_COLOR_ROTATION;
+
+  struct RotationEntry {
+    uint8_t paletteIndex;
+    uint8_t rotation;
+    uint8_t position;
+  };
+
+  // Palette index of color / rotation entry if it was assigned in the
+  // current build, else -1.
+  int Lookup(const std::vector<uint32_t>& stamps,
+             const std::vector<uint8_t>& indexes, uint32_t key) const {
+    return stamps[key] == m_stamp ? indexes[key] : -1;
+  }
+  void NextStamp();
+
+  bool m_built = false;
+  std::vector<uint8_t> m_index;
+  uint16_t m_palette[kMaxPaletteSize] = {};
+  uint32_t m_paletteSize = 0;
+  std::vector<RotationEntry> m_rotationEntries;
+  uint32_t m_shifts[MAX_COLOR_ROTATION_V2] = {};
+
+  // Build stamps instead of clearing the lookup tables for every frame.
+  uint32_t m_stamp = 0;
+  std::vector<uint32_t> m_colorStamps;
+  std::vector<uint8_t> m_colorIndexes;
+  std::vector<uint32_t> m_rotationStamps;
+  std::vector<uint8_t> m_rotationIndexes;
+};
@@ -0,0 +1,82 @@
+#include "PerfCounters.h"
+
+#include <bit>
+#include <cstring>
+
+void PerfCounters::Record(uint32_t stage, uint64_t elapsedNs) {
+  if (stage >= SERUM_PERF_STAGE_COUNT) {
+    return;
+  }
+  Stage& s = m_stages[stage];
+  ++s.calls;
+  s.totalNs += elapsedNs;
+  if (elapsedNs > s.maxNs) {
+    s.maxNs = elapsedNs;
+  }
+  uint32_t bucket =
+      elapsedNs == 0 ? 0 : static_cast<uint32_t>(std::bit_width(elapsedNs)) - 1;
+  if (bucket >= SERUM_PERF_HISTOGRAM_BUCKETS) {
+    bucket = SERUM_PERF_HISTOGRAM_BUCKETS - 1;
+  }
+  ++s.histogram[bucket];
+}
+
+void PerfCounters::Reset() {
+  for (Stage& stage : m_stages) {
+    stage = Stage{};
+  }
+  inputFrames = 0;
+  sameFrameReturns = 0;
+  noFrameReturns = 0;
+}
+
+uint64_t PerfCounters::EstimatePercentile(const Stage& stage,
+                                          uint32_t permille) {
+  if (stage.calls == 0) {
+    return 0;
+  }
+  uint64_t target = (stage.calls * permille + 999) / 1000;
+  if (target == 0) {
+    target = 1;
+  }
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < SERUM_PERF_HISTOGRAM_BUCKETS; ++i) {
+    const uint64_t count = stage.histogram[i];
+    if (count == 0 || seen + count < target) {
+      seen += count;
+      continue;
+    }
+    // Interpolate linearly inside the bucket; the top bucket has no upper
+    // bound, so the observed maximum closes it.
+    const uint64_t lower = i == 0 ? 0 : (1ull << i);
+    const uint64_t upper = i + 1 == SERUM_PERF_HISTOGRAM_BUCKETS
+                               ? stage.maxNs
+                               : (1ull << (i + 1));
+    const double position =
+        static_cast<double>(target - seen) / static_cast<double>(count);
+    const uint64_t span = upper > lower ? upper - lower : 0;
+    const uint64_t value =
+        lower + static_cast<uint64_t>(position * static_cast<double>(span));
+    return value < stage.maxNs ? value : stage.maxNs;
+  }
+  return stage.maxNs;
+}
+
+void PerfCounters::Fill(Serum_Perf_Counters* counters) const {
+  counters->stageCount = SERUM_PERF_STAGE_COUNT;
+  counters->inputFrames = inputFrames;
+  counters->renderedFrames =
+      m_stages[SERUM_PERF_STAGE_FRAME_ROUND_TRIP].calls;
+  counters->sameFrameReturns = sameFrameReturns;
+  counters->noFrameReturns = noFrameReturns;
+  for (uint32_t i = 0; i < SERUM_PERF_STAGE_COUNT; ++i) {
+    const Stage& s = m_stages[i];
+    Serum_Perf_Stage& out = counters->stages[i];
+    out.calls = s.calls;
+    out.totalNs = s.totalNs;
+    out.maxNs = s.maxNs;
+    out.p50Ns = EstimatePercentile(s, 500);
+    out.p99Ns = EstimatePercentile(s, 990);
+    memcpy(out.histogram, s.histogram, sizeof(out.histogram));
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "serum.h"
+
+// Cumulative per-stage latency counters behind Serum_GetPerfCounters(). Every
+// stage keeps a call count, total and worst time plus a log2 histogram that
+// p50/p99 are estimated from, so recording stays O(1) and allocation free.
+class PerfCounters {
+ public:
+  static uint64_t NowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  void Record(uint32_t stage, uint64_t elapsedNs);
+  void RecordSince(uint32_t stage, uint64_t startNs) {
+    Record(stage, NowNs() - startNs);
+  }
+  void Reset();
+  void Fill(Serum_Perf_Counters* counters) const;
+
+  uint64_t Calls(uint32_t stage) const { return m_stages[stage].calls; }
+  uint64_t TotalNs(uint32_t stage) const { return m_stages[stage].totalNs; }
+
+  uint64_t inputFrames = 0;
+  uint64_t sameFrameReturns = 0;
+  uint64_t noFrameReturns = 0;
+
+ private:
+  struct Stage {
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t histogram[SERUM_PERF_HISTOGRAM_BUCKETS] = {};
+  };
+
+  static uint64_t EstimatePercentile(const Stage& stage, uint32_t permille);
+
+  Stage m_stages[SERUM_PERF_STAGE_COUNT];
+};
+
+// Times the enclosing scope into one PerfCounters stage.
+class ScopedPerfStage {
+ public:
+  ScopedPerfStage(PerfCounters& counters, uint32_t stage)
+      : m_counters(counters), m_stage(stage), m_start(PerfCounters::NowNs()) {}
+  ~ScopedPerfStage() { m_counters.RecordSince(m_stage, m_start); }
+
+  ScopedPerfStage(const ScopedPerfStage&) = delete;
+  ScopedPerfStage& operator=(const ScopedPerfStage&) = delete;
+
+ private:
+  PerfCounters& m_counters;
+  uint32_t m_stage;
+  uint64_t m_start;
+};
@@ -0,0 +1,71 @@
+#include "RotationScheduler.h"
+
+#include "WorkerLock.h"
+
+void RotationScheduler::Start() {
+  std::lock_guard<std::mutex> wake(m_wakeMutex);
+  if (m_thread.joinable()) {
+    return;
+  }
+  m_stop = false;
+  m_thread = std::thread(&RotationScheduler::WorkerLoop, this);
+}
+
+void RotationScheduler::Stop() {
+  {
+    std::lock_guard<std::mutex> wake(m_wakeMutex);
+    m_stop = true;
+    m_wake.notify_one();
+  }
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  m_stop = false;
+  m_armed = false;
+}
+
+void RotationScheduler::Arm(uint32_t delayMs) {
+  std::lock_guard<std::mutex> wake(m_wakeMutex);
+  m_armed = delayMs > 0;
+  m_deadline = Clock::now() + std::chrono::milliseconds(delayMs);
+  m_wake.notify_one();
+}
+
+void RotationScheduler::WorkerLoop() {
+  std::unique_lock<std::mutex> wake(m_wakeMutex);
+  while (true) {
+    if (m_stop) {
+      return;
+    }
+    if (!m_armed) {
+      m_wake.wait(wake);
+      continue;
+    }
+    if (Clock::now() < m_deadline) {
+      m_wake.wait_until(wake, m_deadline);
+      continue;
+    }
+    wake.unlock();
+    auto api = TryLockWorker(m_apiMutex, [&](auto retry) {
+      wake.lock();
+      m_wake.wait_for(wake, retry);
+    });
+    if (!api.owns_lock()) {
+      continue;
+    }
+    wake.lock();
+    // Arm() only runs with the API mutex held, so the deadline can't move
+    // until the tick is done; it may have been re-armed before the lock was
+    // taken though.
+    const bool due = m_armed && Clock::now() >= m_deadline;
+    if (due) {
+      m_armed = false;
+    }
+    wake.unlock();
+    if (due) {
+      m_tick();
+    }
+    api.unlock();
+    wake.lock();
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs the color rotations and scene frames at their deadlines on a worker
+// thread, so hosts don't have to poll Serum_Rotate(). Every call that
+// returns a rotation or scene timer re-arms the deadline; with no timer
+// armed the worker sleeps on a condition variable and uses no CPU.
+//
+// The worker takes the API mutex as described in WorkerLock.h.
+// All public methods run on the API thread with the mutex held.
+class RotationScheduler {
+ public:
+  // Called on the worker thread with the API mutex held once the deadline
+  // is reached. It is expected to re-arm the scheduler.
+  using TickFunction = std::function<void()>;
+
+  RotationScheduler(std::recursive_mutex& apiMutex, TickFunction tick)
+      : m_apiMutex(apiMutex), m_tick(std::move(tick)) {}
+  ~RotationScheduler() { Stop(); }
+
+  void Start();
+  void Stop();
+  bool IsRunning() const { return m_thread.joinable(); }
+
+  // Schedules the next tick delayMs from now, 0 disarms.
+  void Arm(uint32_t delayMs);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void WorkerLoop();
+
+  std::recursive_mutex& m_apiMutex;
+  TickFunction m_tick;
+
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::thread m_thread;
+  bool m_stop = false;
+  bool m_armed = false;
+  Clock::time_point m_deadline;
+};
@@ -12,20 +12,14 @@
 #include <string>
 #include <vector>
 
+#include "Diagnostics.h"
 #include "TimeUtils.h"
+#include "Tracing.h"
 
 #ifdef _MSC_VER
 #define strcasecmp _stricmp
 #endif
 
-std::string formatNumber(int num, int width) {
-  std::string s = std::to_string(num);
-  if (s.length() < width) {
-    s = std::string(width - s.length(), '0') + s;
-  }
-  return s;
-}
-
 // Constants for text positioning
 const int SCENE_Y = 2;
 const int GROUP_Y = 12;
@@ -49,12 +43,14 @@ void SceneGenerator::setDepth(uint8_t depth) {
 }
 
 bool SceneGenerator::parseCSV(const std::string &csv_filename) {
+  SERUM_TRACE_SCOPE("SceneGenerator::parseCSV");
   const char *sceneVerbose = std::getenv("SERUM_DEBUG_SCENE_VERBOSE");
   const bool logParseSummary =
-      sceneVerbose && (strcmp(sceneVerbose, "1") == 0 ||
-                       strcasecmp(sceneVerbose, "true") == 0 ||
-                       strcasecmp(sceneVerbose, "on") == 0 ||
-                       strcasecmp(sceneVerbose, "yes") == 0);
+      kSerumDiagnostics && sceneVerbose &&
+      (strcmp(sceneVerbose, "1") == 0 ||
+       strcasecmp(sceneVerbose, "true") == 0 ||
+       strcasecmp(sceneVerbose, "on") == 0 ||
+       strcasecmp(sceneVerbose, "yes") == 0);
   std::ifstream in_csv(csv_filename);
   if (!in_csv.is_open()) {
     Log("SceneGenerator: Could not open CSV file: %s", csv_filename.c_str());
@@ -140,6 +136,7 @@ bool SceneGenerator::parseCSV(const std::string &csv_filename) {
     }
   }
 
+  rebuildSceneIndex();
   m_active = !m_sceneData.empty();
   if (logParseSummary) {
     Log("SceneGenerator: Parsed %s scenes=%u skippedInvalid=%u active=%s",
@@ -200,16 +197,35 @@ bool SceneGenerator::generateDump(const std::string &dump_filename, int id) {
   return true;
 }
 
+void SceneGenerator::rebuildSceneIndex() {
+  m_sceneIndex.clear();
+  uint16_t maxSceneId = 0;
+  for (const SceneData &data : m_sceneData) {
+    maxSceneId = std::max(maxSceneId, data.sceneId);
+  }
+  if (m_sceneData.empty()) return;
+  m_sceneIndex.assign(static_cast<size_t>(maxSceneId) + 1, kNoSceneIndex);
+  for (uint32_t i = 0; i < m_sceneData.size(); ++i) {
+    // Keep the first entry for duplicate IDs, like a linear search would.
+    uint32_t &index = m_sceneIndex[m_sceneData[i].sceneId];
+    if (index == kNoSceneIndex) index = i;
+  }
+}
+
+const SceneData *SceneGenerator::findScene(uint16_t sceneId) const {
+  if (sceneId >= m_sceneIndex.size()) return nullptr;
+  const uint32_t index = m_sceneIndex[sceneId];
+  return index == kNoSceneIndex ? nullptr : &m_sceneData[index];
+}
+
 bool SceneGenerator::getSceneInfo(uint16_t sceneId, uint16_t &frameCount,
                                   uint16_t &durationPerFrame,
                                   bool &interruptable, bool &startImmediately,
                                   uint8_t &repeat,
                                   uint8_t &sceneOptions) const {
-  auto it = std::find_if(
-      m_sceneData.begin(), m_sceneData.end(),
-      [sceneId](const SceneData &data) { return data.sceneId == sceneId; });
+  auto *it = findScene(sceneId);
 
-  if (it == m_sceneData.end()) {
+  if (!it) {
     frameCount = 0;
     durationPerFrame = 0;
     interruptable = 0;
@@ -229,10 +245,8 @@ bool SceneGenerator::getSceneInfo(uint16_t sceneId, uint16_t &frameCount,
 }
 
 bool SceneGenerator::getCurrentGroup(uint16_t sceneId, uint8_t &group) const {
-  auto it = std::find_if(
-      m_sceneData.begin(), m_sceneData.end(),
-      [sceneId](const SceneData &data) { return data.sceneId == sceneId; });
-  if (it == m_sceneData.end()) {
+  auto *it = findScene(sceneId);
+  if (!it) {
     group = 1;
     return false;
   }
@@ -244,10 +258,8 @@ bool SceneGenerator::updateAndGetCurrentGroup(uint16_t sceneId,
                                               uint16_t frameIndex,
                                               int requestedGroup,
                                               uint8_t &group) {
-  auto it = std::find_if(
-      m_sceneData.begin(), m_sceneData.end(),
-      [sceneId](const SceneData &data) { return data.sceneId == sceneId; });
-  if (it == m_sceneData.end()) {
+  auto *it = findScene(sceneId);
+  if (!it) {
     group = 1;
     return false;
   }
@@ -288,10 +300,8 @@ bool SceneGenerator::getSceneEndHoldDurationMs(uint16_t sceneId,
     return true;
   }
 
-  auto it = std::find_if(
-      m_sceneData.begin(), m_sceneData.end(),
-      [sceneId](const SceneData &data) { return data.sceneId == sceneId; });
-  if (it == m_sceneData.end()) {
+  auto *it = findScene(sceneId);
+  if (!it) {
     durationMs = 0;
     return false;
   }
@@ -320,15 +330,12 @@ bool SceneGenerator::getAutoStartSceneInfo(
 uint16_t SceneGenerator::generateFrame(uint16_t sceneId, uint16_t frameIndex,
                                        uint8_t *buffer, int group,
                                        bool disableTimer) {
-  static uint32_t lastTime = 0;
-  if (frameIndex == 0) lastTime = 0;  // Reset timer for new scene
+  if (frameIndex == 0) m_lastFrameTime = 0;  // Reset timer for new scene
   uint32_t now = GetMonotonicTimeMs();
 
-  auto it = std::find_if(
-      m_sceneData.begin(), m_sceneData.end(),
-      [sceneId](const SceneData &data) { return data.sceneId == sceneId; });
+  auto *it = findScene(sceneId);
 
-  if (it == m_sceneData.end()) {
+  if (!it) {
     return 0;
   }
 
@@ -336,33 +343,36 @@ uint16_t SceneGenerator::generateFrame(uint16_t sceneId, uint16_t frameIndex,
     return 0;
   }
 
-  if (!disableTimer && (lastTime + it->durationPerFrame) > now) {
+  if (!disableTimer && (m_lastFrameTime + it->durationPerFrame) > now) {
     // Too soon to generate the next frame, return remaining time
-    return it->durationPerFrame - (now - lastTime);
+    return it->durationPerFrame - (now - m_lastFrameTime);
   }
-  lastTime = now;
+  m_lastFrameTime = now;
 
   uint8_t currentGroup = 1;
   if (!updateAndGetCurrentGroup(sceneId, frameIndex, group, currentGroup)) {
     return 0;
   }
 
-  // Copy pre-rendered template
-  std::memcpy(buffer, m_template.fullFrame, 4096);
-
-  // Render dynamic numbers at right-aligned positions
-  std::string sceneIdStr = formatNumber(sceneId, NUMBER_WIDTH);
-  renderString(buffer, sceneIdStr, NUM_X, SCENE_Y);
-
-  std::string groupStr = formatNumber(currentGroup, NUMBER_WIDTH);
-  renderString(buffer, groupStr, NUM_X, GROUP_Y);
-
-  std::string frameStr = formatNumber(frameIndex + 1, NUMBER_WIDTH);
-  renderString(buffer, frameStr, NUM_X, FRAME_Y);
-
+  renderFrame(sceneId, frameIndex, currentGroup, buffer);
   return 0xffff;  // Success
 }
 
+void SceneGenerator::renderFrame(uint16_t sceneId, uint16_t frameIndex,
+                                 uint8_t group, uint8_t *buffer) const {
+  if (!m_sceneTemplateValid || m_sceneTemplateId != sceneId ||
+      m_sceneTemplateGroup != group) {
+    std::memcpy(m_sceneTemplate.fullFrame, m_template.fullFrame, 4096);
+    renderNumber(m_sceneTemplate.fullFrame, sceneId, NUM_X, SCENE_Y);
+    renderNumber(m_sceneTemplate.fullFrame, group, NUM_X, GROUP_Y);
+    m_sceneTemplateId = sceneId;
+    m_sceneTemplateGroup = group;
+    m_sceneTemplateValid = true;
+  }
+  std::memcpy(buffer, m_sceneTemplate.fullFrame, 4096);
+  renderNumber(buffer, frameIndex + 1, NUM_X, FRAME_Y);
+}
+
 bool SceneGenerator::matchesSceneMarkerRegion(const uint16_t *frameData) const {
   // "PUP SCENE" rendered at y=2 with 5x7 font and 1px spacing:
   // width = 9 chars * 6 - 1 = 53px, x in [0..52], y in [2..8].
@@ -395,6 +405,7 @@ void SceneGenerator::initializeTemplate() {
   renderString(m_template.fullFrame, "FRAME NUMBER", 0, FRAME_Y);
 
   m_templateInitialized = true;
+  m_sceneTemplateValid = false;
 }
 
 const unsigned char *SceneGenerator::getCharFont(char c) const {
@@ -528,6 +539,15 @@ void SceneGenerator::renderString(uint8_t *buffer, const std::string &str,
   }
 }
 
+// Renders value as NUMBER_WIDTH zero-padded digits.
+void SceneGenerator::renderNumber(uint8_t *buffer, uint32_t value, uint8_t x,
+                                  uint8_t y) const {
+  for (int digit = NUMBER_WIDTH - 1; digit >= 0; --digit) {
+    renderChar(buffer, static_cast<char>('0' + value % 10), x + digit * 6, y);
+    value /= 10;
+  }
+}
+
 void SceneGenerator::Log(const char *format, ...) {
   if (!m_logCallback) {
     return;
@@ -63,6 +63,15 @@ class SceneGenerator {
                              uint8_t &repeat, uint8_t &sceneOptions) const;
   uint16_t generateFrame(uint16_t sceneId, uint16_t frameIndex, uint8_t *buffer,
                          int group = -1, bool disableTimer = false);
+  // Moves the frame timer of generateFrame() by delta ms when the clock
+  // source changes.
+  void rebaseFrameTimer(uint32_t delta) {
+    if (m_lastFrameTime != 0) m_lastFrameTime += delta;
+  }
+  // Renders a frame of a known scene and group without touching the timer or
+  // the group state, so it can run ahead of playback.
+  void renderFrame(uint16_t sceneId, uint16_t frameIndex, uint8_t group,
+                   uint8_t *buffer) const;
   bool matchesSceneMarkerRegion(const uint16_t *frameData) const;
   void setDepth(uint8_t depth);
   int getDepth() const { return m_depth; }
@@ -71,8 +80,10 @@ class SceneGenerator {
   uint16_t getAutoStartSceneId() const { return m_autoStartSceneId; }
   void Reset() {
     m_sceneData.clear();
+    m_sceneIndex.clear();
     m_autoStartTimer = 0;
     m_autoStartSceneId = 0;
+    m_lastFrameTime = 0;
     m_sceneEndHoldDurationMs.clear();
     m_depth = 2;
     m_templateInitialized = false;
@@ -82,6 +93,7 @@ class SceneGenerator {
   void setSceneData(const std::vector<SceneData> &data) {
     Reset();
     m_sceneData = data;
+    rebuildSceneIndex();
     m_active = !m_sceneData.empty();
   }
   const std::vector<SceneData> &getSceneData() const { return m_sceneData; }
@@ -93,17 +105,35 @@ class SceneGenerator {
   const void *m_logUserData = nullptr;
 
   std::vector<SceneData> m_sceneData;
+  // Dense sceneId -> index into m_sceneData, kNoSceneIndex for unused IDs.
+  static constexpr uint32_t kNoSceneIndex = 0xffffffff;
+  std::vector<uint32_t> m_sceneIndex;
+
+  void rebuildSceneIndex();
+  const SceneData *findScene(uint16_t sceneId) const;
+  SceneData *findScene(uint16_t sceneId) {
+    return const_cast<SceneData *>(
+        static_cast<const SceneGenerator *>(this)->findScene(sceneId));
+  }
 
   const unsigned char *getCharFont(char c) const;
   void renderChar(uint8_t *buffer, char c, uint8_t x, uint8_t y) const;
   void renderString(uint8_t *buffer, const std::string &str, uint8_t x,
                     uint8_t y) const;
+  void renderNumber(uint8_t *buffer, uint32_t value, uint8_t x,
+                    uint8_t y) const;
 
   struct TextTemplate {
     uint8_t fullFrame[4096];
   };
   TextTemplate m_template;
   bool m_templateInitialized;
+  // m_template with the scene ID and group of the last rendered frame filled
+  // in, so consecutive frames only redraw the frame number.
+  mutable TextTemplate m_sceneTemplate;
+  mutable bool m_sceneTemplateValid = false;
+  mutable uint16_t m_sceneTemplateId = 0;
+  mutable uint8_t m_sceneTemplateGroup = 0;
 
   void initializeTemplate();
 
@@ -112,5 +142,6 @@ class SceneGenerator {
 
   uint8_t m_autoStartTimer = 0;     // Timer for auto-start scenes
   uint16_t m_autoStartSceneId = 0;  // Scene ID to auto-start
+  uint32_t m_lastFrameTime = 0;     // When generateFrame() last rendered
   std::unordered_map<uint16_t, uint32_t> m_sceneEndHoldDurationMs;
 };
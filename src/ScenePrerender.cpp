@@ -0,0 +1,119 @@
+#include "ScenePrerender.h"
+
+#include <cstring>
+
+#include "WorkerLock.h"
+
+void ScenePrerender::Request(const ScenePrerenderJob& job) {
+  const bool sameScene =
+      m_jobActive && job.sceneId == m_job.sceneId &&
+      job.group == m_job.group && job.frameCount == m_job.frameCount &&
+      memcmp(job.colorshifts32, m_job.colorshifts32,
+             sizeof(job.colorshifts32)) == 0 &&
+      memcmp(job.colorshifts64, m_job.colorshifts64,
+             sizeof(job.colorshifts64)) == 0;
+  if (!sameScene) {
+    for (ScenePrerenderSlot& slot : m_slots) {
+      slot.ready = false;
+    }
+  }
+  m_job = job;
+  m_jobActive = true;
+  m_nextFrame = job.firstFrame;
+  m_chain = job.chain;
+
+  std::lock_guard<std::mutex> wake(m_wakeMutex);
+  if (!m_thread.joinable()) {
+    m_stop = false;
+    m_thread = std::thread(&ScenePrerender::WorkerLoop, this);
+  }
+  m_pending = true;
+  m_wake.notify_one();
+}
+
+void ScenePrerender::Cancel() {
+  m_jobActive = false;
+  for (ScenePrerenderSlot& slot : m_slots) {
+    slot.ready = false;
+  }
+}
+
+void ScenePrerender::Stop() {
+  {
+    std::lock_guard<std::mutex> wake(m_wakeMutex);
+    m_stop = true;
+    m_wake.notify_one();
+  }
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  m_stop = false;
+  m_pending = false;
+}
+
+const ScenePrerenderSlot* ScenePrerender::Find(uint16_t sceneId,
+                                               uint8_t group,
+                                               uint16_t frameIndex) const {
+  if (!m_jobActive || sceneId != m_job.sceneId || group != m_job.group) {
+    return nullptr;
+  }
+  const ScenePrerenderSlot& slot = m_slots[frameIndex % kSlots];
+  return slot.ready && slot.frameIndex == frameIndex ? &slot : nullptr;
+}
+
+bool ScenePrerender::RenderNext() {
+  if (!m_jobActive || m_nextFrame >= m_job.frameCount ||
+      m_nextFrame >= m_job.firstFrame + kSlots) {
+    return false;
+  }
+  ScenePrerenderSlot& slot = m_slots[m_nextFrame % kSlots];
+  if (slot.ready && slot.frameIndex == m_nextFrame && slot.before == m_chain) {
+    m_chain = slot.after;
+    ++m_nextFrame;
+    return true;
+  }
+  slot.ready = false;
+  slot.frameIndex = m_nextFrame;
+  slot.before = m_chain;
+  if (!m_render(m_job, m_nextFrame, m_chain, slot)) {
+    // The chain state after this frame is unknown, so nothing further can
+    // be rendered ahead until playback catches up and asks again.
+    m_nextFrame = m_job.frameCount;
+    return false;
+  }
+  slot.after = m_chain;
+  slot.ready = true;
+  ++m_nextFrame;
+  return true;
+}
+
+void ScenePrerender::WorkerLoop() {
+  std::unique_lock<std::mutex> wake(m_wakeMutex);
+  while (true) {
+    m_wake.wait(wake, [this] { return m_stop || m_pending; });
+    if (m_stop) {
+      return;
+    }
+    wake.unlock();
+    auto api = TryLockWorker(m_apiMutex, [&](auto retry) {
+      wake.lock();
+      m_wake.wait_for(wake, retry);
+    });
+    if (!api.owns_lock()) {
+      continue;
+    }
+    const bool rendered = RenderNext();
+    wake.lock();
+    if (!rendered) {
+      m_pending = false;
+    }
+    api.unlock();
+    if (rendered) {
+      // Give a Serum_* call waiting for the mutex the chance to take it
+      // before the next frame.
+      wake.unlock();
+      std::this_thread::yield();
+      wake.lock();
+    }
+  }
+}
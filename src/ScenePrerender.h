@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "serum.h"
+
+// Renders the upcoming frames of a running foreground scene on a worker
+// thread into a small ring of slots, so Serum_Rotate() only has to copy a
+// finished frame when the scene advances.
+//
+// The worker renders one frame at a time while holding the API mutex, the
+// same lock every Serum_* entry point takes, so it never runs concurrently
+// with the caller's thread. It releases the mutex after every frame, so a
+// Serum_* call that arrives meanwhile waits for at most one frame render.
+// All public methods except Stop() must be called with that mutex held.
+
+// Stream state carried from one scene frame to the next: where the scene
+// frame search starts and the scene input buffer.
+struct ScenePrerenderChain {
+  uint32_t searchStart = 0;
+  std::vector<uint8_t> input;
+
+  bool operator==(const ScenePrerenderChain& other) const {
+    return searchStart == other.searchStart && input == other.input;
+  }
+};
+
+struct ScenePrerenderJob {
+  uint16_t sceneId = 0;
+  uint8_t group = 0;
+  uint16_t frameCount = 0;
+  uint16_t firstFrame = 0;
+  ScenePrerenderChain chain;
+  uint32_t colorshifts32[MAX_COLOR_ROTATION_V2] = {};
+  uint32_t colorshifts64[MAX_COLOR_ROTATION_V2] = {};
+};
+
+struct ScenePrerenderSlot {
+  bool ready = false;
+  uint16_t frameIndex = 0;
+  ScenePrerenderChain before;
+  ScenePrerenderChain after;
+  uint32_t frameId = 0;
+  std::vector<uint16_t> frame32;
+  std::vector<uint16_t> frame64;
+  std::vector<uint16_t> rotationsinframe32;
+  std::vector<uint16_t> rotationsinframe64;
+  uint32_t width32 = 0;
+  uint32_t width64 = 0;
+  uint8_t flags = 0;
+};
+
+class ScenePrerender {
+ public:
+  static constexpr uint16_t kSlots = 4;
+
+  // Renders frameIndex of the job, starting from chain and leaving the chain
+  // state after that frame in it. Returns false if the frame can't be
+  // pre-rendered; playback then renders it synchronously.
+  using RenderFunction =
+      std::function<bool(const ScenePrerenderJob& job, uint16_t frameIndex,
+                         ScenePrerenderChain& chain, ScenePrerenderSlot& slot)>;
+
+  ScenePrerender(std::recursive_mutex& apiMutex, RenderFunction render)
+      : m_apiMutex(apiMutex), m_render(std::move(render)) {}
+  ~ScenePrerender() { Stop(); }
+
+  // Asks for the frames following job.firstFrame - 1. Slots that already
+  // hold frames of the same scene rendered from the same chain are kept.
+  void Request(const ScenePrerenderJob& job);
+  // Drops the job and all slots, e.g. when the scene stops.
+  void Cancel();
+  // Finishes the worker thread. Safe with the API mutex held, see
+  // TryLockWorker().
+  void Stop();
+
+  const ScenePrerenderJob* ActiveJob() const {
+    return m_jobActive ? &m_job : nullptr;
+  }
+  const ScenePrerenderSlot* Find(uint16_t sceneId, uint8_t group,
+                                 uint16_t frameIndex) const;
+
+ private:
+  void WorkerLoop();
+  bool RenderNext();
+
+  std::recursive_mutex& m_apiMutex;
+  RenderFunction m_render;
+
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::thread m_thread;
+  bool m_stop = false;
+  bool m_pending = false;
+
+  // Protected by m_apiMutex.
+  bool m_jobActive = false;
+  ScenePrerenderJob m_job;
+  uint16_t m_nextFrame = 0;
+  ScenePrerenderChain m_chain;
+  ScenePrerenderSlot m_slots[kSlots];
+};
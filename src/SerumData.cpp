@@ -1,11 +1,15 @@
 #include "SerumData.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "DecompressingIStream.h"
+#include "Diagnostics.h"
+#include "Tracing.h"
 #include "miniz/miniz.h"
 #include "serum-version.h"
 
@@ -21,6 +25,9 @@ constexpr uint32_t kMonochromeTriggerId = 65432u;
 constexpr uint32_t kMonochromePaletteTriggerId = 65431u;
 
 bool IsLoadTimingEnabled() {
+  if constexpr (!kSerumDiagnostics) {
+    return false;
+  }
   const char *value = std::getenv("SERUM_PROFILE_LOAD_TIMES");
   if (!value || value[0] == '\0') {
     return false;
@@ -33,9 +40,36 @@ uint64_t MakeCriticalTriggerSignature(uint8_t mask, uint8_t shape,
                                       uint32_t hash) {
   return (uint64_t(mask) << 40) | (uint64_t(shape) << 32) | hash;
 }
+
+uint16_t Rgb888To565(const uint8_t *rgb) {
+  return (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) |
+                    (rgb[2] >> 3));
+}
+
+uint64_t HashValues(const uint16_t *values, size_t count) {
+  uint64_t hash = 1469598103934665603ull;
+  for (size_t i = 0; i < count; ++i) {
+    hash = (hash ^ values[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// Active v1 color rotations of a frame. Each keeps its slot, so the running
+// rotation phase carries over between frames the same way in v1 and v2.
+struct V1FrameRotations {
+  static constexpr uint8_t kNone = 0xff;
+  uint8_t first[MAX_COLOR_ROTATION_V2] = {};
+  uint8_t length[MAX_COLOR_ROTATION_V2] = {};
+  uint8_t delay[MAX_COLOR_ROTATION_V2] = {};
+  uint8_t slotOfIndex[256];
+  uint8_t posOfIndex[256];
+};
 }  // namespace
 
 static uint32_t GetDebugSpriteIdFromEnv() {
+  if constexpr (!kSerumDiagnostics) {
+    return 0xffffffffu;
+  }
   const char *value = std::getenv("SERUM_DEBUG_SPRITE_ID");
   if (!value || value[0] == '\0') {
     return 0xffffffffu;
@@ -52,6 +86,7 @@ SerumData::SerumData()
     : SerumVersion(0),
       concentrateFileVersion(SERUM_CONCENTRATE_VERSION),
       is256x64(false),
+      upconvertedV1(false),
       hashcodes(0, true),
       shapecompmode(0),
       compmaskID(255),
@@ -121,6 +156,8 @@ SerumData::SerumData()
   dynaspritemasks_active.setProfileLabel("dynaspritemasks_active");
   dynaspritemasks_extra.setProfileLabel("dynaspritemasks_extra");
   dynaspritemasks_extra_active.setProfileLabel("dynaspritemasks_extra_active");
+  cframes_v2.enableDeltaEncoding();
+  cframes_v2_extra.enableDeltaEncoding();
   sceneGenerator = new SceneGenerator();
   if (is_real_machine()) {
     m_packingSidecarsStorage.emplace_back(256u * 1024u * 1024u, 0xA5);
@@ -131,6 +168,10 @@ SerumData::~SerumData() {}
 
 void SerumData::Clear() {
   m_packingSidecarsNormalized = false;
+  // A project loaded after an older cROMc is saved in the current format.
+  concentrateFileVersion = SERUM_CONCENTRATE_VERSION;
+  upconvertedV1 = false;
+  nccolors = 0;
   hashcodes.clear();
   shapecompmode.clear();
   compmaskID.clear();
@@ -208,6 +249,7 @@ void SerumData::Clear() {
   sceneFrameIdByTriplet.clear();
   colorRotationLookupByFrameAndColor.clear();
   criticalTriggerFramesBySignature.clear();
+  m_payloadStore.clear();
 }
 
 void SerumData::BuildCriticalTriggerLookup() {
@@ -316,6 +358,7 @@ void SerumData::DebugLogPackingSidecarsStorageSizes() {
 }
 
 void SerumData::BuildPackingSidecarsAndNormalize() {
+  SERUM_TRACE_SCOPE("SerumData::BuildPackingSidecarsAndNormalize");
   if (m_packingSidecarsNormalized) {
     return;
   }
@@ -558,6 +601,7 @@ bool SerumData::HasSpriteRuntimeSidecars() const {
 }
 
 void SerumData::BuildSpriteRuntimeSidecars() {
+  SERUM_TRACE_SCOPE("SerumData::BuildSpriteRuntimeSidecars");
   auto storeRuntimeSidecarCopy = [this](const void *data, size_t size) {
     if (!data || size == 0 || m_packingSidecarsStorage.empty()) {
       return;
@@ -784,7 +828,15 @@ void SerumData::LogSparseVectorProfileSnapshot() {
   logCounters(dynaspritemasks_extra_active);
 }
 
+void SerumData::InternSparseVectorPayloads() {
+  ForEachSparseVector(
+      [this](auto &vec) { vec.internPayloads(m_payloadStore); });
+  m_payloadStore.finishInterning();
+  Log("Shared payload store: %zu bytes", m_payloadStore.blob.size());
+}
+
 void SerumData::BuildColorRotationLookup() {
+  SERUM_TRACE_SCOPE("SerumData::BuildColorRotationLookup");
   colorRotationLookupByFrameAndColor.clear();
   if (SerumVersion != SERUM_V2 || nframes == 0) {
     return;
@@ -831,7 +883,455 @@ bool SerumData::TryGetColorRotation(uint32_t frameId, uint16_t color,
   return true;
 }
 
+bool SerumData::UpconvertV1ToV2() {
+  SERUM_TRACE_SCOPE("SerumData::UpconvertV1ToV2");
+  if (SerumVersion != SERUM_V1 || nframes == 0) {
+    return false;
+  }
+  if (fheight != 32 && fheight != 64) {
+    Log("Serum v1 upconversion skipped: frame height %u is not 32 or 64",
+        fheight);
+    return false;
+  }
+  if (nccolors == 0 || nccolors > 64 || nocolors == 0 || nocolors > 16 ||
+      nframes >= 0xffff) {
+    Log("Serum v1 upconversion skipped: unsupported palette or frame count");
+    return false;
+  }
+
+  constexpr uint8_t kNone = V1FrameRotations::kNone;
+  const size_t framePixels = static_cast<size_t>(fwidth) * fheight;
+  const size_t spritePixelsV1 = MAX_SPRITE_SIZE * MAX_SPRITE_SIZE;
+  const size_t spritePixels = MAX_SPRITE_WIDTH * MAX_SPRITE_HEIGHT;
+
+  // Pass 1 validates everything without touching the loaded data, so a
+  // project that can't be expressed exactly in v2 stays on the v1 pipeline.
+  struct V1Sprite {
+    bool present = false;
+    std::vector<uint8_t> original;
+    std::vector<uint8_t> opaque;
+    std::vector<uint8_t> colors;
+    bool usesIndex[256] = {};
+    uint32_t detectWords[MAX_SPRITE_DETECT_AREAS] = {};
+    uint16_t detectPos[MAX_SPRITE_DETECT_AREAS] = {};
+    uint16_t detectAreas[4 * MAX_SPRITE_DETECT_AREAS] = {};
+  };
+  std::vector<V1Sprite> sprites(nsprites);
+  for (uint32_t spriteId = 0; spriteId < nsprites; ++spriteId) {
+    if (!spritedescriptionso.hasData(spriteId) ||
+        !spritedescriptionso_opaque.hasData(spriteId)) {
+      continue;
+    }
+    V1Sprite &sprite = sprites[spriteId];
+    sprite.present = true;
+    sprite.original.assign(spritePixels, 0);
+    sprite.opaque.assign(spritePixels, 0);
+    sprite.colors.assign(spritePixels, 0);
+    std::vector<uint8_t> source(spritePixelsV1);
+    memcpy(source.data(), spritedescriptionso[spriteId], spritePixelsV1);
+    std::vector<uint8_t> opaque(spritePixelsV1);
+    memcpy(opaque.data(), spritedescriptionso_opaque[spriteId], spritePixelsV1);
+    std::vector<uint8_t> colors(spritePixelsV1);
+    memcpy(colors.data(), spritedescriptionsc[spriteId], spritePixelsV1);
+    for (uint32_t y = 0; y < MAX_SPRITE_SIZE; ++y) {
+      for (uint32_t x = 0; x < MAX_SPRITE_SIZE; ++x) {
+        const size_t from = y * MAX_SPRITE_SIZE + x;
+        if (opaque[from] == 0) {
+          continue;
+        }
+        if (y >= MAX_SPRITE_HEIGHT) {
+          Log("Serum v1 upconversion skipped: sprite %u is taller than %d",
+              spriteId, MAX_SPRITE_HEIGHT);
+          return false;
+        }
+        const size_t to = y * MAX_SPRITE_WIDTH + x;
+        sprite.original[to] = source[from];
+        sprite.opaque[to] = 1;
+        sprite.colors[to] = colors[from];
+        sprite.usesIndex[colors[from]] = true;
+      }
+    }
+    memcpy(sprite.detectWords, spritedetdwords[spriteId],
+           sizeof(sprite.detectWords));
+    memcpy(sprite.detectAreas, spritedetareas[spriteId],
+           sizeof(sprite.detectAreas));
+    const uint16_t *detectPos = spritedetdwordpos[spriteId];
+    for (uint32_t area = 0; area < MAX_SPRITE_DETECT_AREAS; ++area) {
+      const uint16_t x = detectPos[area] % MAX_SPRITE_SIZE;
+      const uint16_t y = detectPos[area] / MAX_SPRITE_SIZE;
+      sprite.detectPos[area] = y * MAX_SPRITE_WIDTH + x;
+      const uint16_t *detect = &sprite.detectAreas[area * 4];
+      if (detect[0] == 0xffff) {
+        continue;
+      }
+      // v2 drops detect areas without opaque pixels, v1 matches them on the
+      // detection word alone.
+      bool hasOpaque = false;
+      for (uint32_t dy = 0; dy < detect[3] && !hasOpaque; ++dy) {
+        for (uint32_t dx = 0; dx < detect[2]; ++dx) {
+          const uint32_t sy = detect[1] + dy;
+          const uint32_t sx = detect[0] + dx;
+          if (sy < MAX_SPRITE_HEIGHT && sx < MAX_SPRITE_SIZE &&
+              sprite.opaque[sy * MAX_SPRITE_WIDTH + sx] > 0) {
+            hasOpaque = true;
+            break;
+          }
+        }
+      }
+      if (y >= MAX_SPRITE_HEIGHT || detect[1] + detect[3] > MAX_SPRITE_HEIGHT ||
+          detect[0] + detect[2] > MAX_SPRITE_SIZE || !hasOpaque) {
+        Log("Serum v1 upconversion skipped: sprite %u has a detect area v2 "
+            "can't use",
+            spriteId);
+        return false;
+      }
+    }
+  }
+
+  std::vector<V1FrameRotations> rotations(nframes);
+  std::vector<uint8_t> frameSprites(
+      static_cast<size_t>(nframes) * MAX_SPRITES_PER_FRAME, 255);
+  // v1 sprite colors index the frame palette, so a sprite shown with
+  // different palettes becomes one v2 sprite per distinct coloring.
+  std::vector<uint32_t> variantSource;
+  std::vector<std::vector<uint16_t>> variantColors;
+  uint8_t palette[3 * 64] = {};
+  uint16_t palette565[256] = {};
+  std::vector<uint8_t> indices(framePixels);
+  std::vector<uint8_t> dyna(framePixels);
+  std::vector<uint8_t> dynaActive(framePixels);
+  std::vector<uint8_t> dynaColors(MAX_DYNA_4COLS_PER_FRAME * nocolors);
+  std::vector<uint16_t> colored(spritePixels);
+  for (uint32_t frameId = 0; frameId < nframes; ++frameId) {
+    memcpy(palette, cpal[frameId], 3 * nccolors);
+    for (uint32_t i = 0; i < nccolors; ++i) {
+      palette565[i] = Rgb888To565(&palette[i * 3]);
+    }
+
+    V1FrameRotations &rot = rotations[frameId];
+    memset(rot.slotOfIndex, kNone, sizeof(rot.slotOfIndex));
+    memset(rot.posOfIndex, kNone, sizeof(rot.posOfIndex));
+    uint8_t v1Rotations[3 * MAX_COLOR_ROTATIONS];
+    memcpy(v1Rotations, colorrotations[frameId], sizeof(v1Rotations));
+    for (uint32_t k = 0; k < MAX_COLOR_ROTATIONS; ++k) {
+      const uint8_t first = v1Rotations[k * 3];
+      const uint8_t length = v1Rotations[k * 3 + 1];
+      if (first == 255 || length == 0) {
+        continue;
+      }
+      if (first + length > nccolors ||
+          length > MAX_LENGTH_COLOR_ROTATION - 2) {
+        Log("Serum v1 upconversion skipped: frame %u has an invalid color "
+            "rotation",
+            frameId);
+        return false;
+      }
+      if (k >= MAX_COLOR_ROTATION_V2) {
+        Log("Serum v1 upconversion skipped: frame %u uses color rotation "
+            "slot %u",
+            frameId, k);
+        return false;
+      }
+      for (uint8_t j = 0; j < length; ++j) {
+        if (rot.slotOfIndex[first + j] != kNone) {
+          Log("Serum v1 upconversion skipped: frame %u has overlapping color "
+              "rotations",
+              frameId);
+          return false;
+        }
+        rot.slotOfIndex[first + j] = static_cast<uint8_t>(k);
+        rot.posOfIndex[first + j] = j;
+      }
+      rot.first[k] = first;
+      rot.length[k] = length;
+      rot.delay[k] = v1Rotations[k * 3 + 2];
+    }
+
+    bool staticUsed[256] = {};
+    bool dynamicUsed[256] = {};
+    bool setUsed[256] = {};
+    memcpy(indices.data(), cframes[frameId], framePixels);
+    const bool hasDynamic =
+        frameId < frameHasDynamic.size() && frameHasDynamic[frameId] > 0;
+    if (hasDynamic) {
+      memcpy(dyna.data(), dynamasks[frameId], framePixels);
+      memcpy(dynaActive.data(), dynamasks_active[frameId], framePixels);
+      memcpy(dynaColors.data(), dyna4cols[frameId], dynaColors.size());
+    }
+    for (size_t tk = 0; tk < framePixels; ++tk) {
+      if (hasDynamic && dynaActive[tk] > 0) {
+        setUsed[dyna[tk]] = true;
+      } else {
+        staticUsed[indices[tk]] = true;
+      }
+    }
+    for (uint32_t set = 0; set < 256; ++set) {
+      if (!setUsed[set]) {
+        continue;
+      }
+      if (set >= MAX_DYNA_4COLS_PER_FRAME) {
+        Log("Serum v1 upconversion skipped: frame %u uses dynamic set %u",
+            frameId, set);
+        return false;
+      }
+      for (uint32_t c = 0; c < nocolors; ++c) {
+        dynamicUsed[dynaColors[set * nocolors + c]] = true;
+      }
+    }
+
+    const uint16_t backgroundId = backgroundIDs[frameId][0];
+    if (backgroundId < nbackgrounds) {
+      uint16_t bb[4];
+      memcpy(bb, backgroundBB[frameId], sizeof(bb));
+      const uint8_t *background = backgroundframes[backgroundId];
+      for (uint32_t y = bb[1]; y <= bb[3] && y < fheight; ++y) {
+        for (uint32_t x = bb[0]; x <= bb[2] && x < fwidth; ++x) {
+          staticUsed[background[y * fwidth + x]] = true;
+        }
+      }
+    }
+
+    uint8_t slots[MAX_SPRITES_PER_FRAME];
+    memcpy(slots, framesprites[frameId], sizeof(slots));
+    for (uint32_t ti = 0; ti < MAX_SPRITES_PER_FRAME && slots[ti] < 255;
+         ++ti) {
+      const uint8_t spriteId = slots[ti];
+      if (spriteId >= nsprites || !sprites[spriteId].present) {
+        Log("Serum v1 upconversion skipped: frame %u references empty "
+            "sprite %u",
+            frameId, spriteId);
+        return false;
+      }
+      for (uint32_t tj = 0; tj < ti; ++tj) {
+        if (slots[tj] == spriteId) {
+          Log("Serum v1 upconversion skipped: frame %u lists sprite %u twice",
+              frameId, spriteId);
+          return false;
+        }
+      }
+      const V1Sprite &sprite = sprites[spriteId];
+      for (uint32_t i = 0; i < 256; ++i) {
+        staticUsed[i] = staticUsed[i] || sprite.usesIndex[i];
+      }
+      bool hasColor = false;
+      for (size_t px = 0; px < spritePixels; ++px) {
+        colored[px] = sprite.opaque[px] ? palette565[sprite.colors[px]] : 0;
+        hasColor = hasColor || colored[px] != 0;
+      }
+      if (!hasColor) {
+        // An all-black coloring has no payload, v2 would skip the sprite.
+        Log("Serum v1 upconversion skipped: sprite %u is black in frame %u",
+            spriteId, frameId);
+        return false;
+      }
+      size_t variant = 0;
+      while (variant < variantSource.size() &&
+             (variantSource[variant] != spriteId ||
+              variantColors[variant] != colored)) {
+        ++variant;
+      }
+      if (variant == variantSource.size()) {
+        if (variant >= 255) {
+          Log("Serum v1 upconversion skipped: more than 255 sprite colorings");
+          return false;
+        }
+        variantSource.push_back(spriteId);
+        variantColors.push_back(colored);
+      }
+      frameSprites[static_cast<size_t>(frameId) * MAX_SPRITES_PER_FRAME + ti] =
+          static_cast<uint8_t>(variant);
+    }
+
+    // v2 rotates by color instead of by palette index: every static color
+    // must resolve to the same rotation phase as its v1 index, and dynamic
+    // content, which v2 never rotates, must not use rotating indices.
+    for (uint32_t i = 0; i < 256; ++i) {
+      if ((staticUsed[i] || dynamicUsed[i]) && i >= nccolors) {
+        Log("Serum v1 upconversion skipped: frame %u uses color %u outside "
+            "its palette",
+            frameId, i);
+        return false;
+      }
+      if (dynamicUsed[i] && rot.slotOfIndex[i] != kNone) {
+        Log("Serum v1 upconversion skipped: frame %u rotates dynamic colors",
+            frameId);
+        return false;
+      }
+      if (!staticUsed[i]) {
+        continue;
+      }
+      uint8_t foundSlot = kNone;
+      uint8_t foundPos = kNone;
+      for (uint8_t slot = 0; slot < MAX_COLOR_ROTATION_V2 && foundSlot == kNone;
+           ++slot) {
+        for (uint8_t pos = 0; pos < rot.length[slot]; ++pos) {
+          if (palette565[rot.first[slot] + pos] == palette565[i]) {
+            foundSlot = slot;
+            foundPos = pos;
+            break;
+          }
+        }
+      }
+      bool exact = foundSlot == rot.slotOfIndex[i];
+      if (exact && foundSlot != kNone) {
+        const uint8_t first = rot.first[foundSlot];
+        const uint8_t length = rot.length[foundSlot];
+        for (uint8_t shift = 0; shift < length && exact; ++shift) {
+          exact = palette565[first + (rot.posOfIndex[i] + shift) % length] ==
+                  palette565[first + (foundPos + shift) % length];
+        }
+      }
+      if (!exact) {
+        Log("Serum v1 upconversion skipped: frame %u has colors that are "
+            "ambiguous for color rotations",
+            frameId);
+        return false;
+      }
+    }
+  }
+
+  // Pass 2 writes the v2 representation.
+  std::vector<uint16_t> colors565(framePixels);
+  std::vector<uint16_t> dynaColors565(MAX_DYNA_SETS_PER_FRAME_V2 * nocolors);
+  std::vector<uint8_t> mask(framePixels);
+  std::unordered_map<uint64_t, std::vector<uint16_t>> backgroundsByHash;
+  uint16_t backgroundCount = 0;
+  for (uint32_t frameId = 0; frameId < nframes; ++frameId) {
+    memcpy(palette, cpal[frameId], 3 * nccolors);
+    for (uint32_t i = 0; i < nccolors; ++i) {
+      palette565[i] = Rgb888To565(&palette[i * 3]);
+    }
+
+    const uint8_t *frameIndices = cframes[frameId];
+    for (size_t tk = 0; tk < framePixels; ++tk) {
+      colors565[tk] = palette565[frameIndices[tk]];
+    }
+    cframes_v2.set(frameId, colors565.data(), framePixels);
+
+    std::fill(dynaColors565.begin(), dynaColors565.end(), 0);
+    const uint8_t *frameDynaColors = dyna4cols[frameId];
+    for (size_t i = 0; i < MAX_DYNA_4COLS_PER_FRAME * nocolors; ++i) {
+      dynaColors565[i] = palette565[frameDynaColors[i]];
+    }
+    dyna4cols_v2.set(frameId, dynaColors565.data(), dynaColors565.size());
+
+    const V1FrameRotations &rot = rotations[frameId];
+    uint16_t rotations565[MAX_COLOR_ROTATION_V2 * MAX_LENGTH_COLOR_ROTATION] =
+        {};
+    uint8_t v1Rotations[3 * MAX_COLOR_ROTATIONS];
+    memset(v1Rotations, 255, sizeof(v1Rotations));
+    for (uint8_t slot = 0; slot < MAX_COLOR_ROTATION_V2; ++slot) {
+      if (rot.length[slot] == 0) {
+        continue;
+      }
+      uint16_t *target = &rotations565[slot * MAX_LENGTH_COLOR_ROTATION];
+      target[0] = rot.length[slot];
+      target[1] = std::max<uint16_t>(1, rot.delay[slot] * 10);
+      for (uint8_t pos = 0; pos < rot.length[slot]; ++pos) {
+        target[2 + pos] = palette565[rot.first[slot] + pos];
+      }
+      v1Rotations[slot * 3] = rot.first[slot];
+      v1Rotations[slot * 3 + 1] = rot.length[slot];
+      v1Rotations[slot * 3 + 2] = rot.delay[slot];
+    }
+    colorrotations_v2.set(frameId, rotations565,
+                          MAX_COLOR_ROTATION_V2 * MAX_LENGTH_COLOR_ROTATION);
+    colorrotations.set(frameId, v1Rotations, sizeof(v1Rotations));
+
+    const uint16_t backgroundId = backgroundIDs[frameId][0];
+    if (backgroundId < nbackgrounds) {
+      const uint8_t *background = backgroundframes[backgroundId];
+      for (size_t tk = 0; tk < framePixels; ++tk) {
+        colors565[tk] = palette565[background[tk]];
+      }
+      const uint64_t hash = HashValues(colors565.data(), framePixels);
+      std::vector<uint16_t> &candidates = backgroundsByHash[hash];
+      uint16_t newId = 0xffff;
+      for (uint16_t candidate : candidates) {
+        if (memcmp(backgroundframes_v2[candidate], colors565.data(),
+                   framePixels * sizeof(uint16_t)) == 0) {
+          newId = candidate;
+          break;
+        }
+      }
+      if (newId == 0xffff) {
+        newId = backgroundCount++;
+        backgroundframes_v2.set(newId, colors565.data(), framePixels);
+        candidates.push_back(newId);
+      }
+      uint16_t bb[4];
+      memcpy(bb, backgroundBB[frameId], sizeof(bb));
+      std::fill(mask.begin(), mask.end(), 0);
+      for (uint32_t y = bb[1]; y <= bb[3] && y < fheight; ++y) {
+        for (uint32_t x = bb[0]; x <= bb[2] && x < fwidth; ++x) {
+          mask[y * fwidth + x] = 1;
+        }
+      }
+      backgroundIDs.set(frameId, &newId, 1);
+      backgroundmask.set(frameId, mask.data(), framePixels, &backgroundIDs);
+    }
+
+    framesprites.set(
+        frameId,
+        &frameSprites[static_cast<size_t>(frameId) * MAX_SPRITES_PER_FRAME],
+        MAX_SPRITES_PER_FRAME);
+  }
+
+  spriteoriginal.clear();
+  spriteoriginal_opaque.clear();
+  spritecolored.clear();
+  spritedetdwords.clear();
+  spritedetdwordpos.clear();
+  spritedetareas.clear();
+  for (uint32_t variant = 0; variant < variantSource.size(); ++variant) {
+    const V1Sprite &sprite = sprites[variantSource[variant]];
+    spriteoriginal.set(variant, sprite.original.data(), spritePixels);
+    spriteoriginal_opaque.set(variant, sprite.opaque.data(), spritePixels);
+    spritecolored.set(variant, variantColors[variant].data(), spritePixels);
+    spritedetdwords.set(variant, sprite.detectWords, MAX_SPRITE_DETECT_AREAS);
+    spritedetdwordpos.set(variant, sprite.detectPos, MAX_SPRITE_DETECT_AREAS);
+    spritedetareas.set(variant, sprite.detectAreas,
+                       4 * MAX_SPRITE_DETECT_AREAS);
+  }
+  nsprites = static_cast<uint32_t>(variantSource.size());
+  nbackgrounds = backgroundCount;
+
+  cframes.clear();
+  dyna4cols.clear();
+  spritedescriptionso.clear();
+  spritedescriptionso_opaque.clear();
+  spritedescriptionsc.clear();
+  backgroundframes.clear();
+  backgroundBB.clear();
+
+  dynashadowsdir.reserve(MAX_DYNA_SETS_PER_FRAME_V2);
+  dynashadowscol.reserve(MAX_DYNA_SETS_PER_FRAME_V2);
+  dynashadowsdir_extra.reserve(MAX_DYNA_SETS_PER_FRAME_V2);
+  dynashadowscol_extra.reserve(MAX_DYNA_SETS_PER_FRAME_V2);
+  dynasprite4cols.reserve(MAX_DYNA_SETS_PER_SPRITE * nocolors);
+  dynasprite4cols_extra.reserve(MAX_DYNA_SETS_PER_SPRITE * nocolors);
+  dynaspritemasks.reserve(spritePixels);
+  dynaspritemasks_extra.reserve(spritePixels);
+  sprshapemode.reserve(1);
+
+  fwidth_extra = 0;
+  fheight_extra = 0;
+  SerumVersion = SERUM_V2;
+  upconvertedV1 = true;
+  m_packingSidecarsNormalized = false;
+  BuildPackingSidecarsAndNormalize();
+  BuildSpriteRuntimeSidecars();
+  BuildColorRotationLookup();
+  Log("Serum v1 project upconverted to v2: %u frames, %u sprites, %u "
+      "backgrounds",
+      nframes, nsprites, nbackgrounds);
+  return true;
+}
+
 void SerumData::DebugLogSceneLookupSummary(const char *stage) {
+  if constexpr (!kSerumDiagnostics) {
+    return;
+  }
   const char *sceneVerbose = std::getenv("SERUM_DEBUG_SCENE_VERBOSE");
   if (!sceneVerbose || (strcmp(sceneVerbose, "1") != 0 &&
                         strcasecmp(sceneVerbose, "true") != 0 &&
@@ -869,7 +1369,8 @@ void SerumData::DebugLogSceneLookupSummary(const char *stage) {
       static_cast<uint32_t>(sceneFrameIdByTriplet.size()));
 }
 
-bool SerumData::SaveToFile(const char *filename) {
+bool SerumData::SaveToBuffer(std::vector<uint8_t> &out) {
+  SERUM_TRACE_SCOPE("SerumData::SaveToBuffer");
   try {
     BuildPackingSidecarsAndNormalize();
     RefreshPreparedLoadMetadata();
@@ -880,7 +1381,6 @@ bool SerumData::SaveToFile(const char *filename) {
       BuildSpriteRuntimeSidecars();
     }
     DebugLogSceneLookupSummary("pre-save");
-    Log("Writing %s", filename);
     // Serialize to memory buffer first
     std::ostringstream ss(std::ios::binary);
     {
@@ -892,53 +1392,66 @@ bool SerumData::SaveToFile(const char *filename) {
     // Compress data - use uint32_t for consistent sizes
     uint32_t srcLen = (uint32_t)data.size();
     mz_ulong dstLen = compressBound(srcLen);
-    std::vector<unsigned char> compressedData(dstLen);
+    const size_t headerSize = 4 + sizeof(uint16_t) + sizeof(uint32_t);
+    out.resize(headerSize + dstLen);
 
-    int status = compress2(compressedData.data(), &dstLen,
+    int status = compress2(out.data() + headerSize, &dstLen,
                            (const unsigned char *)data.data(), srcLen,
                            MZ_BEST_COMPRESSION);
 
     if (status != MZ_OK) {
       Log("Compression error: %d", status);
+      out.clear();
       return false;
     }
+    out.resize(headerSize + dstLen);
 
-    // Write compressed data to file
-    FILE *fp = fopen(filename, "wb");
-    if (!fp) {
-      Log("Failed to open %s for writing", filename);
-      return false;
-    }
-
-    // Write magic string first
-    const char magic[] = "CROM";
-    fwrite(magic, 1, 4, fp);
-
-    // Write version
+    // Magic string, version and original size ahead of the compressed data
+    memcpy(out.data(), "CROM", 4);
     uint16_t littleVersion = ToLittleEndian16(concentrateFileVersion);
-    fwrite(&littleVersion, sizeof(uint16_t), 1, fp);
-
-    // Write original size
-    uint32_t littleEndianSize =
-        ToLittleEndian32((uint32_t)srcLen);  // Use srcLen directly
-    fwrite(&littleEndianSize, sizeof(uint32_t), 1, fp);
-
-    // Write compressed data
-    fwrite(compressedData.data(), 1, dstLen, fp);
-    fclose(fp);
-
-    Log("Writing %s finished", filename);
+    memcpy(out.data() + 4, &littleVersion, sizeof(uint16_t));
+    uint32_t littleEndianSize = ToLittleEndian32((uint32_t)srcLen);
+    memcpy(out.data() + 4 + sizeof(uint16_t), &littleEndianSize,
+           sizeof(uint32_t));
     return true;
   } catch (const std::exception &e) {
-    Log("Exception when writing %s: %s", filename, e.what());
+    Log("Exception when serializing cROMc: %s", e.what());
+    out.clear();
     return false;
   } catch (...) {
+    Log("Failed to serialize cROMc");
+    out.clear();
+    return false;
+  }
+}
+
+bool SerumData::SaveToFile(const char *filename) {
+  SERUM_TRACE_SCOPE("SerumData::SaveToFile");
+  Log("Writing %s", filename);
+  std::vector<uint8_t> buffer;
+  if (!SaveToBuffer(buffer)) {
+    return false;
+  }
+
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    Log("Failed to open %s for writing", filename);
+    return false;
+  }
+  const bool written =
+      fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+  fclose(fp);
+  if (!written) {
     Log("Failed to write %s", filename);
     return false;
   }
+
+  Log("Writing %s finished", filename);
+  return true;
 }
 
 bool SerumData::LoadFromFile(const char *filename, const uint8_t flags) {
+  SERUM_TRACE_SCOPE("SerumData::LoadFromFile");
   m_loadFlags = flags;
   m_packingSidecarsNormalized = false;
   const bool loadTimingEnabled = IsLoadTimingEnabled();
@@ -1098,6 +1611,7 @@ bool SerumData::LoadFromFile(const char *filename, const uint8_t flags) {
 
 bool SerumData::LoadFromBuffer(const uint8_t *data, size_t size,
                                const uint8_t flags) {
+  SERUM_TRACE_SCOPE("SerumData::LoadFromBuffer");
   m_loadFlags = flags;
   m_packingSidecarsNormalized = false;
   const bool loadTimingEnabled = IsLoadTimingEnabled();
@@ -125,6 +125,7 @@ class SerumData {
 
   void Clear();
   bool SaveToFile(const char *filename);
+  bool SaveToBuffer(std::vector<uint8_t> &out);
   bool LoadFromFile(const char *filename, const uint8_t flags);
   bool LoadFromBuffer(const uint8_t *data, size_t size, const uint8_t flags);
   void BuildPackingSidecarsAndNormalize();
@@ -139,7 +140,17 @@ class SerumData {
                            uint16_t &rotationIndex,
                            uint16_t &positionInRotation) const;
   void LogSparseVectorProfileSnapshot();
+  void InternSparseVectorPayloads();
   void DebugLogSceneLookupSummary(const char *stage);
+  // Rewrites a loaded v1 project into the v2 representation so it runs on
+  // the v2 colorization path. Returns false and leaves the data untouched
+  // if the project can't be expressed exactly in v2.
+  bool UpconvertV1ToV2();
+  // Upconverted projects keep the v1 palettes and rotations for the v1
+  // compatible output; native v2 projects never fill them.
+  bool IsUpconvertedV1() const {
+    return SerumVersion == SERUM_V2 && upconvertedV1;
+  }
 
   // Header data
   char rname[64];
@@ -153,6 +164,7 @@ class SerumData {
   uint32_t nsprites;
   uint16_t nbackgrounds;
   bool is256x64;
+  bool upconvertedV1;  // set by UpconvertV1ToV2(), stored since cROMc v12
 
   // Vector data
   SparseVector<uint32_t> hashcodes;
@@ -249,11 +261,91 @@ class SerumData {
   uint8_t m_loadFlags = 0;
   bool m_packingSidecarsNormalized = false;
   std::vector<std::vector<uint8_t>> m_packingSidecarsStorage;
+  SparsePayloadStore m_payloadStore;
+
+  template <typename Fn>
+  void ForEachSparseVector(Fn &&fn) {
+    fn(hashcodes);
+    fn(shapecompmode);
+    fn(compmaskID);
+    fn(movrctID);
+    fn(compmasks);
+    fn(movrcts);
+    fn(cpal);
+    fn(isextraframe);
+    fn(cframes);
+    fn(cframes_v2);
+    fn(cframes_v2_extra);
+    fn(dynamasks);
+    fn(dynamasks_active);
+    fn(dynamasks_extra);
+    fn(dynamasks_extra_active);
+    fn(dyna4cols);
+    fn(dyna4cols_v2);
+    fn(dyna4cols_v2_extra);
+    fn(framesprites);
+    fn(spritedescriptionso);
+    fn(spritedescriptionso_opaque);
+    fn(spritedescriptionsc);
+    fn(isextrasprite);
+    fn(spriteoriginal);
+    fn(spriteoriginal_opaque);
+    fn(spritemask_extra);
+    fn(spritemask_extra_opaque);
+    fn(spritecolored);
+    fn(spritecolored_extra);
+    fn(activeframes);
+    fn(colorrotations);
+    fn(colorrotations_v2);
+    fn(colorrotations_v2_extra);
+    fn(spritedetdwords);
+    fn(spritedetdwordpos);
+    fn(spritedetareas);
+    fn(triggerIDs);
+    fn(framespriteBB);
+    fn(isextrabackground);
+    fn(backgroundframes);
+    fn(backgroundframes_v2);
+    fn(backgroundframes_v2_extra);
+    fn(backgroundIDs);
+    fn(backgroundBB);
+    fn(backgroundmask);
+    fn(backgroundmask_extra);
+    fn(dynashadowsdir);
+    fn(dynashadowscol);
+    fn(dynashadowsdir_extra);
+    fn(dynashadowscol_extra);
+    fn(dynasprite4cols);
+    fn(dynasprite4cols_extra);
+    fn(dynaspritemasks);
+    fn(dynaspritemasks_active);
+    fn(dynaspritemasks_extra);
+    fn(dynaspritemasks_extra_active);
+    fn(sprshapemode);
+  }
 
   friend class cereal::access;
 
   template <class Archive>
   void serialize(Archive &ar) {
+    sparse_vector_serialization::SetArchiveVersion(concentrateFileVersion);
+
+    // Since v8 all sparse vector payloads live in one content-addressed store
+    // that is written ahead of the vectors; the vectors only keep offsets.
+    if constexpr (Archive::is_saving::value) {
+      backgroundframes_v2.enableTileEncoding(fwidth);
+      backgroundframes_v2_extra.enableTileEncoding(fwidth_extra);
+      if (concentrateFileVersion >= 8) {
+        InternSparseVectorPayloads();
+        ar(m_payloadStore.blob);
+      }
+    } else {
+      m_payloadStore.clear();
+      if (concentrateFileVersion >= 8) {
+        ar(m_payloadStore.blob);
+      }
+    }
+
     ar(rname, SerumVersion, fwidth, fheight, fwidth_extra, fheight_extra,
        nframes, nocolors, nccolors, ncompmasks, nmovmasks, nsprites,
        nbackgrounds, is256x64, hashcodes, shapecompmode, compmaskID, movrctID,
@@ -270,6 +362,9 @@ class SerumData {
        dynashadowsdir_extra, dynashadowscol_extra, dynasprite4cols,
        dynasprite4cols_extra, dynaspritemasks, dynaspritemasks_extra,
        sprshapemode);
+    if (concentrateFileVersion >= 12) {
+      ar(upconvertedV1);
+    }
 
     if constexpr (Archive::is_saving::value) {
       if (concentrateFileVersion >= 6) {
@@ -459,6 +554,11 @@ class SerumData {
         isextrasprite.clearIndex();
       }
 
+      if (concentrateFileVersion >= 8) {
+        ForEachSparseVector(
+            [this](auto &vec) { vec.bindSharedPayloads(m_payloadStore); });
+      }
+
       cframes_v2_extra.setParent(&isextraframe);
       dynamasks_extra.setParent(&isextraframe);
       dynamasks_extra_active.setParent(&isextraframe);
@@ -0,0 +1,116 @@
+#include "SharedOutputRing.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32) || defined(__ANDROID__)
+
+bool SharedOutputRing::Open(const char*, uint32_t) {
+  errno = ENOSYS;
+  return false;
+}
+
+void SharedOutputRing::Close() {}
+
+void SharedOutputRing::Publish(const Serum_Frame_Struc&, uint32_t, uint32_t,
+                               uint32_t) {}
+
+#else
+
+bool SharedOutputRing::Open(const char* name, uint32_t slotCount) {
+  Close();
+  if (!name || slotCount == 0) {
+    errno = EINVAL;
+    return false;
+  }
+  const size_t size = Serum_Shm_SegmentSize(slotCount);
+  // Never reuse a segment left under this name: truncating it would make
+  // its readers fault, and it may belong to another writer.
+  shm_unlink(name);
+  const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) return false;
+  if (ftruncate(fd, (off_t)size) != 0) {
+    const int error = errno;
+    close(fd);
+    shm_unlink(name);
+    errno = error;
+    return false;
+  }
+  void* map =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int error = errno;
+  close(fd);
+  if (map == MAP_FAILED) {
+    shm_unlink(name);
+    errno = error;
+    return false;
+  }
+
+  m_header = static_cast<Serum_Shm_Header*>(map);
+  m_size = size;
+  m_next = 0;
+  m_name = name;
+  m_header->version = SERUM_SHM_VERSION;
+  m_header->slotCount = slotCount;
+  m_header->slotSize = sizeof(Serum_Shm_Slot);
+  m_header->published.store(0, std::memory_order_relaxed);
+  m_header->magic.store(SERUM_SHM_MAGIC, std::memory_order_release);
+  return true;
+}
+
+void SharedOutputRing::Close() {
+  if (!m_header) return;
+  munmap(m_header, m_size);
+  shm_unlink(m_name.c_str());
+  m_header = nullptr;
+  m_size = 0;
+  m_name.clear();
+}
+
+void SharedOutputRing::Publish(const Serum_Frame_Struc& frame,
+                               uint32_t width, uint32_t height,
+                               uint32_t result) {
+  if (!m_header) return;
+  const uint64_t n = m_next++;
+  Serum_Shm_Slot& slot =
+      Serum_Shm_Slots(m_header)[n % m_header->slotCount];
+
+  slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+  // Orders the odd sequence before the data writes for readers that check
+  // it again after reading.
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestampNs =
+      (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  slot.result = result;
+  slot.frameID = frame.frameID;
+  slot.triggerID = frame.triggerID;
+  slot.rotationtimer = frame.rotationtimer;
+  slot.width32 = 0;
+  slot.width64 = 0;
+  slot.width = 0;
+  slot.height = 0;
+  if (frame.frame32 && frame.width32 <= SERUM_SHM_MAX_WIDTH) {
+    slot.width32 = frame.width32;
+    memcpy(slot.frame32, frame.frame32,
+           32 * frame.width32 * sizeof(uint16_t));
+  }
+  if (frame.frame64 && frame.width64 <= SERUM_SHM_MAX_WIDTH) {
+    slot.width64 = frame.width64;
+    memcpy(slot.frame64, frame.frame64,
+           64 * frame.width64 * sizeof(uint16_t));
+  }
+  if (frame.frame && frame.palette && width <= SERUM_SHM_MAX_WIDTH &&
+      height <= 64) {
+    slot.width = width;
+    slot.height = height;
+    memcpy(slot.frame, frame.frame, width * height);
+    memcpy(slot.palette, frame.palette, sizeof(slot.palette));
+  }
+  slot.sequence.store(2 * n + 2, std::memory_order_release);
+  m_header->published.store(n + 1, std::memory_order_release);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "serum-shm.h"
+#include "serum.h"
+
+// Writer side of the shared-memory output ring described in serum-shm.h.
+// Every output change is copied into the next slot, overwriting the oldest
+// frame; the writer never waits for readers. Runs on the API thread with
+// the API mutex held. Not available on Windows and Android, where Open()
+// fails.
+class SharedOutputRing {
+ public:
+  ~SharedOutputRing() { Close(); }
+
+  // Creates the named segment with slotCount slots. A segment left under
+  // that name is unlinked first, so its readers keep their old mapping
+  // instead of seeing it resized. On failure errno tells why.
+  bool Open(const char* name, uint32_t slotCount);
+  // Unmaps and unlinks the segment; readers that have it mapped keep their
+  // mapping.
+  void Close();
+  bool IsOpen() const { return m_header != nullptr; }
+
+  // width and height give the size of the v1 frame, 0 for v2 content.
+  void Publish(const Serum_Frame_Struc& frame, uint32_t width, uint32_t height,
+               uint32_t result);
+
+ private:
+  Serum_Shm_Header* m_header = nullptr;
+  size_t m_size = 0;
+  uint64_t m_next = 0;  // number of the next frame
+  std::string m_name;
+};
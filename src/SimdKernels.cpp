@@ -0,0 +1,581 @@
+#include "SimdKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "Diagnostics.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERUM_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define SERUM_SIMD_AVX2
+#define SERUM_SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define SERUM_SIMD_AVX2
+#define SERUM_SIMD_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SERUM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Scalar reference kernels, also used for the tails of the vector ones.
+
+bool IsZeroScalar(const uint8_t* data, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    if (data[i] != 0) return false;
+  }
+  return true;
+}
+
+void BuildShapeScalar(const uint8_t* frame, uint8_t* shape, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    shape[i] = frame[i] > 0 ? 1 : 0;
+  }
+}
+
+void ComposeStaticScalar(uint16_t* dst, const uint16_t* colors,
+                         const uint16_t* background, const uint8_t* frame,
+                         const uint8_t* mask, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    dst[i] = (frame[i] == 0 && mask[i] > 0) ? background[i] : colors[i];
+  }
+}
+
+void ClearRotationsScalar(uint16_t* rotations, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    rotations[i * 2] = 0xffff;
+  }
+}
+
+void BlendSpriteScalar(uint16_t* dst, uint16_t* rotations, const uint16_t* src,
+                       const uint8_t* opaque, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    if (opaque[i] > 0) {
+      dst[i] = src[i];
+      rotations[i * 2] = 0xffff;
+    }
+  }
+}
+
+void SwapBytes16Scalar(uint16_t* dst, const uint16_t* src, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    dst[i] = (uint16_t)((src[i] << 8) | (src[i] >> 8));
+  }
+}
+
+inline uint8_t Expand5(uint32_t v) { return (uint8_t)((v << 3) | (v >> 2)); }
+inline uint8_t Expand6(uint32_t v) { return (uint8_t)((v << 2) | (v >> 4)); }
+
+void Rgb565ToRgb888Scalar(uint8_t* dst, const uint16_t* src, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    const uint32_t p = src[i];
+    dst[i * 3] = Expand5(p >> 11);
+    dst[i * 3 + 1] = Expand6((p >> 5) & 0x3f);
+    dst[i * 3 + 2] = Expand5(p & 0x1f);
+  }
+}
+
+void Rgb565ToRgba8888Scalar(uint8_t* dst, const uint16_t* src, uint32_t n,
+                            bool bgra) {
+  const uint32_t r = bgra ? 2 : 0;
+  for (uint32_t i = 0; i < n; i++) {
+    const uint32_t p = src[i];
+    dst[i * 4 + r] = Expand5(p >> 11);
+    dst[i * 4 + 1] = Expand6((p >> 5) & 0x3f);
+    dst[i * 4 + (2 - r)] = Expand5(p & 0x1f);
+    dst[i * 4 + 3] = 0xff;
+  }
+}
+
+constexpr SimdKernels kScalarKernels = {
+    "scalar",
+    &IsZeroScalar,
+    &BuildShapeScalar,
+    &ComposeStaticScalar,
+    &ClearRotationsScalar,
+    &BlendSpriteScalar,
+    &SwapBytes16Scalar,
+    &Rgb565ToRgb888Scalar,
+    &Rgb565ToRgba8888Scalar,
+};
+
+#ifdef SERUM_SIMD_SSE2
+
+bool IsZeroSse2(const uint8_t* data, uint32_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xffff) return false;
+  }
+  return IsZeroScalar(data + i, n - i);
+}
+
+void BuildShapeSse2(const uint8_t* frame, uint8_t* shape, uint32_t n) {
+  const __m128i one = _mm_set1_epi8(1);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(shape + i),
+                     _mm_min_epu8(v, one));
+  }
+  BuildShapeScalar(frame + i, shape + i, n - i);
+}
+
+// 0xffff for each of the 8 pixels where the byte is 0.
+inline __m128i ZeroMask16Sse2(const uint8_t* bytes) {
+  const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes));
+  const __m128i isZero = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+  return _mm_unpacklo_epi8(isZero, isZero);
+}
+
+void ComposeStaticSse2(uint16_t* dst, const uint16_t* colors,
+                       const uint16_t* background, const uint8_t* frame,
+                       const uint8_t* mask, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i useBackground =
+        _mm_andnot_si128(ZeroMask16Sse2(mask + i), ZeroMask16Sse2(frame + i));
+    const __m128i c =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(_mm_and_si128(useBackground, b),
+                                  _mm_andnot_si128(useBackground, c)));
+  }
+  ComposeStaticScalar(dst + i, colors + i, background + i, frame + i, mask + i,
+                      n - i);
+}
+
+// The rotation entries are (slot, position) pairs; on little-endian targets
+// or-ing 0x0000ffff into each 32-bit pair sets the slot to 0xffff.
+void ClearRotationsSse2(uint16_t* rotations, uint32_t n) {
+  const __m128i slotBits = _mm_set1_epi32(0x0000ffff);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(rotations + i * 2);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), slotBits));
+  }
+  ClearRotationsScalar(rotations + i * 2, n - i);
+}
+
+void BlendSpriteSse2(uint16_t* dst, uint16_t* rotations, const uint16_t* src,
+                     const uint8_t* opaque, uint32_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i isOpaque = _mm_xor_si128(ZeroMask16Sse2(opaque + i),
+                                           _mm_set1_epi16(-1));
+    const __m128i s =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+    _mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(isOpaque, s),
+                                     _mm_andnot_si128(isOpaque,
+                                                      _mm_loadu_si128(d))));
+    __m128i* r = reinterpret_cast<__m128i*>(rotations + i * 2);
+    _mm_storeu_si128(r, _mm_or_si128(_mm_loadu_si128(r),
+                                     _mm_unpacklo_epi16(isOpaque, zero)));
+    _mm_storeu_si128(r + 1, _mm_or_si128(_mm_loadu_si128(r + 1),
+                                         _mm_unpackhi_epi16(isOpaque, zero)));
+  }
+  BlendSpriteScalar(dst + i, rotations + i * 2, src + i, opaque + i, n - i);
+}
+
+void SwapBytes16Sse2(uint16_t* dst, const uint16_t* src, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+  }
+  SwapBytes16Scalar(dst + i, src + i, n - i);
+}
+
+// Expands 8 RGB565 pixels to one 8-bit channel value per 16-bit lane.
+inline void Expand565Sse2(__m128i p, __m128i& r, __m128i& g, __m128i& b) {
+  const __m128i r5 = _mm_srli_epi16(p, 11);
+  const __m128i g6 = _mm_and_si128(_mm_srli_epi16(p, 5), _mm_set1_epi16(0x3f));
+  const __m128i b5 = _mm_and_si128(p, _mm_set1_epi16(0x1f));
+  r = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+  g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+  b = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+}
+
+// RGB888 needs a byte shuffle SSE2 doesn't have; the scalar loop is used.
+void Rgb565ToRgba8888Sse2(uint8_t* dst, const uint16_t* src, uint32_t n,
+                          bool bgra) {
+  const __m128i alpha = _mm_set1_epi16((short)0xff00);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i r, g, b;
+    Expand565Sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)),
+                  r, g, b);
+    if (bgra) std::swap(r, b);
+    const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    const __m128i ba = _mm_or_si128(b, alpha);
+    __m128i* d = reinterpret_cast<__m128i*>(dst + i * 4);
+    _mm_storeu_si128(d, _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(rg, ba));
+  }
+  Rgb565ToRgba8888Scalar(dst + i * 4, src + i, n - i, bgra);
+}
+
+constexpr SimdKernels kSse2Kernels = {
+    "sse2",
+    &IsZeroSse2,
+    &BuildShapeSse2,
+    &ComposeStaticSse2,
+    &ClearRotationsSse2,
+    &BlendSpriteSse2,
+    &SwapBytes16Sse2,
+    &Rgb565ToRgb888Scalar,
+    &Rgb565ToRgba8888Sse2,
+};
+
+#endif  // SERUM_SIMD_SSE2
+
+#ifdef SERUM_SIMD_AVX2
+
+SERUM_SIMD_AVX2_TARGET bool IsZeroAvx2(const uint8_t* data, uint32_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) != -1) return false;
+  }
+  return IsZeroScalar(data + i, n - i);
+}
+
+SERUM_SIMD_AVX2_TARGET void BuildShapeAvx2(const uint8_t* frame,
+                                           uint8_t* shape, uint32_t n) {
+  const __m256i one = _mm256_set1_epi8(1);
+  uint32_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(frame + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(shape + i),
+                        _mm256_min_epu8(v, one));
+  }
+  BuildShapeScalar(frame + i, shape + i, n - i);
+}
+
+// 0xffff for each of the 16 pixels where the byte is 0.
+SERUM_SIMD_AVX2_TARGET inline __m256i ZeroMask16Avx2(const uint8_t* bytes) {
+  const __m256i v = _mm256_cvtepu8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+  return _mm256_cmpeq_epi16(v, _mm256_setzero_si256());
+}
+
+SERUM_SIMD_AVX2_TARGET void ComposeStaticAvx2(uint16_t* dst,
+                                              const uint16_t* colors,
+                                              const uint16_t* background,
+                                              const uint8_t* frame,
+                                              const uint8_t* mask, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i useBackground = _mm256_andnot_si256(
+        ZeroMask16Avx2(mask + i), ZeroMask16Avx2(frame + i));
+    const __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(background + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                        _mm256_blendv_epi8(c, b, useBackground));
+  }
+  ComposeStaticScalar(dst + i, colors + i, background + i, frame + i, mask + i,
+                      n - i);
+}
+
+SERUM_SIMD_AVX2_TARGET void ClearRotationsAvx2(uint16_t* rotations,
+                                               uint32_t n) {
+  const __m256i slotBits = _mm256_set1_epi32(0x0000ffff);
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i* p = reinterpret_cast<__m256i*>(rotations + i * 2);
+    _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p), slotBits));
+  }
+  ClearRotationsScalar(rotations + i * 2, n - i);
+}
+
+SERUM_SIMD_AVX2_TARGET void BlendSpriteAvx2(uint16_t* dst, uint16_t* rotations,
+                                            const uint16_t* src,
+                                            const uint8_t* opaque, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i isTransparent = ZeroMask16Avx2(opaque + i);
+    const __m256i s =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+    _mm256_storeu_si256(
+        d, _mm256_blendv_epi8(s, _mm256_loadu_si256(d), isTransparent));
+    // Widen the per-pixel mask to the (slot, position) pairs.
+    const __m256i isOpaque =
+        _mm256_xor_si256(isTransparent, _mm256_set1_epi16(-1));
+    const __m256i lo =
+        _mm256_cvtepu16_epi32(_mm256_castsi256_si128(isOpaque));
+    const __m256i hi =
+        _mm256_cvtepu16_epi32(_mm256_extracti128_si256(isOpaque, 1));
+    __m256i* r = reinterpret_cast<__m256i*>(rotations + i * 2);
+    _mm256_storeu_si256(r, _mm256_or_si256(_mm256_loadu_si256(r), lo));
+    _mm256_storeu_si256(r + 1, _mm256_or_si256(_mm256_loadu_si256(r + 1), hi));
+  }
+  BlendSpriteScalar(dst + i, rotations + i * 2, src + i, opaque + i, n - i);
+}
+
+SERUM_SIMD_AVX2_TARGET void SwapBytes16Avx2(uint16_t* dst, const uint16_t* src,
+                                            uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst + i),
+        _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+  }
+  SwapBytes16Scalar(dst + i, src + i, n - i);
+}
+
+SERUM_SIMD_AVX2_TARGET void Rgb565ToRgba8888Avx2(uint8_t* dst,
+                                                 const uint16_t* src,
+                                                 uint32_t n, bool bgra) {
+  const __m256i channel6 = _mm256_set1_epi16(0x3f);
+  const __m256i channel5 = _mm256_set1_epi16(0x1f);
+  const __m256i alpha = _mm256_set1_epi16((short)0xff00);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    const __m256i r5 = _mm256_srli_epi16(p, 11);
+    const __m256i g6 = _mm256_and_si256(_mm256_srli_epi16(p, 5), channel6);
+    const __m256i b5 = _mm256_and_si256(p, channel5);
+    __m256i r = _mm256_or_si256(_mm256_slli_epi16(r5, 3),
+                                _mm256_srli_epi16(r5, 2));
+    const __m256i g = _mm256_or_si256(_mm256_slli_epi16(g6, 2),
+                                      _mm256_srli_epi16(g6, 4));
+    __m256i b = _mm256_or_si256(_mm256_slli_epi16(b5, 3),
+                                _mm256_srli_epi16(b5, 2));
+    if (bgra) std::swap(r, b);
+    const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+    const __m256i ba = _mm256_or_si256(b, alpha);
+    // The unpacks work per 128-bit lane: lo holds pixels 0-3 and 8-11, hi
+    // pixels 4-7 and 12-15.
+    const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+    const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+    __m256i* d = reinterpret_cast<__m256i*>(dst + i * 4);
+    _mm256_storeu_si256(d, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(d + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  Rgb565ToRgba8888Scalar(dst + i * 4, src + i, n - i, bgra);
+}
+
+constexpr SimdKernels kAvx2Kernels = {
+    "avx2",
+    &IsZeroAvx2,
+    &BuildShapeAvx2,
+    &ComposeStaticAvx2,
+    &ClearRotationsAvx2,
+    &BlendSpriteAvx2,
+    &SwapBytes16Avx2,
+    &Rgb565ToRgb888Scalar,
+    &Rgb565ToRgba8888Avx2,
+};
+
+bool CpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return false;
+  __cpuid(info, 1);
+  // OSXSAVE and AVX, and the OS saves the YMM state.
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+  if ((_xgetbv(0) & 0x6) != 0x6) return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif  // SERUM_SIMD_AVX2
+
+#ifdef SERUM_SIMD_NEON
+
+bool IsZeroNeon(const uint8_t* data, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(data + i)) != 0) return false;
+  }
+  return IsZeroScalar(data + i, n - i);
+}
+
+void BuildShapeNeon(const uint8_t* frame, uint8_t* shape, uint32_t n) {
+  const uint8x16_t one = vdupq_n_u8(1);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    vst1q_u8(shape + i, vminq_u8(vld1q_u8(frame + i), one));
+  }
+  BuildShapeScalar(frame + i, shape + i, n - i);
+}
+
+// 0xffff for each of the 8 pixels where the byte is 0.
+inline uint16x8_t ZeroMask16Neon(const uint8_t* bytes) {
+  const uint8x8_t isZero = vceq_u8(vld1_u8(bytes), vdup_n_u8(0));
+  return vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(isZero)));
+}
+
+void ComposeStaticNeon(uint16_t* dst, const uint16_t* colors,
+                       const uint16_t* background, const uint8_t* frame,
+                       const uint8_t* mask, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t useBackground =
+        vbicq_u16(ZeroMask16Neon(frame + i), ZeroMask16Neon(mask + i));
+    vst1q_u16(dst + i, vbslq_u16(useBackground, vld1q_u16(background + i),
+                                 vld1q_u16(colors + i)));
+  }
+  ComposeStaticScalar(dst + i, colors + i, background + i, frame + i, mask + i,
+                      n - i);
+}
+
+void ClearRotationsNeon(uint16_t* rotations, uint32_t n) {
+  const uint32x4_t slotBits = vdupq_n_u32(0x0000ffff);
+  uint32_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    uint32_t* p = reinterpret_cast<uint32_t*>(rotations + i * 2);
+    vst1q_u32(p, vorrq_u32(vld1q_u32(p), slotBits));
+  }
+  ClearRotationsScalar(rotations + i * 2, n - i);
+}
+
+void BlendSpriteNeon(uint16_t* dst, uint16_t* rotations, const uint16_t* src,
+                     const uint8_t* opaque, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t isOpaque = vmvnq_u16(ZeroMask16Neon(opaque + i));
+    vst1q_u16(dst + i,
+              vbslq_u16(isOpaque, vld1q_u16(src + i), vld1q_u16(dst + i)));
+    uint32_t* r = reinterpret_cast<uint32_t*>(rotations + i * 2);
+    vst1q_u32(r, vorrq_u32(vld1q_u32(r), vmovl_u16(vget_low_u16(isOpaque))));
+    vst1q_u32(r + 4,
+              vorrq_u32(vld1q_u32(r + 4), vmovl_u16(vget_high_u16(isOpaque))));
+  }
+  BlendSpriteScalar(dst + i, rotations + i * 2, src + i, opaque + i, n - i);
+}
+
+void SwapBytes16Neon(uint16_t* dst, const uint16_t* src, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint8x16_t v = vreinterpretq_u8_u16(vld1q_u16(src + i));
+    vst1q_u16(dst + i, vreinterpretq_u16_u8(vrev16q_u8(v)));
+  }
+  SwapBytes16Scalar(dst + i, src + i, n - i);
+}
+
+// Expands 8 RGB565 pixels to 8-bit channels.
+inline uint8x8x3_t Expand565Neon(uint16x8_t p) {
+  const uint8x8_t r5 = vshrn_n_u16(p, 11);
+  const uint8x8_t g6 = vand_u8(vshrn_n_u16(p, 5), vdup_n_u8(0x3f));
+  const uint8x8_t b5 = vand_u8(vmovn_u16(p), vdup_n_u8(0x1f));
+  uint8x8x3_t rgb;
+  rgb.val[0] = vorr_u8(vshl_n_u8(r5, 3), vshr_n_u8(r5, 2));
+  rgb.val[1] = vorr_u8(vshl_n_u8(g6, 2), vshr_n_u8(g6, 4));
+  rgb.val[2] = vorr_u8(vshl_n_u8(b5, 3), vshr_n_u8(b5, 2));
+  return rgb;
+}
+
+void Rgb565ToRgb888Neon(uint8_t* dst, const uint16_t* src, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    vst3_u8(dst + i * 3, Expand565Neon(vld1q_u16(src + i)));
+  }
+  Rgb565ToRgb888Scalar(dst + i * 3, src + i, n - i);
+}
+
+void Rgb565ToRgba8888Neon(uint8_t* dst, const uint16_t* src, uint32_t n,
+                          bool bgra) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint8x8x3_t rgb = Expand565Neon(vld1q_u16(src + i));
+    uint8x8x4_t rgba;
+    rgba.val[0] = bgra ? rgb.val[2] : rgb.val[0];
+    rgba.val[1] = rgb.val[1];
+    rgba.val[2] = bgra ? rgb.val[0] : rgb.val[2];
+    rgba.val[3] = vdup_n_u8(0xff);
+    vst4_u8(dst + i * 4, rgba);
+  }
+  Rgb565ToRgba8888Scalar(dst + i * 4, src + i, n - i, bgra);
+}
+
+constexpr SimdKernels kNeonKernels = {
+    "neon",
+    &IsZeroNeon,
+    &BuildShapeNeon,
+    &ComposeStaticNeon,
+    &ClearRotationsNeon,
+    &BlendSpriteNeon,
+    &SwapBytes16Neon,
+    &Rgb565ToRgb888Neon,
+    &Rgb565ToRgba8888Neon,
+};
+
+#endif  // SERUM_SIMD_NEON
+
+// Best table for the running CPU, before any SERUM_SIMD override.
+const SimdKernels& DetectSimdKernels() {
+#ifdef SERUM_SIMD_AVX2
+  if (CpuSupportsAvx2()) return kAvx2Kernels;
+#endif
+#ifdef SERUM_SIMD_SSE2
+  return kSse2Kernels;
+#elif defined(SERUM_SIMD_NEON)
+  return kNeonKernels;
+#else
+  return kScalarKernels;
+#endif
+}
+
+}  // namespace
+
+const SimdKernels& ScalarSimdKernels() { return kScalarKernels; }
+
+const SimdKernels& SelectSimdKernels() {
+  const SimdKernels& detected = DetectSimdKernels();
+  if constexpr (kSerumDiagnostics) {
+    const char* forced = std::getenv("SERUM_SIMD");
+    if (forced && forced[0] != '\0') {
+      // Only tables the CPU can run are eligible.
+      const SimdKernels* candidates[] = {
+          &kScalarKernels,
+#ifdef SERUM_SIMD_SSE2
+          &kSse2Kernels,
+#endif
+#ifdef SERUM_SIMD_NEON
+          &kNeonKernels,
+#endif
+          &detected,
+      };
+      for (const SimdKernels* candidate : candidates) {
+        if (strcmp(candidate->name, forced) == 0) return *candidate;
+      }
+    }
+  }
+  return detected;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+// Vectorized pixel kernels of the colorization paths. One table per
+// instruction set: the scalar reference, SSE2 and AVX2 on x86, NEON on ARM.
+// SelectSimdKernels() picks the best one the running CPU supports, so a
+// single build runs the AVX2 kernels where available and still loads on
+// older CPUs. All tables give bit-identical results; with diagnostics
+// compiled in, SERUM_SIMD=scalar|sse2|avx2|neon forces one of them to
+// verify that.
+struct SimdKernels {
+  const char* name;
+
+  // True if all n bytes are 0.
+  bool (*isZero)(const uint8_t* data, uint32_t n);
+
+  // shape[i] = frame[i] > 0.
+  void (*buildShape)(const uint8_t* frame, uint8_t* shape, uint32_t n);
+
+  // dst[i] = (frame[i] == 0 && mask[i] > 0) ? background[i] : colors[i]
+  void (*composeStatic)(uint16_t* dst, const uint16_t* colors,
+                        const uint16_t* background, const uint8_t* frame,
+                        const uint8_t* mask, uint32_t n);
+
+  // Marks n pixels as not rotating: rotations[i * 2] = 0xffff, the position
+  // entries are kept.
+  void (*clearRotations)(uint16_t* rotations, uint32_t n);
+
+  // Copies the opaque pixels of a sprite row and marks them as not rotating:
+  // where opaque[i] > 0, dst[i] = src[i] and rotations[i * 2] = 0xffff.
+  void (*blendSprite)(uint16_t* dst, uint16_t* rotations, const uint16_t* src,
+                      const uint8_t* opaque, uint32_t n);
+
+  // Output format conversions of RGB565 pixels. The 5 and 6 bit channels
+  // are expanded to 8 bits by replicating their top bits.
+  // dst[i] = src[i] with its two bytes swapped.
+  void (*swapBytes16)(uint16_t* dst, const uint16_t* src, uint32_t n);
+  // 3 bytes per pixel: R, G, B.
+  void (*rgb565ToRgb888)(uint8_t* dst, const uint16_t* src, uint32_t n);
+  // 4 bytes per pixel: R, G, B, 0xff, or B, G, R, 0xff with bgra.
+  void (*rgb565ToRgba8888)(uint8_t* dst, const uint16_t* src, uint32_t n,
+                           bool bgra);
+};
+
+const SimdKernels& ScalarSimdKernels();
+const SimdKernels& SelectSimdKernels();
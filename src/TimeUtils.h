@@ -1,13 +1,52 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 
+#include "serum.h"
+
+namespace serum_time {
+
+enum class Source : uint8_t { Steady, Callback, Virtual };
+
+// Callback and user data of Serum_SetTimeSource(). Worker threads read the
+// clock without the API mutex, so the pair is published as one immutable
+// object; replaced pairs are kept until exit since a reader may still hold
+// one.
+struct CallbackSource {
+  Serum_TimeSourceCallback callback;
+  const void* userData;
+};
+
+inline std::atomic<Source> g_source{Source::Steady};
+inline std::atomic<const CallbackSource*> g_callbackSource{nullptr};
+inline std::atomic<uint32_t> g_virtualMs{0};
+
 // Monotonic millisecond clock to avoid issues from system clock jumps (e.g. NTP
 // adjustments).
-inline uint32_t GetMonotonicTimeMs() {
+inline uint32_t SteadyTimeMs() {
   return static_cast<uint32_t>(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           std::chrono::steady_clock::now().time_since_epoch())
           .count());
 }
+
+}  // namespace serum_time
+
+// Clock for rotation, scene and unknown frame timing. Reads the steady clock
+// unless Serum_SetTimeSource() or the virtual clock replaced it, so offline
+// rendering and replays can run faster than real time.
+inline uint32_t GetMonotonicTimeMs() {
+  switch (serum_time::g_source.load(std::memory_order_acquire)) {
+    case serum_time::Source::Callback: {
+      const serum_time::CallbackSource* source =
+          serum_time::g_callbackSource.load(std::memory_order_acquire);
+      return source->callback(source->userData);
+    }
+    case serum_time::Source::Virtual:
+      return serum_time::g_virtualMs.load(std::memory_order_relaxed);
+    default:
+      return serum_time::SteadyTimeMs();
+  }
+}
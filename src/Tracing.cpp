@@ -0,0 +1,96 @@
+#include "Tracing.h"
+
+#include <cstdio>
+#include <mutex>
+
+#include "PerfCounters.h"
+
+namespace serum_trace {
+
+std::atomic<bool> g_active{false};
+
+static std::mutex g_traceMutex;
+static Serum_TraceCallback g_callback = nullptr;
+static const void* g_callbackUserData = nullptr;
+static FILE* g_traceFile = nullptr;
+static bool g_traceFileHasEvents = false;
+
+static uint32_t CurrentTraceThreadId() {
+  static std::atomic<uint32_t> nextId{1};
+  thread_local const uint32_t id = nextId.fetch_add(1);
+  return id;
+}
+
+static void UpdateActive() {
+  g_active.store(g_callback != nullptr || g_traceFile != nullptr,
+                 std::memory_order_relaxed);
+}
+
+static void WriteFileEvent(const char* stage, uint32_t phase,
+                           uint64_t nowNs) {
+  // Chrome trace timestamps are microseconds; keep the steady clock origin
+  // so events line up with callback timestamps.
+  fprintf(g_traceFile,
+          "%s\n{\"name\":\"%s\",\"cat\":\"serum\",\"ph\":\"%c\","
+          "\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+          g_traceFileHasEvents ? "," : "", stage,
+          phase == SERUM_TRACE_BEGIN ? 'B' : 'E', (double)nowNs / 1000.0,
+          CurrentTraceThreadId());
+  g_traceFileHasEvents = true;
+}
+
+void Emit(const char* stage, uint32_t phase) {
+  const uint64_t nowNs = PerfCounters::NowNs();
+  Serum_TraceCallback callback;
+  const void* userData;
+  {
+    std::lock_guard<std::mutex> lock(g_traceMutex);
+    callback = g_callback;
+    userData = g_callbackUserData;
+    if (g_traceFile) {
+      WriteFileEvent(stage, phase, nowNs);
+    }
+  }
+  // Called without the lock so the callback may change the tracing setup.
+  if (callback) {
+    callback(stage, phase, nowNs, userData);
+  }
+}
+
+void SetCallback(Serum_TraceCallback callback, const void* userData) {
+  std::lock_guard<std::mutex> lock(g_traceMutex);
+  g_callback = callback;
+  g_callbackUserData = userData;
+  UpdateActive();
+}
+
+static void StopFileLocked() {
+  if (!g_traceFile) {
+    return;
+  }
+  fputs("\n],\"displayTimeUnit\":\"ns\"}\n", g_traceFile);
+  fclose(g_traceFile);
+  g_traceFile = nullptr;
+}
+
+bool StartFile(const char* filename) {
+  std::lock_guard<std::mutex> lock(g_traceMutex);
+  StopFileLocked();
+  if (filename) {
+    g_traceFile = fopen(filename, "wb");
+  }
+  if (g_traceFile) {
+    fputs("{\"traceEvents\":[", g_traceFile);
+    g_traceFileHasEvents = false;
+  }
+  UpdateActive();
+  return g_traceFile != nullptr;
+}
+
+void StopFile() {
+  std::lock_guard<std::mutex> lock(g_traceMutex);
+  StopFileLocked();
+  UpdateActive();
+}
+
+}  // namespace serum_trace
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "serum.h"
+
+// Stage begin/end events for Serum_SetTraceCallback() and the built-in Chrome
+// trace-event writer. Without SERUM_ENABLE_TRACING, SERUM_TRACE_SCOPE expands
+// to nothing and the hooks cost nothing in the pipeline.
+namespace serum_trace {
+
+// True while a callback or a trace file is installed.
+extern std::atomic<bool> g_active;
+// Set on threads whose work is not a stage of any Serum_* call, such as the
+// scene pre-render worker; their scopes emit nothing.
+inline thread_local bool g_threadSuppressed = false;
+
+void Emit(const char* stage, uint32_t phase);
+void SetCallback(Serum_TraceCallback callback, const void* userData);
+bool StartFile(const char* filename);
+void StopFile();
+
+class Scope {
+ public:
+  explicit Scope(const char* stage)
+      : m_stage(g_active.load(std::memory_order_relaxed) && !g_threadSuppressed
+                    ? stage
+                    : nullptr) {
+    if (m_stage) {
+      Emit(m_stage, SERUM_TRACE_BEGIN);
+    }
+  }
+  ~Scope() {
+    if (m_stage) {
+      Emit(m_stage, SERUM_TRACE_END);
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const char* m_stage;
+};
+
+}  // namespace serum_trace
+
+#ifdef SERUM_ENABLE_TRACING
+#define SERUM_TRACE_CONCAT_INNER(a, b) a##b
+#define SERUM_TRACE_CONCAT(a, b) SERUM_TRACE_CONCAT_INNER(a, b)
+#define SERUM_TRACE_SCOPE(stage) \
+  serum_trace::Scope SERUM_TRACE_CONCAT(serumTraceScope, __LINE__)(stage)
+#else
+#define SERUM_TRACE_SCOPE(stage) ((void)0)
+#endif
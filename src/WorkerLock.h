@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// How the worker threads (ScenePrerender, FrameQueue, RotationScheduler)
+// take the API mutex before running pipeline code. They never block on it:
+// their Stop() is called with that mutex held and joins the worker, so a
+// worker waiting for the lock would deadlock. While a Serum_* call holds
+// it, the worker backs off for kWorkerLockRetry and checks its state again.
+inline constexpr std::chrono::milliseconds kWorkerLockRetry{1};
+
+// Returns a lock owning apiMutex, or an unowned one after backOff(retry)
+// if the mutex is busy; the caller then starts over. backOff lets a worker
+// wait on its own condition variable so Stop() can wake it early.
+template <typename BackOff>
+std::unique_lock<std::recursive_mutex> TryLockWorker(
+    std::recursive_mutex& apiMutex, BackOff&& backOff) {
+  std::unique_lock<std::recursive_mutex> api(apiMutex, std::try_to_lock);
+  if (!api.owns_lock()) {
+    backOff(kWorkerLockRetry);
+  }
+  return api;
+}
+
+inline std::unique_lock<std::recursive_mutex> TryLockWorker(
+    std::recursive_mutex& apiMutex) {
+  return TryLockWorker(apiMutex, [](std::chrono::milliseconds retry) {
+    std::this_thread::sleep_for(retry);
+  });
+}
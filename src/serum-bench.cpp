@@ -0,0 +1,802 @@
+// serum_bench: throughput benchmarks against synthetic Serum v2 projects.
+//
+// Every case builds a project in memory (frames, masks, sprites, dynamic
+// zones, backgrounds, color rotations and PUP scenes), serializes it to a
+// cROMc image with SerumData::SaveToBuffer() and loads it back through
+// Serum_LoadFromBuffer(). No ROM or colorization files are needed, so the
+// numbers are comparable between machines and commits. The library runs on
+// the virtual clock, advanced by a fixed step per call, so rotations and
+// scene frames fire the same way on every run regardless of machine speed.
+//
+// Usage:
+//   serum_bench [--case NAME] [--iterations N] [--quick] [--json FILE]
+//               [--compare BASELINE.json] [--threshold PERCENT] [--list]
+//               [--capture DIR]
+//
+// --json writes all metrics as a flat JSON object that can be stored as a
+// baseline. --compare reads such a file and reports every time metric that
+// got slower by more than --threshold percent (default 10); the exit code is
+// 2 when a regression was found. --capture writes <case>.cROMc and a capture
+// of the benchmark calls as <case>.scap into DIR for serum_replay.
+
+#include <miniz/miniz.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SerumData.h"
+#include "serum-decode.h"
+#include "serum-version.h"
+
+namespace {
+
+struct BenchConfig {
+  const char* name;
+  uint32_t width;
+  uint32_t height;
+  uint32_t frames;
+  uint32_t maskBuckets;
+  uint32_t sprites;
+  uint32_t spritesPerFrame;  // sprite candidates listed on sprite frames
+  uint32_t dynamicEvery;     // every Nth frame gets dynamic zones (0 = none)
+  uint32_t backgrounds;
+  uint32_t rotationEvery;  // every Nth frame gets color rotations (0 = none)
+  bool extra;              // add an extra resolution plane
+  bool scenes;             // add PUP scenes (128x32 only)
+};
+
+const BenchConfig kCases[] = {
+    {"128x32", 128, 32, 2000, 4, 16, 4, 4, 8, 3, false, true},
+    {"128x32-extra", 128, 32, 1000, 4, 16, 4, 4, 8, 3, true, true},
+    {"128x32-plain", 128, 32, 2000, 0, 0, 0, 0, 0, 0, false, false},
+    {"192x64", 192, 64, 1000, 4, 16, 4, 4, 8, 3, false, false},
+    {"256x64-large", 256, 64, 5000, 8, 64, 8, 4, 16, 3, false, false},
+};
+
+constexpr uint32_t kNoColors = 16;
+constexpr uint16_t kSceneIdBase = 1000;
+constexpr uint32_t kScenes = 4;
+constexpr uint16_t kSceneFrames = 8;
+// Virtual clock steps: one DMD frame at 60 Hz per colorized frame and one
+// rotation delay (1 ms in the synthetic projects) per Serum_Rotate() call.
+constexpr uint32_t kFrameIntervalMs = 16;
+constexpr uint32_t kRotationStepMs = 1;
+// Wall-clock idle time between scene frames in the paced scene pass.
+constexpr uint32_t kSceneIdleMs = 2;
+
+struct MemoryReader {
+  const uint8_t* data;
+  size_t size;
+  size_t offset = 0;
+
+  bool readExact(void* dst, size_t bytes) {
+    if (bytes > size - offset) {
+      return false;
+    }
+    memcpy(dst, data + offset, bytes);
+    offset += bytes;
+    return true;
+  }
+};
+
+// Feeds a flat element table through the same path the cROM loader uses.
+template <typename T, typename U = T>
+void FillVector(SparseVector<T>& vector, size_t elementSize, uint32_t count,
+                const std::vector<T>& flat,
+                SparseVector<U>* parent = nullptr) {
+  MemoryReader reader{reinterpret_cast<const uint8_t*>(flat.data()),
+                      flat.size() * sizeof(T)};
+  vector.readFromCRomReader(elementSize, count, reader, parent);
+}
+
+uint32_t FrameHash(const uint8_t* frame, const uint8_t* mask, bool shape,
+                   uint32_t pixels) {
+  std::vector<uint8_t> hashed;
+  hashed.reserve(pixels);
+  for (uint32_t i = 0; i < pixels; ++i) {
+    if (mask && mask[i] != 0) {
+      continue;
+    }
+    hashed.push_back(shape ? (frame[i] > 0 ? 1 : 0) : frame[i]);
+  }
+  return (uint32_t)mz_crc32(MZ_CRC32_INIT, hashed.data(), hashed.size());
+}
+
+struct SpriteShape {
+  uint32_t width;
+  uint32_t height;
+};
+
+struct SyntheticProject {
+  std::unique_ptr<SerumData> data;
+  std::vector<std::vector<uint8_t>> inputFrames;  // normal frames, play order
+  uint32_t sceneCount = 0;
+};
+
+void FillRect(std::vector<uint8_t>& plane, uint32_t stride, uint32_t x,
+              uint32_t y, uint32_t w, uint32_t h, uint8_t value) {
+  for (uint32_t ty = y; ty < y + h; ++ty) {
+    memset(&plane[ty * stride + x], value, w);
+  }
+}
+
+SyntheticProject BuildProject(const BenchConfig& config) {
+  SyntheticProject project;
+  project.data = std::make_unique<SerumData>();
+  SerumData& d = *project.data;
+  std::mt19937 rng(0x5E2B0001u ^ config.frames ^ (config.width << 16));
+  auto random = [&rng](uint32_t bound) {
+    return bound ? (uint32_t)(rng() % bound) : 0u;
+  };
+
+  const uint32_t w = config.width;
+  const uint32_t h = config.height;
+  const uint32_t pixels = w * h;
+  const uint32_t we = config.extra ? (h == 32 ? w * 2 : w / 2) : 0;
+  const uint32_t he = config.extra ? (h == 32 ? 64 : 32) : 0;
+  const uint32_t pixelsExtra = we * he;
+  const bool scenes = config.scenes && w == 128 && h == 32;
+
+  // PUP scene frames are generated with the same generator the runtime uses
+  // and appended behind the normal frames.
+  std::vector<std::vector<uint8_t>> sceneFrames;
+  std::vector<SceneData> sceneData;
+  if (scenes) {
+    for (uint32_t s = 0; s < kScenes; ++s) {
+      SceneData scene{};
+      scene.sceneId = (uint16_t)(kSceneIdBase + s);
+      scene.frameCount = kSceneFrames;
+      scene.durationPerFrame = 0;
+      scene.interruptable = true;
+      scene.immediateStart = true;
+      scene.repeat = 0;
+      sceneData.push_back(scene);
+    }
+    SceneGenerator generator;
+    generator.setSceneData(sceneData);
+    generator.setDepth(kNoColors == 16 ? 4 : 2);
+    for (const SceneData& scene : sceneData) {
+      for (uint16_t f = 0; f < scene.frameCount; ++f) {
+        std::vector<uint8_t> frame(128 * 32);
+        generator.generateFrame(scene.sceneId, f, frame.data(), -1, true);
+        sceneFrames.push_back(std::move(frame));
+      }
+    }
+    project.sceneCount = kScenes;
+  }
+
+  const uint32_t normalFrames = config.frames;
+  const uint32_t nframes = normalFrames + (uint32_t)sceneFrames.size();
+
+  strncpy(d.rname, config.name, sizeof(d.rname) - 1);
+  d.SerumVersion = SERUM_V2;
+  d.concentrateFileVersion = SERUM_CONCENTRATE_VERSION;
+  d.fwidth = w;
+  d.fheight = h;
+  d.fwidth_extra = we;
+  d.fheight_extra = he;
+  d.nframes = nframes;
+  d.nocolors = kNoColors;
+  d.nccolors = kNoColors;
+  d.ncompmasks = config.maskBuckets;
+  d.nmovmasks = 0;
+  d.nsprites = config.sprites;
+  d.nbackgrounds = (uint16_t)config.backgrounds;
+  d.is256x64 = false;
+
+  // Comparison masks hide a random block in the lower half of the frame.
+  std::vector<uint8_t> compmasks((size_t)config.maskBuckets * pixels, 0);
+  for (uint32_t m = 0; m < config.maskBuckets; ++m) {
+    std::vector<uint8_t> mask(pixels, 0);
+    const uint32_t mw = 8 + random(w / 2);
+    const uint32_t mh = 2 + random(h / 2 - 2);
+    FillRect(mask, w, random(w - mw), h / 2 + random(h / 2 - mh), mw, mh, 1);
+    memcpy(&compmasks[(size_t)m * pixels], mask.data(), pixels);
+  }
+
+  // Sprites: opaque rectangles, detected by the first dword of their top row.
+  std::vector<SpriteShape> spriteShapes(config.sprites);
+  const size_t spritePixels = MAX_SPRITE_WIDTH * MAX_SPRITE_HEIGHT;
+  std::vector<uint8_t> spriteOriginal((size_t)config.sprites * spritePixels,
+                                      255);
+  std::vector<uint16_t> spriteColored((size_t)config.sprites * spritePixels, 0);
+  std::vector<uint32_t> spriteDetDwords(
+      (size_t)config.sprites * MAX_SPRITE_DETECT_AREAS, 0);
+  std::vector<uint16_t> spriteDetDwordPos(
+      (size_t)config.sprites * MAX_SPRITE_DETECT_AREAS, 0);
+  std::vector<uint16_t> spriteDetAreas(
+      (size_t)config.sprites * MAX_SPRITE_DETECT_AREAS * 4, 0xffff);
+  for (uint32_t s = 0; s < config.sprites; ++s) {
+    SpriteShape& shape = spriteShapes[s];
+    shape.width = 6 + random(std::min(16u, w / 4));
+    shape.height = 4 + random(std::min(8u, h / 4));
+    uint8_t* original = &spriteOriginal[s * spritePixels];
+    uint16_t* colored = &spriteColored[s * spritePixels];
+    for (uint32_t y = 0; y < shape.height; ++y) {
+      for (uint32_t x = 0; x < shape.width; ++x) {
+        original[y * MAX_SPRITE_WIDTH + x] =
+            (uint8_t)(1 + random(kNoColors - 1));
+        colored[y * MAX_SPRITE_WIDTH + x] = (uint16_t)rng();
+      }
+    }
+    spriteDetDwords[s * MAX_SPRITE_DETECT_AREAS] =
+        (uint32_t)original[0] | ((uint32_t)original[1] << 8) |
+        ((uint32_t)original[2] << 16) | ((uint32_t)original[3] << 24);
+    uint16_t* area = &spriteDetAreas[s * MAX_SPRITE_DETECT_AREAS * 4];
+    area[0] = 0;
+    area[1] = 0;
+    area[2] = (uint16_t)shape.width;
+    area[3] = (uint16_t)shape.height;
+  }
+
+  std::vector<uint8_t> backgroundIsExtra(config.backgrounds,
+                                         config.extra ? 1 : 0);
+  std::vector<uint16_t> backgroundFrames((size_t)config.backgrounds * pixels);
+  std::vector<uint16_t> backgroundFramesExtra((size_t)config.backgrounds *
+                                              pixelsExtra);
+  for (uint16_t& c : backgroundFrames) c = (uint16_t)rng();
+  for (uint16_t& c : backgroundFramesExtra) c = (uint16_t)rng();
+
+  std::vector<uint32_t> hashcodes(nframes);
+  std::vector<uint8_t> shapecompmode(nframes, 0);
+  std::vector<uint8_t> compmaskID(nframes, 255);
+  std::vector<uint8_t> isextraframe(nframes, config.extra ? 1 : 0);
+  std::vector<uint16_t> cframes((size_t)nframes * pixels);
+  std::vector<uint16_t> cframesExtra((size_t)nframes * pixelsExtra);
+  std::vector<uint8_t> dynamasks((size_t)nframes * pixels, 255);
+  std::vector<uint8_t> dynamasksExtra((size_t)nframes * pixelsExtra, 255);
+  const size_t dynaColors = MAX_DYNA_SETS_PER_FRAME_V2 * kNoColors;
+  std::vector<uint16_t> dyna4cols((size_t)nframes * dynaColors, 0);
+  std::vector<uint16_t> dyna4colsExtra((size_t)nframes * dynaColors, 0);
+  std::vector<uint8_t> framesprites((size_t)nframes * MAX_SPRITES_PER_FRAME,
+                                    255);
+  std::vector<uint16_t> framespriteBB(
+      (size_t)nframes * MAX_SPRITES_PER_FRAME * 4, 0);
+  std::vector<uint8_t> activeframes(nframes, 1);
+  const size_t rotationSize = MAX_LENGTH_COLOR_ROTATION * MAX_COLOR_ROTATION_V2;
+  std::vector<uint16_t> rotations((size_t)nframes * rotationSize, 0);
+  std::vector<uint32_t> triggerIDs(nframes, 0xffffffff);
+  std::vector<uint16_t> backgroundIDs(nframes, 0xffff);
+  std::vector<uint8_t> backgroundMask((size_t)nframes * pixels, 0);
+  std::vector<uint8_t> backgroundMaskExtra((size_t)nframes * pixelsExtra, 0);
+
+  for (uint32_t id = 0; id < nframes; ++id) {
+    std::vector<uint8_t> frame(pixels, 0);
+    const bool isScene = id >= normalFrames;
+    if (isScene) {
+      frame = sceneFrames[id - normalFrames];
+    } else {
+      const uint32_t blocks = 4 + random(8);
+      for (uint32_t b = 0; b < blocks; ++b) {
+        const uint32_t bw = 2 + random(w / 4);
+        const uint32_t bh = 1 + random(h / 3);
+        FillRect(frame, w, random(w - bw), 1 + random(h - 1 - bh), bw, bh,
+                 (uint8_t)random(kNoColors));
+      }
+      // The top row carries the frame number so every frame hashes uniquely
+      // whatever mask or shape mode it uses.
+      for (uint32_t bit = 0; bit < 32 && bit < w; ++bit) {
+        frame[bit] = (id >> bit) & 1 ? (uint8_t)(kNoColors - 1) : 0;
+      }
+      if (config.sprites > 0 && config.spritesPerFrame > 0 && id % 3 == 0) {
+        const uint32_t count =
+            std::min<uint32_t>(config.spritesPerFrame, MAX_SPRITES_PER_FRAME);
+        const uint32_t first = random(config.sprites);
+        for (uint32_t slot = 0; slot < count; ++slot) {
+          framesprites[(size_t)id * MAX_SPRITES_PER_FRAME + slot] =
+              (uint8_t)((first + slot) % config.sprites);
+          uint16_t* bb = &framespriteBB[((size_t)id * MAX_SPRITES_PER_FRAME +
+                                         slot) *
+                                        4];
+          bb[0] = 0;
+          bb[1] = 1;
+          bb[2] = (uint16_t)(w - 1);
+          bb[3] = (uint16_t)(h - 1);
+        }
+        // Only the first candidate is really on screen.
+        const SpriteShape& shape = spriteShapes[first];
+        const uint32_t sx = random(w - shape.width);
+        const uint32_t sy = 1 + random(h - 1 - shape.height);
+        const uint8_t* original = &spriteOriginal[first * spritePixels];
+        for (uint32_t y = 0; y < shape.height; ++y) {
+          memcpy(&frame[(sy + y) * w + sx], &original[y * MAX_SPRITE_WIDTH],
+                 shape.width);
+        }
+      }
+      if (config.maskBuckets > 0 && id % (config.maskBuckets + 1) != 0) {
+        compmaskID[id] = (uint8_t)(id % (config.maskBuckets + 1) - 1);
+      }
+      if (id % 7 == 3) {
+        shapecompmode[id] = 1;
+      }
+      project.inputFrames.push_back(frame);
+    }
+
+    const uint8_t mask = compmaskID[id];
+    hashcodes[id] =
+        FrameHash(frame.data(),
+                  mask < 255 ? &compmasks[(size_t)mask * pixels] : nullptr,
+                  shapecompmode[id] > 0, pixels);
+
+    // Per-frame palette; the last four entries double as rotation colors.
+    uint16_t palette[kNoColors];
+    for (uint16_t& c : palette) c = (uint16_t)rng();
+    for (uint32_t i = 0; i < pixels; ++i) {
+      cframes[(size_t)id * pixels + i] = palette[frame[i]];
+    }
+    for (uint32_t i = 0; i < pixelsExtra; ++i) {
+      const uint32_t x = (i % we) * w / we;
+      const uint32_t y = (i / we) * h / he;
+      cframesExtra[(size_t)id * pixelsExtra + i] = palette[frame[y * w + x]];
+    }
+    if (!isScene && config.rotationEvery > 0 &&
+        id % config.rotationEvery == 0) {
+      uint16_t* rotation = &rotations[(size_t)id * rotationSize];
+      rotation[0] = 4;
+      rotation[1] = 1;
+      for (uint32_t c = 0; c < 4; ++c) {
+        rotation[2 + c] = palette[kNoColors - 4 + c];
+      }
+    }
+    if (!isScene && config.dynamicEvery > 0 && id % config.dynamicEvery == 0) {
+      std::vector<uint8_t> dyna(pixels, 255);
+      const uint32_t zones = 1 + random(3);
+      for (uint32_t z = 0; z < zones; ++z) {
+        const uint32_t zw = 8 + random(w / 3);
+        const uint32_t zh = 2 + random(h / 3);
+        FillRect(dyna, w, random(w - zw), 1 + random(h - 1 - zh), zw, zh,
+                 (uint8_t)z);
+      }
+      memcpy(&dynamasks[(size_t)id * pixels], dyna.data(), pixels);
+      for (size_t c = 0; c < dynaColors; ++c) {
+        dyna4cols[(size_t)id * dynaColors + c] = (uint16_t)rng();
+      }
+    }
+    if (!isScene && config.backgrounds > 0 && id % 4 == 1) {
+      backgroundIDs[id] = (uint16_t)(id % config.backgrounds);
+      std::vector<uint8_t> bgMask(pixels, 0);
+      FillRect(bgMask, w, 0, h / 2, w, h / 2, 1);
+      memcpy(&backgroundMask[(size_t)id * pixels], bgMask.data(), pixels);
+      memset(&backgroundMaskExtra[(size_t)id * pixelsExtra + pixelsExtra / 2],
+             1, pixelsExtra / 2);
+    }
+  }
+
+  FillVector(d.hashcodes, 1, nframes, hashcodes);
+  FillVector(d.shapecompmode, 1, nframes, shapecompmode);
+  FillVector(d.compmaskID, 1, nframes, compmaskID);
+  FillVector(d.compmasks, pixels, config.maskBuckets, compmasks);
+  FillVector(d.isextraframe, 1, nframes, isextraframe);
+  FillVector(d.cframes_v2, pixels, nframes, cframes);
+  FillVector(d.cframes_v2_extra, pixelsExtra, nframes, cframesExtra,
+             &d.isextraframe);
+  FillVector(d.dynamasks, pixels, nframes, dynamasks);
+  FillVector(d.dynamasks_extra, pixelsExtra, nframes, dynamasksExtra,
+             &d.isextraframe);
+  FillVector(d.dyna4cols_v2, dynaColors, nframes, dyna4cols);
+  FillVector(d.dyna4cols_v2_extra, dynaColors, nframes, dyna4colsExtra,
+             &d.isextraframe);
+  FillVector(d.isextrasprite, 1, config.sprites,
+             std::vector<uint8_t>(config.sprites, 0));
+  FillVector(d.framesprites, MAX_SPRITES_PER_FRAME, nframes, framesprites);
+  FillVector(d.spriteoriginal, spritePixels, config.sprites, spriteOriginal);
+  FillVector(d.spritecolored, spritePixels, config.sprites, spriteColored);
+  FillVector(d.spritemask_extra, spritePixels, config.sprites,
+             std::vector<uint8_t>((size_t)config.sprites * spritePixels, 255),
+             &d.isextrasprite);
+  FillVector(d.spritecolored_extra, spritePixels, config.sprites,
+             std::vector<uint16_t>((size_t)config.sprites * spritePixels, 0),
+             &d.isextrasprite);
+  FillVector(d.activeframes, 1, nframes, activeframes);
+  FillVector(d.colorrotations_v2, rotationSize, nframes, rotations);
+  FillVector(d.colorrotations_v2_extra, rotationSize, nframes, rotations,
+             &d.isextraframe);
+  FillVector(d.spritedetdwords, MAX_SPRITE_DETECT_AREAS, config.sprites,
+             spriteDetDwords);
+  FillVector(d.spritedetdwordpos, MAX_SPRITE_DETECT_AREAS, config.sprites,
+             spriteDetDwordPos);
+  FillVector(d.spritedetareas, 4 * MAX_SPRITE_DETECT_AREAS, config.sprites,
+             spriteDetAreas);
+  FillVector(d.triggerIDs, 1, nframes, triggerIDs);
+  FillVector(d.framespriteBB, MAX_SPRITES_PER_FRAME * 4, nframes,
+             framespriteBB, &d.framesprites);
+  FillVector(d.isextrabackground, 1, config.backgrounds, backgroundIsExtra);
+  FillVector(d.backgroundframes_v2, pixels, config.backgrounds,
+             backgroundFrames);
+  FillVector(d.backgroundframes_v2_extra, pixelsExtra, config.backgrounds,
+             backgroundFramesExtra, &d.isextrabackground);
+  FillVector(d.backgroundIDs, 1, nframes, backgroundIDs);
+  FillVector(d.backgroundmask, pixels, nframes, backgroundMask,
+             &d.backgroundIDs);
+  FillVector(d.backgroundmask_extra, pixelsExtra, nframes, backgroundMaskExtra,
+             &d.backgroundIDs);
+  const std::vector<uint8_t> noShadowDir(
+      (size_t)nframes * MAX_DYNA_SETS_PER_FRAME_V2, 0);
+  const std::vector<uint16_t> noShadowColor(
+      (size_t)nframes * MAX_DYNA_SETS_PER_FRAME_V2, 0);
+  FillVector(d.dynashadowsdir, MAX_DYNA_SETS_PER_FRAME_V2, nframes,
+             noShadowDir);
+  FillVector(d.dynashadowscol, MAX_DYNA_SETS_PER_FRAME_V2, nframes,
+             noShadowColor);
+  FillVector(d.dynashadowsdir_extra, MAX_DYNA_SETS_PER_FRAME_V2, nframes,
+             noShadowDir, &d.isextraframe);
+  FillVector(d.dynashadowscol_extra, MAX_DYNA_SETS_PER_FRAME_V2, nframes,
+             noShadowColor, &d.isextraframe);
+  const size_t spriteDynaColors = MAX_DYNA_SETS_PER_SPRITE * kNoColors;
+  FillVector(d.dynasprite4cols, spriteDynaColors, config.sprites,
+             std::vector<uint16_t>(config.sprites * spriteDynaColors, 0));
+  FillVector(d.dynasprite4cols_extra, spriteDynaColors, config.sprites,
+             std::vector<uint16_t>(config.sprites * spriteDynaColors, 0),
+             &d.isextraframe);
+  FillVector(d.dynaspritemasks, spritePixels, config.sprites,
+             std::vector<uint8_t>(config.sprites * spritePixels, 255));
+  FillVector(d.dynaspritemasks_extra, spritePixels, config.sprites,
+             std::vector<uint8_t>(config.sprites * spritePixels, 255),
+             &d.isextraframe);
+  FillVector(d.sprshapemode, 1, config.sprites,
+             std::vector<uint8_t>(config.sprites, 0));
+
+  if (scenes) {
+    d.sceneGenerator->setSceneData(sceneData);
+    d.sceneGenerator->setDepth(kNoColors == 16 ? 4 : 2);
+  }
+
+  // Play the frames in a shuffled but reproducible order.
+  std::shuffle(project.inputFrames.begin(), project.inputFrames.end(), rng);
+  return project;
+}
+
+double NowMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+double PerCallNs(const Serum_Perf_Counters& counters, uint32_t stage) {
+  const Serum_Perf_Stage& s = counters.stages[stage];
+  return s.calls ? (double)s.totalNs / (double)s.calls : 0.0;
+}
+
+using Metrics = std::map<std::string, double>;
+
+bool RunCase(const BenchConfig& config, uint32_t iterations,
+             const char* captureDir, Metrics& out) {
+  const std::string prefix = std::string(config.name) + ".";
+  double start = NowMs();
+  SyntheticProject project = BuildProject(config);
+  out[prefix + "generate_ms"] = NowMs() - start;
+
+  std::vector<uint8_t> image;
+  start = NowMs();
+  if (!project.data->SaveToBuffer(image)) {
+    fprintf(stderr, "%s: failed to serialize the synthetic project\n",
+            config.name);
+    return false;
+  }
+  out[prefix + "save_ms"] = NowMs() - start;
+  out[prefix + "cromc_bytes"] = (double)image.size();
+  project.data.reset();
+
+  const uint8_t flags = FLAG_REQUEST_32P_FRAMES | FLAG_REQUEST_64P_FRAMES;
+  Serum_SetVirtualTime(0);
+  Serum_ResetPerfCounters();
+  start = NowMs();
+  Serum_Frame_Struc* serum =
+      Serum_LoadFromBuffer(image.data(), image.size(), flags);
+  out[prefix + "load_ms"] = NowMs() - start;
+  if (!serum) {
+    fprintf(stderr, "%s: Serum_LoadFromBuffer failed: %s\n", config.name,
+            Serum_GetLastErrorMessage());
+    return false;
+  }
+  if (captureDir) {
+    const std::string base = std::string(captureDir) + "/" + config.name;
+    FILE* fp = fopen((base + ".cROMc").c_str(), "wb");
+    if (!fp || fwrite(image.data(), 1, image.size(), fp) != image.size() ||
+        !Serum_StartCapture((base + ".scap").c_str())) {
+      fprintf(stderr, "%s: failed to write the capture to %s\n", config.name,
+              captureDir);
+      if (fp) {
+        fclose(fp);
+      }
+      Serum_Dispose();
+      return false;
+    }
+    fclose(fp);
+  }
+  Serum_Perf_Counters counters{};
+  counters.size = sizeof(counters);
+
+  // Colorize: identification, sprite detection and frame/sprite rendering.
+  Serum_ResetPerfCounters();
+  uint64_t colorized = 0;
+  uint64_t missed = 0;
+  start = NowMs();
+  for (uint32_t pass = 0; pass < iterations; ++pass) {
+    for (std::vector<uint8_t>& frame : project.inputFrames) {
+      Serum_AdvanceVirtualTime(kFrameIntervalMs);
+      const uint32_t result = Serum_Colorize(frame.data());
+      ++colorized;
+      if (result == IDENTIFY_NO_FRAME) {
+        ++missed;
+      }
+    }
+  }
+  const double colorizeMs = NowMs() - start;
+  Serum_GetPerfCounters(&counters);
+  out[prefix + "colorize_ns"] = colorizeMs * 1e6 / (double)colorized;
+  out[prefix + "colorize_fps"] = (double)colorized * 1000.0 / colorizeMs;
+  out[prefix + "identify_ns"] =
+      PerCallNs(counters, SERUM_PERF_STAGE_IDENTIFY_NORMAL);
+  out[prefix + "sprite_check_ns"] =
+      PerCallNs(counters, SERUM_PERF_STAGE_SPRITE_CHECK);
+  out[prefix + "colorize_frame_ns"] =
+      PerCallNs(counters, SERUM_PERF_STAGE_COLORIZE_FRAME);
+  out[prefix + "colorize_sprite_ns"] =
+      PerCallNs(counters, SERUM_PERF_STAGE_COLORIZE_SPRITE);
+  out[prefix + "unidentified_frames"] = (double)missed;
+
+  // Rotate: stay on a frame with color rotations and spin Serum_Rotate().
+  if (config.rotationEvery > 0) {
+    Serum_ResetPerfCounters();
+    uint64_t rotated = 0;
+    const uint32_t rotateCalls = 2000 * iterations;
+    start = NowMs();
+    for (uint32_t i = 0; i < rotateCalls; ++i) {
+      if (i % 200 == 0) {
+        Serum_Colorize(project.inputFrames[(i / 200) %
+                                           project.inputFrames.size()]
+                           .data());
+      }
+      Serum_AdvanceVirtualTime(kRotationStepMs);
+      if (Serum_Rotate() &
+          (FLAG_RETURNED_V2_ROTATED32 | FLAG_RETURNED_V2_ROTATED64)) {
+        ++rotated;
+      }
+    }
+    const double rotateMs = NowMs() - start;
+    Serum_GetPerfCounters(&counters);
+    out[prefix + "rotate_ns"] = PerCallNs(counters, SERUM_PERF_STAGE_ROTATE);
+    out[prefix + "rotate_calls_per_sec"] =
+        (double)rotateCalls * 1000.0 / rotateMs;
+    out[prefix + "rotations_applied"] = (double)rotated;
+  }
+
+  // Scene render: scenes start immediately and advance on every rotate call.
+  if (project.sceneCount > 0) {
+    Serum_ResetPerfCounters();
+    uint64_t sceneFrames = 0;
+    start = NowMs();
+    for (uint32_t pass = 0; pass < 50 * iterations; ++pass) {
+      const uint16_t sceneId =
+          (uint16_t)(kSceneIdBase + pass % project.sceneCount);
+      uint32_t result = Serum_Scene_Trigger(sceneId);
+      for (uint16_t f = 0;
+           f < kSceneFrames && (result & FLAG_RETURNED_V2_SCENE); ++f) {
+        Serum_AdvanceVirtualTime(kRotationStepMs);
+        result = Serum_Rotate();
+        ++sceneFrames;
+      }
+    }
+    const double sceneMs = NowMs() - start;
+    Serum_GetPerfCounters(&counters);
+    out[prefix + "scene_render_ns"] =
+        PerCallNs(counters, SERUM_PERF_STAGE_SCENE_RENDER);
+    out[prefix + "identify_scene_ns"] =
+        PerCallNs(counters, SERUM_PERF_STAGE_IDENTIFY_SCENE);
+    out[prefix + "scene_fps"] =
+        sceneMs > 0 ? (double)sceneFrames * 1000.0 / sceneMs : 0.0;
+
+    // Same scenes with the host idling between frames like a real display
+    // loop, which is the time the scene pre-render worker runs in.
+    Serum_ResetPerfCounters();
+    for (uint32_t pass = 0; pass < 4 * iterations; ++pass) {
+      const uint16_t sceneId =
+          (uint16_t)(kSceneIdBase + pass % project.sceneCount);
+      uint32_t result = Serum_Scene_Trigger(sceneId);
+      for (uint16_t f = 0;
+           f < kSceneFrames && (result & FLAG_RETURNED_V2_SCENE); ++f) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kSceneIdleMs));
+        Serum_AdvanceVirtualTime(kRotationStepMs);
+        result = Serum_Rotate();
+      }
+    }
+    Serum_GetPerfCounters(&counters);
+    out[prefix + "scene_paced_render_ns"] =
+        PerCallNs(counters, SERUM_PERF_STAGE_SCENE_RENDER);
+  }
+
+  Serum_Dispose();
+  return true;
+}
+
+// Metrics that measure time; everything else is informational.
+bool IsTimeMetric(const std::string& key) {
+  const auto endsWith = [&key](const char* suffix) {
+    const size_t n = strlen(suffix);
+    return key.size() >= n && key.compare(key.size() - n, n, suffix) == 0;
+  };
+  return (endsWith("_ns") || endsWith("_ms")) && !endsWith("generate_ms");
+}
+
+bool WriteJson(const char* filename, const Metrics& metrics) {
+  FILE* fp = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "wb");
+  if (!fp) {
+    fprintf(stderr, "Failed to open %s for writing\n", filename);
+    return false;
+  }
+  fprintf(fp, "{\n  \"libserum\": \"%s\",\n  \"metrics\": {", SERUM_VERSION);
+  bool first = true;
+  for (const auto& [key, value] : metrics) {
+    fprintf(fp, "%s\n    \"%s\": %.3f", first ? "" : ",", key.c_str(), value);
+    first = false;
+  }
+  fprintf(fp, "\n  }\n}\n");
+  if (fp != stdout) {
+    fclose(fp);
+  }
+  return true;
+}
+
+// Reads the "key": number pairs of a file written by WriteJson().
+bool ReadJson(const char* filename, Metrics& metrics) {
+  FILE* fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Failed to open %s\n", filename);
+    return false;
+  }
+  std::string text;
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    text.append(buffer, n);
+  }
+  fclose(fp);
+
+  const size_t body = text.find("\"metrics\"");
+  size_t pos = body == std::string::npos ? 0 : text.find('{', body);
+  while (pos != std::string::npos) {
+    const size_t keyStart = text.find('"', pos);
+    if (keyStart == std::string::npos) break;
+    const size_t keyEnd = text.find('"', keyStart + 1);
+    if (keyEnd == std::string::npos) break;
+    const size_t colon = text.find(':', keyEnd);
+    if (colon == std::string::npos) break;
+    char* end = nullptr;
+    const double value = strtod(text.c_str() + colon + 1, &end);
+    if (end != text.c_str() + colon + 1) {
+      metrics[text.substr(keyStart + 1, keyEnd - keyStart - 1)] = value;
+    }
+    pos = text.find(',', colon);
+  }
+  return !metrics.empty();
+}
+
+int Compare(const Metrics& baseline, const Metrics& current,
+            double thresholdPercent, FILE* report) {
+  int regressions = 0;
+  fprintf(report, "\n%-40s %14s %14s %9s\n", "metric", "baseline", "current",
+          "change");
+  for (const auto& [key, value] : current) {
+    const auto it = baseline.find(key);
+    if (it == baseline.end() || !IsTimeMetric(key) || it->second <= 0.0) {
+      continue;
+    }
+    const double change = (value - it->second) * 100.0 / it->second;
+    const bool regressed = change > thresholdPercent;
+    fprintf(report, "%-40s %14.3f %14.3f %+8.1f%%%s\n", key.c_str(),
+            it->second, value, change, regressed ? "  REGRESSION" : "");
+    if (regressed) {
+      ++regressions;
+    }
+  }
+  fprintf(report, "\n%d regression(s) above %.1f%%\n", regressions,
+          thresholdPercent);
+  return regressions;
+}
+
+void PrintUsage(const char* argv0) {
+  printf(
+      "Usage: %s [--case NAME] [--iterations N] [--quick] [--json FILE]\n"
+      "          [--compare BASELINE.json] [--threshold PERCENT] [--list]\n"
+      "          [--capture DIR]\n",
+      argv0);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  const char* caseFilter = nullptr;
+  const char* jsonFile = nullptr;
+  const char* compareFile = nullptr;
+  const char* captureDir = nullptr;
+  uint32_t iterations = 5;
+  double threshold = 10.0;
+  bool quick = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--case" && hasValue) {
+      caseFilter = argv[++i];
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--json" && hasValue) {
+      jsonFile = argv[++i];
+    } else if (arg == "--compare" && hasValue) {
+      compareFile = argv[++i];
+    } else if (arg == "--threshold" && hasValue) {
+      threshold = atof(argv[++i]);
+    } else if (arg == "--capture" && hasValue) {
+      captureDir = argv[++i];
+    } else if (arg == "--quick") {
+      quick = true;
+    } else if (arg == "--list") {
+      for (const BenchConfig& config : kCases) {
+        printf("%-14s %ux%u frames=%u masks=%u sprites=%u backgrounds=%u%s%s\n",
+               config.name, config.width, config.height, config.frames,
+               config.maskBuckets, config.sprites, config.backgrounds,
+               config.extra ? " extra" : "", config.scenes ? " scenes" : "");
+      }
+      return 0;
+    } else {
+      PrintUsage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    }
+  }
+  if (quick) {
+    iterations = 1;
+  }
+
+  // Keeps stdout clean for the JSON when it's written there.
+  FILE* report = jsonFile && strcmp(jsonFile, "-") == 0 ? stderr : stdout;
+  Metrics metrics;
+  bool ranAny = false;
+  for (BenchConfig config : kCases) {
+    if (caseFilter && strcmp(caseFilter, config.name) != 0) {
+      continue;
+    }
+    if (quick) {
+      config.frames = std::max(50u, config.frames / 10);
+    }
+    ranAny = true;
+    Metrics caseMetrics;
+    if (!RunCase(config, iterations, captureDir, caseMetrics)) {
+      return 1;
+    }
+    fprintf(report, "%s\n", config.name);
+    for (const auto& [key, value] : caseMetrics) {
+      fprintf(report, "  %-30s %14.3f\n",
+              key.c_str() + strlen(config.name) + 1, value);
+    }
+    metrics.insert(caseMetrics.begin(), caseMetrics.end());
+  }
+  if (!ranAny) {
+    fprintf(stderr, "Unknown case %s\n", caseFilter);
+    return 1;
+  }
+
+  if (jsonFile && !WriteJson(jsonFile, metrics)) {
+    return 1;
+  }
+  if (compareFile) {
+    Metrics baseline;
+    if (!ReadJson(compareFile, baseline)) {
+      fprintf(stderr, "No metrics found in %s\n", compareFile);
+      return 1;
+    }
+    if (Compare(baseline, metrics, threshold, report) > 0) {
+      return 2;
+    }
+  }
+  return 0;
+}
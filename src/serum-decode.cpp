@@ -5,7 +5,10 @@
 #include <miniz/miniz.h>
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cctype>
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
@@ -13,15 +16,30 @@
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <random>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "FrameCapture.h"
+#include "DeltaEncoder.h"
+#include "FrameExchange.h"
+#include "FrameQueue.h"
+#include "GeometryKernels.h"
+#include "IndexedOutput.h"
+#include "RotationScheduler.h"
+#include "PerfCounters.h"
+#include "Diagnostics.h"
+#include "ScenePrerender.h"
 #include "SerumData.h"
+#include "SharedOutputRing.h"
+#include "SimdKernels.h"
 #include "TimeUtils.h"
+#include "Tracing.h"
 #include "serum-version.h"
 
 #if defined(__APPLE__)
@@ -199,14 +217,14 @@ static std::recursive_mutex g_serumApiMutex;
 
 #if defined(_WIN32) || defined(_WIN64)
 #define SERUM_API_GUARD_START(apiName)                                 \
-  ClearLastErrorMessage();                                             \
   EnsureWindowsCrashHandlerInstalled();                                \
   std::lock_guard<std::recursive_mutex> serumApiLock(g_serumApiMutex); \
+  ClearLastErrorMessage();                                             \
   try {
 #else
 #define SERUM_API_GUARD_START(apiName)                                 \
-  ClearLastErrorMessage();                                             \
   std::lock_guard<std::recursive_mutex> serumApiLock(g_serumApiMutex); \
+  ClearLastErrorMessage();                                             \
   try {
 #endif
 
@@ -242,7 +260,7 @@ static bool IsEnvFlagEnabled(const char* name) {
 }
 
 static bool IsLoadTimingEnabled() {
-  return IsEnvFlagEnabled("SERUM_PROFILE_LOAD_TIMES");
+  return kSerumDiagnostics && IsEnvFlagEnabled("SERUM_PROFILE_LOAD_TIMES");
 }
 
 static uint32_t GetEnvUintClamped(const char* name, uint32_t maxValue) {
@@ -261,23 +279,17 @@ static uint32_t GetEnvUintClamped(const char* name, uint32_t maxValue) {
   return static_cast<uint32_t>(parsed);
 }
 
-static bool g_profileDynamicHotPaths = false;
-static bool g_profileDynamicHotPathsWindowed = false;
-static bool g_profileSparseVectors = false;
-static uint64_t g_profileRoundTripNs = 0;
-static uint64_t g_profileColorizeFrameV2Ns = 0;
-static uint64_t g_profileColorizeSpriteV2Ns = 0;
-static uint64_t g_profileColorizeCalls = 0;
-static uint64_t g_profileIdentifyTotalNs = 0;
-static uint64_t g_profileIdentifyNormalNs = 0;
-static uint64_t g_profileIdentifySceneNs = 0;
-static uint64_t g_profileIdentifyCriticalNs = 0;
-static uint64_t g_profileIdentifyNormalCalls = 0;
-static uint64_t g_profileIdentifySceneCalls = 0;
-static uint64_t g_profileIdentifyCriticalCalls = 0;
-static uint64_t g_profileIncomingFrameCalls = 0;
-static uint64_t g_profileNoFrameReturns = 0;
-static uint64_t g_profileSameFrameReturns = 0;
+SERUM_DIAGNOSTIC_STATE bool g_profileDynamicHotPaths = false;
+SERUM_DIAGNOSTIC_STATE bool g_profileDynamicHotPathsWindowed = false;
+SERUM_DIAGNOSTIC_STATE bool g_profileSparseVectors = false;
+// Always-on stage counters served by Serum_GetPerfCounters(); the
+// SERUM_PROFILE_DYNAMIC_HOTPATHS log reports deltas against the baseline.
+static PerfCounters g_perfCounters;
+static PerfCounters g_profileWindowBaseline;
+// Serum_StartCapture() / SERUM_CAPTURE_FILE recording for serum_replay.
+static FrameCapture g_frameCapture;
+// Serum_SetTripleBufferedOutput() copies for a separate render thread.
+static FrameExchange g_frameExchange;
 static uint64_t g_profileLastLoggedInputCount = 0;
 static uint64_t g_profilePeakRssBytes = 0;
 static uint64_t g_profileStartupStartRssBytes = 0;
@@ -285,19 +297,21 @@ static uint64_t g_profileStartupPeakRssBytes = 0;
 static const char* g_profileStartupPeakStage = "startup-begin";
 static uint32_t g_profileFrameOperationDepth = 0;
 static bool g_profileFrameOperationFinished = false;
-static std::chrono::steady_clock::time_point g_profileFrameOperationStart;
+static uint64_t g_profileFrameOperationStartNs = 0;
 static bool g_debugFrameTracingInitialized = false;
-static bool g_profileLoadTimes = false;
-static uint32_t g_debugTargetInputCrc = 0;
-static uint32_t g_debugTargetFrameId = 0xffffffffu;
-static bool g_debugStageHashes = false;
+SERUM_DIAGNOSTIC_STATE bool g_profileLoadTimes = false;
+SERUM_DIAGNOSTIC_STATE uint32_t g_debugTargetInputCrc = 0;
+SERUM_DIAGNOSTIC_STATE uint32_t g_debugTargetFrameId = 0xffffffffu;
+SERUM_DIAGNOSTIC_STATE bool g_debugStageHashes = false;
 static uint32_t g_debugCurrentInputCrc = 0;
-static bool g_debugTraceAllInputs = false;
+SERUM_DIAGNOSTIC_STATE bool g_debugTraceAllInputs = false;
 static uint32_t g_debugFrameMetaLoggedFor = 0xffffffffu;
-static bool g_debugBypassSceneGate = false;
-static bool g_debugVerboseIdentify = false;
-static bool g_debugVerboseSprites = false;
-static bool g_debugVerboseScenes = false;
+SERUM_DIAGNOSTIC_STATE bool g_debugBypassSceneGate = false;
+SERUM_DIAGNOSTIC_STATE bool g_debugVerboseIdentify = false;
+SERUM_DIAGNOSTIC_STATE bool g_debugVerboseSprites = false;
+SERUM_DIAGNOSTIC_STATE bool g_debugVerboseScenes = false;
+// Any SERUM_DEBUG_* switch is set; the input CRC is only computed then.
+SERUM_DIAGNOSTIC_STATE bool g_debugTracingActive = false;
 static std::vector<std::pair<uint8_t, uint8_t>> g_criticalTriggerMaskShapes;
 
 static SerumData g_serumData;
@@ -360,35 +374,29 @@ extern bool cromloaded;
 extern uint32_t lastfound;
 uint32_t calc_crc32(uint8_t* source, uint8_t mask, uint32_t n, uint8_t Shape);
 uint32_t crc32_fast(uint8_t* s, uint32_t n);
+static uint32_t FrameCrc32(const uint8_t* frame, uint32_t pixels);
 static uint64_t MakeFrameSignature(uint8_t mask, uint8_t shape, uint32_t hash);
 static bool DebugTraceMatches(uint32_t inputCrc, uint32_t frameId);
 static bool DebugIdentifyVerboseEnabled();
 
 static void BeginProfileFrameOperation(void) {
-  if (!g_profileDynamicHotPaths) {
-    return;
-  }
   if (g_profileFrameOperationDepth++ == 0) {
-    g_profileFrameOperationStart = std::chrono::steady_clock::now();
+    g_profileFrameOperationStartNs = PerfCounters::NowNs();
     g_profileFrameOperationFinished = false;
   }
 }
 
 static void FinishProfileRenderedFrameOperationMaybe(void) {
-  if (!g_profileDynamicHotPaths || g_profileFrameOperationDepth == 0 ||
-      g_profileFrameOperationFinished) {
+  if (g_profileFrameOperationDepth == 0 || g_profileFrameOperationFinished) {
     return;
   }
-  g_profileRoundTripNs +=
-      (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-          std::chrono::steady_clock::now() - g_profileFrameOperationStart)
-          .count();
-  ++g_profileColorizeCalls;
+  g_perfCounters.RecordSince(SERUM_PERF_STAGE_FRAME_ROUND_TRIP,
+                             g_profileFrameOperationStartNs);
   g_profileFrameOperationFinished = true;
 }
 
 static void EndProfileFrameOperation(void) {
-  if (!g_profileDynamicHotPaths || g_profileFrameOperationDepth == 0) {
+  if (g_profileFrameOperationDepth == 0) {
     return;
   }
   --g_profileFrameOperationDepth;
@@ -398,6 +406,7 @@ static void EndProfileFrameOperation(void) {
 }
 
 static void InitCriticalTriggerLookupRuntimeState(void) {
+  SERUM_TRACE_SCOPE("InitCriticalTriggerLookupRuntimeState");
   g_criticalTriggerMaskShapes.clear();
   if (g_serumData.criticalTriggerFramesBySignature.empty()) {
     return;
@@ -417,18 +426,9 @@ static void InitCriticalTriggerLookupRuntimeState(void) {
 }
 
 static uint32_t IdentifyCriticalTriggerFrame(uint8_t* frame) {
-  const auto profileStart = g_profileDynamicHotPaths
-                                ? std::chrono::steady_clock::now()
-                                : std::chrono::steady_clock::time_point{};
+  ScopedPerfStage perfStage(g_perfCounters, SERUM_PERF_STAGE_CRITICAL_TRIGGER);
   if (!cromloaded || g_criticalTriggerMaskShapes.empty() ||
       g_serumData.criticalTriggerFramesBySignature.empty()) {
-    if (g_profileDynamicHotPaths) {
-      g_profileIdentifyCriticalNs +=
-          (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-              std::chrono::steady_clock::now() - profileStart)
-              .count();
-      ++g_profileIdentifyCriticalCalls;
-    }
     return IDENTIFY_NO_FRAME;
   }
 
@@ -442,24 +442,10 @@ static uint32_t IdentifyCriticalTriggerFrame(uint8_t* frame) {
         MakeFrameSignature(maskShape.first, maskShape.second, hash));
     if (it != g_serumData.criticalTriggerFramesBySignature.end() &&
         !it->second.empty()) {
-      if (g_profileDynamicHotPaths) {
-        g_profileIdentifyCriticalNs +=
-            (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-                std::chrono::steady_clock::now() - profileStart)
-                .count();
-        ++g_profileIdentifyCriticalCalls;
-      }
       return it->second.front();
     }
   }
 
-  if (g_profileDynamicHotPaths) {
-    g_profileIdentifyCriticalNs +=
-        (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::steady_clock::now() - profileStart)
-            .count();
-    ++g_profileIdentifyCriticalCalls;
-  }
   return IDENTIFY_NO_FRAME;
 }
 
@@ -488,6 +474,25 @@ static uint32_t SelectFrameIdInWrapOrder(const std::vector<uint32_t>& frameIds,
   return bestFrameId;
 }
 
+// Identify_Frame() hashes of a Serum_ColorizeBatch() input frame, computed
+// ahead on the batch worker threads: the CRC for every normal identify bucket
+// and the full frame CRC. Only used while identifying that same frame.
+struct PrecomputedIdentifyHashes {
+  const uint8_t* frame = nullptr;
+  const uint32_t* bucketHashes = nullptr;
+  uint32_t fullCrc = 0;
+};
+static PrecomputedIdentifyHashes g_precomputedHashes;
+
+static uint32_t InputFrameCrc32(const uint8_t* frame) {
+  if (frame == g_precomputedHashes.frame) {
+    return g_precomputedHashes.fullCrc;
+  }
+  return FrameCrc32(frame, g_serumData.is256x64
+                               ? (256 * 64)
+                               : (g_serumData.fwidth * g_serumData.fheight));
+}
+
 static uint32_t ResolveIdentifiedFrameMatch(uint8_t* frame, uint32_t inputCrc,
                                             uint32_t candidateFrameId,
                                             uint8_t mask, bool& first_match,
@@ -518,17 +523,12 @@ static uint32_t ResolveIdentifiedFrameMatch(uint8_t* frame, uint32_t inputCrc,
     }
     lastfound_stream = candidateFrameId;
     lastfound = candidateFrameId;
-    lastframe_full_crc =
-        crc32_fast(frame, g_serumData.is256x64
-                              ? (256 * 64)
-                              : (g_serumData.fwidth * g_serumData.fheight));
+    lastframe_full_crc = InputFrameCrc32(frame);
     first_match = false;
     return candidateFrameId;
   }
 
-  const uint32_t full_crc = crc32_fast(
-      frame, g_serumData.is256x64 ? (256 * 64)
-                                  : (g_serumData.fwidth * g_serumData.fheight));
+  const uint32_t full_crc = InputFrameCrc32(frame);
   if (full_crc != lastframe_full_crc) {
     if (DebugIdentifyVerboseEnabled() &&
         DebugTraceMatches(inputCrc, candidateFrameId)) {
@@ -580,6 +580,35 @@ static void ForceNormalFrameRefreshAfterSceneEnd(void);
 static bool ValidateLoadedGeometry(bool isV2, const char* sourceTag);
 uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested);
 
+static bool PrerenderSceneFrame(const ScenePrerenderJob& job,
+                                uint16_t frameIndex, ScenePrerenderChain& chain,
+                                ScenePrerenderSlot& slot);
+static ScenePrerender g_scenePrerender(g_serumApiMutex, PrerenderSceneFrame);
+static bool g_scenePrerenderEnabled = true;
+// Slot for the scene frame Serum_RenderScene() is rendering right now.
+static const ScenePrerenderSlot* g_scenePrerenderHit = nullptr;
+
+// Serum_SubmitFrame() queue; its worker colorizes through Serum_Colorize().
+static Serum_FrameDoneCallback g_frameDoneCallback = nullptr;
+static const void* g_frameDoneUserData = nullptr;
+static void ProcessQueuedFrame(uint8_t* frame, uint32_t timestampMs) {
+  const uint32_t result = Serum_Colorize(frame);
+  if (g_frameDoneCallback) {
+    g_frameDoneCallback(result, timestampMs, g_frameDoneUserData);
+  }
+}
+static FrameQueue g_frameQueue(g_serumApiMutex, ProcessQueuedFrame);
+
+// Serum_StartRotationScheduler() worker and the planes it last reported, to
+// compute the changed regions.
+static Serum_FrameReadyCallback g_frameReadyCallback = nullptr;
+static const void* g_frameReadyUserData = nullptr;
+static std::vector<uint16_t> g_scheduledPlane32;
+static std::vector<uint16_t> g_scheduledPlane64;
+static void RunScheduledRotation(void);
+static RotationScheduler g_rotationScheduler(g_serumApiMutex,
+                                             RunScheduledRotation);
+
 struct SceneResumeState {
   uint16_t nextFrame = 0;
   uint32_t timestampMs = 0;
@@ -603,7 +632,13 @@ uint32_t lasttriggerTimestamp = 0;
 bool isrotation = true;     // are there rotations to send
 bool crc32_ready = false;   // is the crc32 table filled?
 uint32_t crc32_table[256];  // initial table
-bool* framechecked = NULL;  // are these frames checked?
+// Kernels for the input frame and the 32/64 output planes of the loaded
+// project, see SelectLoadedGeometryKernels().
+static const GeometryKernels* g_frameKernels = &GenericGeometryKernels();
+static const GeometryKernels* g_plane32Kernels = &GenericGeometryKernels();
+static const GeometryKernels* g_plane64Kernels = &GenericGeometryKernels();
+// Vector kernels for the running CPU, picked at load.
+static const SimdKernels* g_simdKernels = &ScalarSimdKernels();
 uint16_t ignoreUnknownFramesTimeout = 0;
 uint8_t maxFramesToSkip = 0;
 uint8_t framesSkippedCounter = 0;
@@ -644,8 +679,14 @@ uint32_t
 
 Serum_Frame_Struc mySerum;  // structure to keep communicate colorization data
 
+// Upconverted v1 projects can also fill the v1 frame, palette and rotations
+// fields, rebuilt from the v2 output of frame g_v1CompatFrameId.
+bool g_v1CompatOutput = false;
+uint32_t g_v1CompatFrameId = 0;
+
 uint8_t* frameshape = NULL;  // memory for shape mode conversion of ythe frame
 
+#ifdef SERUM_ENABLE_DIAGNOSTICS
 static uint32_t GetEnvUint32Auto(const char* name, uint32_t defaultValue) {
   const char* value = std::getenv(name);
   if (!value || value[0] == '\0') {
@@ -658,6 +699,7 @@ static uint32_t GetEnvUint32Auto(const char* name, uint32_t defaultValue) {
   }
   return static_cast<uint32_t>(parsed);
 }
+#endif
 
 static uint64_t GetProcessResidentMemoryBytes() {
 #if defined(__APPLE__)
@@ -736,67 +778,57 @@ static void LogStartupRssSummary() {
 }
 
 static void ResetDynamicHotPathProfile() {
-  g_profileRoundTripNs = 0;
-  g_profileColorizeFrameV2Ns = 0;
-  g_profileColorizeSpriteV2Ns = 0;
-  g_profileColorizeCalls = 0;
-  g_profileIdentifyTotalNs = 0;
-  g_profileIdentifyNormalNs = 0;
-  g_profileIdentifySceneNs = 0;
-  g_profileIdentifyCriticalNs = 0;
-  g_profileIdentifyNormalCalls = 0;
-  g_profileIdentifySceneCalls = 0;
-  g_profileIdentifyCriticalCalls = 0;
-  g_profileIncomingFrameCalls = 0;
-  g_profileNoFrameReturns = 0;
-  g_profileSameFrameReturns = 0;
+  g_profileWindowBaseline = g_perfCounters;
   g_profileLastLoggedInputCount = 0;
   g_profilePeakRssBytes = GetProcessResidentMemoryBytes();
   g_profileFrameOperationDepth = 0;
   g_profileFrameOperationFinished = false;
 }
 
+// Average stage time in ms since the profile window baseline.
+static double ProfileWindowAverageMs(uint32_t stage, uint64_t calls) {
+  if (calls == 0) {
+    return 0.0;
+  }
+  const uint64_t totalNs = g_perfCounters.TotalNs(stage) -
+                           g_profileWindowBaseline.TotalNs(stage);
+  return (double)totalNs / (double)calls / 1000000.0;
+}
+
+static uint64_t ProfileWindowCalls(uint32_t stage) {
+  return g_perfCounters.Calls(stage) - g_profileWindowBaseline.Calls(stage);
+}
+
 static void MaybeLogDynamicHotPathProfileWindow(bool sceneFrameRequested) {
-  if (!g_profileDynamicHotPaths || sceneFrameRequested ||
-      g_profileIncomingFrameCalls == 0 ||
-      (g_profileIncomingFrameCalls % 240u) != 0u ||
-      g_profileIncomingFrameCalls == g_profileLastLoggedInputCount) {
+  const uint64_t inputs =
+      g_perfCounters.inputFrames - g_profileWindowBaseline.inputFrames;
+  if (!g_profileDynamicHotPaths || sceneFrameRequested || inputs == 0 ||
+      (inputs % 240u) != 0u || inputs == g_profileLastLoggedInputCount) {
     return;
   }
 
-  const double roundTripMs = g_profileColorizeCalls == 0
-                                 ? 0.0
-                                 : (double)g_profileRoundTripNs /
-                                       (double)g_profileColorizeCalls /
-                                       1000000.0;
-  const double frameMs = g_profileColorizeCalls == 0
-                             ? 0.0
-                             : (double)g_profileColorizeFrameV2Ns /
-                                   (double)g_profileColorizeCalls / 1000000.0;
-  const double spriteMs = g_profileColorizeCalls == 0
-                              ? 0.0
-                              : (double)g_profileColorizeSpriteV2Ns /
-                                    (double)g_profileColorizeCalls / 1000000.0;
-  const double identifyMs = g_profileColorizeCalls == 0
-                                ? 0.0
-                                : (double)g_profileIdentifyTotalNs /
-                                      (double)g_profileColorizeCalls /
-                                      1000000.0;
-  const double identifyNormalMs =
-      g_profileIdentifyNormalCalls == 0
-          ? 0.0
-          : (double)g_profileIdentifyNormalNs /
-                (double)g_profileIdentifyNormalCalls / 1000000.0;
-  const double identifySceneMs = g_profileIdentifySceneCalls == 0
-                                     ? 0.0
-                                     : (double)g_profileIdentifySceneNs /
-                                           (double)g_profileIdentifySceneCalls /
-                                           1000000.0;
-  const double identifyCriticalMs =
-      g_profileIdentifyCriticalCalls == 0
-          ? 0.0
-          : (double)g_profileIdentifyCriticalNs /
-                (double)g_profileIdentifyCriticalCalls / 1000000.0;
+  const uint64_t rendered =
+      ProfileWindowCalls(SERUM_PERF_STAGE_FRAME_ROUND_TRIP);
+  const uint64_t identifyNormalCalls =
+      ProfileWindowCalls(SERUM_PERF_STAGE_IDENTIFY_NORMAL);
+  const uint64_t identifySceneCalls =
+      ProfileWindowCalls(SERUM_PERF_STAGE_IDENTIFY_SCENE);
+  const double roundTripMs =
+      ProfileWindowAverageMs(SERUM_PERF_STAGE_FRAME_ROUND_TRIP, rendered);
+  const double frameMs =
+      ProfileWindowAverageMs(SERUM_PERF_STAGE_COLORIZE_FRAME, rendered);
+  const double spriteMs =
+      ProfileWindowAverageMs(SERUM_PERF_STAGE_COLORIZE_SPRITE, rendered);
+  const double identifyMs =
+      ProfileWindowAverageMs(SERUM_PERF_STAGE_IDENTIFY_NORMAL, rendered) +
+      ProfileWindowAverageMs(SERUM_PERF_STAGE_IDENTIFY_SCENE, rendered);
+  const double identifyNormalMs = ProfileWindowAverageMs(
+      SERUM_PERF_STAGE_IDENTIFY_NORMAL, identifyNormalCalls);
+  const double identifySceneMs = ProfileWindowAverageMs(
+      SERUM_PERF_STAGE_IDENTIFY_SCENE, identifySceneCalls);
+  const double identifyCriticalMs = ProfileWindowAverageMs(
+      SERUM_PERF_STAGE_CRITICAL_TRIGGER,
+      ProfileWindowCalls(SERUM_PERF_STAGE_CRITICAL_TRIGGER));
   const uint64_t rssBytes = GetProcessResidentMemoryBytes();
   if (rssBytes > g_profilePeakRssBytes) {
     g_profilePeakRssBytes = rssBytes;
@@ -810,15 +842,17 @@ static void MaybeLogDynamicHotPathProfileWindow(bool sceneFrameRequested) {
       "same=%llu noFrame=%llu rss=%.1fMiB peak=%.1fMiB",
       roundTripMs, frameMs, spriteMs, identifyMs, identifyNormalMs,
       identifySceneMs, identifyCriticalMs,
-      static_cast<unsigned long long>(g_profileIncomingFrameCalls),
-      static_cast<unsigned long long>(g_profileColorizeCalls),
-      static_cast<unsigned long long>(g_profileSameFrameReturns),
-      static_cast<unsigned long long>(g_profileNoFrameReturns), rssMiB,
-      peakRssMiB);
+      static_cast<unsigned long long>(inputs),
+      static_cast<unsigned long long>(rendered),
+      static_cast<unsigned long long>(g_perfCounters.sameFrameReturns -
+                                      g_profileWindowBaseline.sameFrameReturns),
+      static_cast<unsigned long long>(g_perfCounters.noFrameReturns -
+                                      g_profileWindowBaseline.noFrameReturns),
+      rssMiB, peakRssMiB);
   if (g_profileSparseVectors) {
     g_serumData.LogSparseVectorProfileSnapshot();
   }
-  g_profileLastLoggedInputCount = g_profileIncomingFrameCalls;
+  g_profileLastLoggedInputCount = inputs;
   if (g_profileDynamicHotPathsWindowed) {
     ResetDynamicHotPathProfile();
   }
@@ -829,6 +863,7 @@ static void InitDebugFrameTracingFromEnv(void) {
     return;
   }
   g_debugFrameTracingInitialized = true;
+#ifdef SERUM_ENABLE_DIAGNOSTICS
   g_debugTargetInputCrc = GetEnvUint32Auto("SERUM_DEBUG_INPUT_CRC", 0);
   g_debugTargetFrameId = GetEnvUint32Auto("SERUM_DEBUG_FRAME_ID", 0xffffffffu);
   g_debugStageHashes = IsEnvFlagEnabled("SERUM_DEBUG_STAGE_HASHES");
@@ -837,9 +872,11 @@ static void InitDebugFrameTracingFromEnv(void) {
   g_debugVerboseIdentify = IsEnvFlagEnabled("SERUM_DEBUG_IDENTIFY_VERBOSE");
   g_debugVerboseSprites = IsEnvFlagEnabled("SERUM_DEBUG_SPRITE_VERBOSE");
   g_debugVerboseScenes = IsEnvFlagEnabled("SERUM_DEBUG_SCENE_VERBOSE");
-  if (g_debugTargetInputCrc != 0 || g_debugTargetFrameId != 0xffffffffu ||
+  g_debugTracingActive =
+      g_debugTargetInputCrc != 0 || g_debugTargetFrameId != 0xffffffffu ||
       g_debugStageHashes || g_debugTraceAllInputs || g_debugBypassSceneGate ||
-      g_debugVerboseIdentify || g_debugVerboseSprites || g_debugVerboseScenes) {
+      g_debugVerboseIdentify || g_debugVerboseSprites || g_debugVerboseScenes;
+  if (g_debugTracingActive) {
     Log("Serum debug tracing enabled: inputCrc=%u frameId=%u stageHashes=%s "
         "traceAllInputs=%s bypassSceneGate=%s identifyVerbose=%s "
         "spriteVerbose=%s sceneVerbose=%s",
@@ -850,9 +887,23 @@ static void InitDebugFrameTracingFromEnv(void) {
         g_debugVerboseSprites ? "on" : "off",
         g_debugVerboseScenes ? "on" : "off");
   }
+#endif
 }
 
+#ifdef SERUM_ENABLE_DIAGNOSTICS
+static bool DebugTracingActive() {
+  InitDebugFrameTracingFromEnv();
+  return g_debugTracingActive;
+}
+#else
+static constexpr bool DebugTracingActive() { return false; }
+#endif
+
 static bool DebugTraceMatches(uint32_t inputCrc, uint32_t frameId) {
+  // Frames rendered ahead on the pre-render worker aren't logged.
+  if (serum_trace::g_threadSuppressed) {
+    return false;
+  }
   InitDebugFrameTracingFromEnv();
   const bool crcMatches =
       (g_debugTargetInputCrc == 0) || (inputCrc == g_debugTargetInputCrc);
@@ -862,6 +913,9 @@ static bool DebugTraceMatches(uint32_t inputCrc, uint32_t frameId) {
 }
 
 static bool DebugTraceMatchesInputCrc(uint32_t inputCrc) {
+  if (serum_trace::g_threadSuppressed) {
+    return false;
+  }
   InitDebugFrameTracingFromEnv();
   return (g_debugTargetInputCrc == 0) || (inputCrc == g_debugTargetInputCrc);
 }
@@ -894,6 +948,14 @@ static double DurationMs(std::chrono::steady_clock::time_point start,
          1000.0;
 }
 
+// Records one load stage in the perf counters and adds it to the per-load
+// millisecond tally that SERUM_PROFILE_LOAD_TIMES logs.
+static void RecordLoadStage(uint32_t stage, uint64_t startNs, double& tallyMs) {
+  const uint64_t elapsedNs = PerfCounters::NowNs() - startNs;
+  g_perfCounters.Record(stage, elapsedNs);
+  tallyMs += (double)elapsedNs / 1000000.0;
+}
+
 static void DebugLogSceneEvent(const char* event, uint16_t sceneId,
                                uint16_t frameIndex, uint16_t frameCount,
                                uint16_t durationPerFrame, uint8_t options,
@@ -992,9 +1054,9 @@ static bool FrameHasRenderableContent(uint32_t frameId) {
   return false;
 }
 
-static uint64_t DebugHashBytesFNV1a64(const void* data, size_t size) {
+static uint64_t DebugHashBytesFNV1a64(
+    const void* data, size_t size, uint64_t hash = 1469598103934665603ULL) {
   const uint8_t* bytes = static_cast<const uint8_t*>(data);
-  uint64_t hash = 1469598103934665603ULL;
   for (size_t i = 0; i < size; ++i) {
     hash ^= bytes[i];
     hash *= 1099511628211ULL;
@@ -1025,6 +1087,10 @@ static uint64_t DebugHashFrameRegionFNV1a64(const uint16_t* frame,
 }
 
 static uint64_t DebugHashCurrentOutputFrame(uint32_t frameId, bool isExtra) {
+  if (!g_debugStageHashes ||
+      !DebugTraceMatches(g_debugCurrentInputCrc, frameId)) {
+    return 0;
+  }
   uint16_t* output = nullptr;
   uint32_t width = 0;
   uint32_t height = 0;
@@ -1042,13 +1108,10 @@ static uint64_t DebugHashCurrentOutputFrame(uint32_t frameId, bool isExtra) {
   }
   const uint64_t hash = DebugHashBytesFNV1a64(
       output, static_cast<size_t>(width) * height * sizeof(uint16_t));
-  if (g_debugStageHashes &&
-      DebugTraceMatches(g_debugCurrentInputCrc, frameId)) {
-    Log("Serum debug stage hash: frameId=%u inputCrc=%u stage=%s hash=%llu "
-        "size=%ux%u",
-        frameId, g_debugCurrentInputCrc, isExtra ? "base-extra" : "base",
-        static_cast<unsigned long long>(hash), width, height);
-  }
+  Log("Serum debug stage hash: frameId=%u inputCrc=%u stage=%s hash=%llu "
+      "size=%ux%u",
+      frameId, g_debugCurrentInputCrc, isExtra ? "base-extra" : "base",
+      static_cast<unsigned long long>(hash), width, height);
   return hash;
 }
 
@@ -1353,11 +1416,73 @@ void Free_element(void** ppElement) {
   }
 }
 
-void Serum_free(void) {
-  // Free the memory for a full Serum whatever the format version
-  g_serumData.Clear();
-
-  Free_element((void**)&framechecked);
+// Output plane in caller memory set with Serum_SetOutputBuffers(). A packed
+// plane (stride == width) stands in for the malloc'ed one in mySerum, which
+// is kept in `owned` meanwhile, so colorization writes straight into it. A
+// padded plane gets the rows copied after every output change.
+struct CallerOutputPlane {
+  uint16_t* frame = nullptr;  // padded caller plane, nullptr if none
+  uint32_t stride = 0;        // in pixels
+  uint16_t* ownedFrame = nullptr;
+  uint16_t* ownedRotationsInFrame = nullptr;
+  uint8_t* ownedModifiedElements = nullptr;
+};
+static CallerOutputPlane g_callerPlane32;
+static CallerOutputPlane g_callerPlane64;
+
+// Pixel formats set with Serum_SetOutputFormat(), kept across loads.
+static uint8_t g_outputFormat32 = SERUM_PIXEL_FORMAT_RGB565;
+static uint8_t g_outputFormat64 = SERUM_PIXEL_FORMAT_RGB565;
+
+// Indexed copies of the planes, see Serum_SetIndexedOutput().
+static bool g_indexedOutput = false;
+static IndexedOutput g_indexed32;
+static IndexedOutput g_indexed64;
+
+// Output ring for display processes, see Serum_OpenSharedOutput().
+static SharedOutputRing g_sharedOutput;
+
+// Change streams of the planes, see Serum_SetDeltaOutput().
+static bool g_deltaOutput = false;
+static DeltaEncoder g_delta32;
+static DeltaEncoder g_delta64;
+
+static void ClearDeltaPlanes(void) {
+  g_delta32.Reset();
+  g_delta64.Reset();
+  mySerum.delta32 = mySerum.delta64 = NULL;
+  mySerum.deltasize32 = mySerum.deltasize64 = 0;
+  mySerum.dirty32 = mySerum.dirty64 = Serum_Rect();
+}
+
+static void ClearIndexedPlanes(void) {
+  g_indexed32.Reset();
+  g_indexed64.Reset();
+  mySerum.index32 = mySerum.index64 = NULL;
+  mySerum.palette32 = mySerum.palette64 = NULL;
+  mySerum.palettesize32 = mySerum.palettesize64 = 0;
+}
+
+// Puts the malloc'ed planes back into mySerum without copying anything.
+static void DropCallerOutputPlane(CallerOutputPlane& plane, uint16_t*& frame,
+                                  uint16_t*& rotationsInFrame,
+                                  uint8_t*& modifiedElements) {
+  if (plane.ownedFrame) frame = plane.ownedFrame;
+  if (plane.ownedRotationsInFrame) {
+    rotationsInFrame = plane.ownedRotationsInFrame;
+  }
+  if (plane.ownedModifiedElements) {
+    modifiedElements = plane.ownedModifiedElements;
+  }
+  plane = CallerOutputPlane();
+}
+
+// Frees the frame structure buffers allocated by Serum_LoadConcentratePrepared.
+static void FreeFrameOutputs(void) {
+  DropCallerOutputPlane(g_callerPlane32, mySerum.frame32,
+                        mySerum.rotationsinframe32, mySerum.modifiedelements32);
+  DropCallerOutputPlane(g_callerPlane64, mySerum.frame64,
+                        mySerum.rotationsinframe64, mySerum.modifiedelements64);
   Free_element((void**)&mySerum.frame);
   Free_element((void**)&mySerum.frame32);
   Free_element((void**)&mySerum.frame64);
@@ -1369,7 +1494,36 @@ void Serum_free(void) {
   Free_element((void**)&mySerum.rotationsinframe64);
   Free_element((void**)&mySerum.modifiedelements32);
   Free_element((void**)&mySerum.modifiedelements64);
+  Free_element((void**)&mySerum.output32);
+  Free_element((void**)&mySerum.output64);
+  ClearIndexedPlanes();
+  ClearDeltaPlanes();
   Free_element((void**)&frameshape);
+}
+
+static void StopFrameQueue(void) {
+  if (!g_frameQueue.IsRunning()) return;
+  g_frameQueue.Stop();
+  Log("Frame queue stopped: %llu frames colorized, %llu coalesced, %llu "
+      "dropped",
+      (unsigned long long)g_frameQueue.ProcessedFrames(),
+      (unsigned long long)g_frameQueue.CoalescedFrames(),
+      (unsigned long long)g_frameQueue.DroppedFrames());
+}
+
+void Serum_free(void) {
+  // Free the memory for a full Serum whatever the format version
+  StopFrameQueue();
+  g_scenePrerender.Cancel();
+  g_rotationScheduler.Arm(0);
+  if (g_frameExchange.IsEnabled()) {
+    g_frameExchange.Clear();
+  }
+  g_serumData.Clear();
+
+  FreeFrameOutputs();
+  g_v1CompatOutput = false;
+  g_v1CompatFrameId = 0;
   cromloaded = false;
   lastfound = 0;
   lastfound_normal = 0;
@@ -1392,6 +1546,9 @@ void Serum_free(void) {
   isoriginalfallbackrequested = false;
   g_sceneResumeState.clear();
   g_criticalTriggerMaskShapes.clear();
+  g_frameKernels = &GenericGeometryKernels();
+  g_plane32Kernels = &GenericGeometryKernels();
+  g_plane64Kernels = &GenericGeometryKernels();
   ClearLastErrorMessage();
 
   g_serumData.sceneGenerator->Reset();
@@ -1437,43 +1594,9 @@ uint32_t crc32_fast(uint8_t* s, uint32_t n)
   return ~crc;
 }
 
-uint32_t crc32_fast_shape(uint8_t* s, uint32_t n)
-// computing a buffer CRC32, "CRC32encode()" must have been called before the
-// first use version with shapemode and no mask
-{
-  uint32_t crc = 0xffffffff;
-  for (int i = 0; i < (int)n; i++) {
-    uint8_t val = s[i];
-    if (val > 1) val = 1;
-    crc = (crc >> 8) ^ crc32_table[(val ^ crc) & 0xFF];
-  }
-  return ~crc;
-}
-
-uint32_t crc32_fast_mask(uint8_t* source, uint8_t* mask, uint32_t n)
-// computing a buffer CRC32 on the non-masked area, "CRC32encode()" must have
-// been called before the first use version with a mask and no shape mode
-{
-  uint32_t crc = 0xffffffff;
-  for (uint32_t i = 0; i < n; i++) {
-    if (mask[i] == 0) crc = (crc >> 8) ^ crc32_table[(source[i] ^ crc) & 0xFF];
-  }
-  return ~crc;
-}
-
-uint32_t crc32_fast_mask_shape(uint8_t* source, uint8_t* mask, uint32_t n)
-// computing a buffer CRC32 on the non-masked area, "CRC32encode()" must have
-// been called before the first use version with a mask and shape mode
-{
-  uint32_t crc = 0xffffffff;
-  for (uint32_t i = 0; i < n; i++) {
-    if (mask[i] == 0) {
-      uint8_t val = source[i];
-      if (val > 1) val = 1;
-      crc = (crc >> 8) ^ crc32_table[(val ^ crc) & 0xFF];
-    }
-  }
-  return ~crc;
+// Full CRC of an input frame of the loaded geometry.
+static uint32_t FrameCrc32(const uint8_t* frame, uint32_t pixels) {
+  return g_frameKernels->crc32(crc32_table, frame, pixels);
 }
 
 uint32_t calc_crc32(uint8_t* source, uint8_t mask, uint32_t n, uint8_t Shape) {
@@ -1483,12 +1606,44 @@ uint32_t calc_crc32(uint8_t* source, uint8_t mask, uint32_t n, uint8_t Shape) {
   if (mask < 255) {
     uint8_t* pmask = g_serumData.compmasks[mask];
     if (Shape == 1)
-      return crc32_fast_mask_shape(source, pmask, pixels);
+      return g_frameKernels->crc32MaskShape(crc32_table, source, pmask,
+                                            pixels);
     else
-      return crc32_fast_mask(source, pmask, pixels);
+      return g_frameKernels->crc32Mask(crc32_table, source, pmask, pixels);
   } else if (Shape == 1)
-    return crc32_fast_shape(source, pixels);
-  return crc32_fast(source, pixels);
+    return g_frameKernels->crc32Shape(crc32_table, source, pixels);
+  return g_frameKernels->crc32(crc32_table, source, pixels);
+}
+
+// Picks the geometry kernels for the loaded project: the identify CRCs and the
+// sprite detection run on the input frame, the rotations on the output planes
+// (the base or the extra resolution, whichever has that height).
+static void SelectLoadedGeometryKernels(void) {
+  const uint32_t width = g_serumData.fwidth;
+  const uint32_t height = g_serumData.fheight;
+  g_frameKernels = (g_serumData.is256x64 && (width != 256 || height != 64))
+                       ? &GenericGeometryKernels()
+                       : &SelectGeometryKernels(width, height);
+  auto planeKernels = [](uint32_t planeHeight) {
+    if (g_serumData.fheight == planeHeight) {
+      return &SelectGeometryKernels(g_serumData.fwidth, planeHeight);
+    }
+    if (g_serumData.fheight_extra == planeHeight) {
+      return &SelectGeometryKernels(g_serumData.fwidth_extra, planeHeight);
+    }
+    return &GenericGeometryKernels();
+  };
+  g_plane32Kernels = planeKernels(32);
+  g_plane64Kernels = planeKernels(64);
+}
+
+// Kernels for an output plane of the given size; the rotations only run on
+// planes the project renders, but fall back to the generic ones for safety.
+static const GeometryKernels& PlaneKernels(const GeometryKernels* kernels,
+                                           uint32_t width, uint32_t height) {
+  return (kernels->width == width && kernels->height == height)
+             ? *kernels
+             : GenericGeometryKernels();
 }
 
 struct FileCRomReader {
@@ -1709,6 +1864,7 @@ static std::string BuildConcentratePathFromSourcePath(const char* filename) {
 }
 
 bool Serum_SaveConcentrate(const char* filename) {
+  SERUM_TRACE_SCOPE("Serum_SaveConcentrate");
   if (!cromloaded || is_real_machine()) return false;
   if (g_serumData.sceneGenerator && g_serumData.sceneGenerator->isActive()) {
     g_serumData.sceneGenerator->setDepth(g_serumData.nocolors == 16 ? 4 : 2);
@@ -1834,14 +1990,6 @@ static Serum_Frame_Struc* Serum_LoadConcentratePrepared(
     }
   }
 
-  // Allocate framechecked array
-  framechecked = (bool*)malloc(sizeof(bool) * g_serumData.nframes);
-  if (!framechecked) {
-    Serum_free();
-    enabled = false;
-    return NULL;
-  }
-
   Full_Reset_ColorRotations();
   cromloaded = true;
   enabled = true;
@@ -1862,6 +2010,7 @@ static void LogLoadedColorizationSource(const std::string& path,
 Serum_Frame_Struc* Serum_LoadConcentrate(const char* filename,
                                          const uint8_t loadFlags,
                                          const uint8_t runtimeFlags) {
+  SERUM_TRACE_SCOPE("Serum_LoadConcentrate");
   if (!crc32_ready) CRC32encode();
   const bool loadTimingEnabled = IsLoadTimingEnabled();
   const auto totalStart = loadTimingEnabled
@@ -2176,12 +2325,6 @@ static Serum_Frame_Struc* Serum_LoadFilev2Stream(Reader& reader,
     if (g_serumData.triggerIDs[ti][0] < PUP_TRIGGER_MAX_THRESHOLD)
       mySerum.ntriggers++;
   }
-  framechecked = (bool*)malloc(sizeof(bool) * g_serumData.nframes);
-  if (!framechecked) {
-    Serum_free();
-    enabled = false;
-    return NULL;
-  }
 
   mySerum.SerumVersion = g_serumData.SerumVersion = SERUM_V2;
 
@@ -2388,12 +2531,6 @@ static Serum_Frame_Struc* Serum_LoadFilev1Stream(Reader& reader,
 
   g_serumData.BuildPackingSidecarsAndNormalize();
 
-  framechecked = (bool*)malloc(sizeof(bool) * g_serumData.nframes);
-  if (!framechecked) {
-    Serum_free();
-    enabled = false;
-    return NULL;
-  }
   if (g_serumData.fheight == 64) {
     mySerum.width64 = g_serumData.fwidth;
     mySerum.width32 = 0;
@@ -2410,6 +2547,7 @@ static Serum_Frame_Struc* Serum_LoadFilev1Stream(Reader& reader,
 Serum_Frame_Struc* Serum_LoadFilev1(const char* const filename,
                                     const uint8_t loadFlags,
                                     const uint8_t runtimeFlags) {
+  SERUM_TRACE_SCOPE("Serum_LoadFilev1");
   if (!crc32_ready) CRC32encode();
 
   // check if we're using an uncompressed cROM file
@@ -2443,39 +2581,29 @@ Serum_Frame_Struc* Serum_LoadFilev1(const char* const filename,
   return result;
 }
 
-SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
-                                        const char* const romname,
-                                        uint8_t flags) {
-  SERUM_API_GUARD_START("Serum_Load")
-  const bool realMachine = is_real_machine();
-  const bool forceLoadFlags = (flags & FLAG_REQUEST_FORCE) != 0;
-  uint8_t runtimeFlags = flags | (realMachine ? FLAG_REQUEST_64P_FRAMES : 0);
-  uint8_t loadFlags = runtimeFlags;
-  Serum_free();
+// Reads the profiling switches and clears the frame structure ahead of any
+// Serum_Load* entry point.
+static void BeginLoad(void) {
+#ifdef SERUM_ENABLE_DIAGNOSTICS
   g_profileLoadTimes = IsEnvFlagEnabled("SERUM_PROFILE_LOAD_TIMES");
-  const auto loadTotalStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
   g_profileDynamicHotPaths = IsEnvFlagEnabled("SERUM_PROFILE_DYNAMIC_HOTPATHS");
   g_profileDynamicHotPathsWindowed =
       IsEnvFlagEnabled("SERUM_PROFILE_DYNAMIC_HOTPATHS_WINDOWED");
   g_profileSparseVectors = IsEnvFlagEnabled("SERUM_PROFILE_SPARSE_VECTORS");
-  g_profileRoundTripNs = 0;
-  g_profileColorizeFrameV2Ns = 0;
-  g_profileColorizeSpriteV2Ns = 0;
-  g_profileColorizeCalls = 0;
-  g_profileIdentifyTotalNs = 0;
-  g_profileIdentifyNormalNs = 0;
-  g_profileIdentifySceneNs = 0;
-  g_profileIdentifyCriticalNs = 0;
-  g_profileIdentifyNormalCalls = 0;
-  g_profileIdentifySceneCalls = 0;
-  g_profileIdentifyCriticalCalls = 0;
+#endif
+  g_scenePrerenderEnabled = !IsEnvFlagEnabled("SERUM_DISABLE_SCENE_PRERENDER");
+  g_scenePrerender.Cancel();
   g_profilePeakRssBytes = 0;
   g_profileFrameOperationDepth = 0;
   g_profileFrameOperationFinished = false;
   ResetStartupRssProfile();
 
+  const char* captureFile = std::getenv("SERUM_CAPTURE_FILE");
+  if (captureFile && captureFile[0] != '\0' && !g_frameCapture.IsActive() &&
+      g_frameCapture.Start(captureFile, GetMonotonicTimeMs())) {
+    Log("Capturing API calls to %s", captureFile);
+  }
+
   mySerum.SerumVersion = g_serumData.SerumVersion = 0;
   mySerum.flags = 0;
   mySerum.frame = NULL;
@@ -2489,6 +2617,167 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
   mySerum.rotationsinframe64 = NULL;
   mySerum.modifiedelements32 = NULL;
   mySerum.modifiedelements64 = NULL;
+}
+
+struct LoadLookupTimings {
+  double packingNormalizeMs = 0.0;
+  double frameLookupBuildMs = 0.0;
+  double frameLookupRestoreMs = 0.0;
+  double colorRotationBuildMs = 0.0;
+  double spriteSidecarBuildMs = 0.0;
+  double criticalLookupInitMs = 0.0;
+};
+
+// Derived lookups every successful load needs before the first colorization,
+// restored from the cROMc when possible and rebuilt otherwise.
+static void PrepareLoadedLookups(bool loadedFromConcentrate,
+                                 bool sceneDataUpdatedFromCsv,
+                                 LoadLookupTimings& timings) {
+  const uint64_t lookupsStartNs = PerfCounters::NowNs();
+  SelectLoadedGeometryKernels();
+  g_simdKernels = &SelectSimdKernels();
+  const bool rebuildDerivedLookups = !loadedFromConcentrate ||
+                                     g_serumData.concentrateFileVersion < 6 ||
+                                     sceneDataUpdatedFromCsv;
+  if (loadedFromConcentrate && g_serumData.concentrateFileVersion < 6) {
+    const auto stageStart = g_profileLoadTimes
+                                ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point{};
+    g_serumData.BuildPackingSidecarsAndNormalize();
+    if (g_profileLoadTimes) {
+      timings.packingNormalizeMs +=
+          DurationMs(stageStart, std::chrono::steady_clock::now());
+    }
+    NoteStartupRssSample("after-packing-sidecar-normalize");
+  }
+  if (rebuildDerivedLookups) {
+    const auto stageStart = g_profileLoadTimes
+                                ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point{};
+    BuildFrameLookupVectors();
+    if (g_profileLoadTimes) {
+      timings.frameLookupBuildMs +=
+          DurationMs(stageStart, std::chrono::steady_clock::now());
+    }
+    NoteStartupRssSample("after-frame-lookup-build");
+  } else {
+    const auto stageStart = g_profileLoadTimes
+                                ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point{};
+    InitFrameLookupRuntimeStateFromStoredData();
+    if (g_profileLoadTimes) {
+      timings.frameLookupRestoreMs +=
+          DurationMs(stageStart, std::chrono::steady_clock::now());
+    }
+    NoteStartupRssSample("after-frame-lookup-restore");
+  }
+  if (rebuildDerivedLookups ||
+      g_serumData.colorRotationLookupByFrameAndColor.empty()) {
+    const auto stageStart = g_profileLoadTimes
+                                ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point{};
+    g_serumData.BuildColorRotationLookup();
+    if (g_profileLoadTimes) {
+      timings.colorRotationBuildMs +=
+          DurationMs(stageStart, std::chrono::steady_clock::now());
+    }
+    NoteStartupRssSample("after-color-rotation-build");
+  }
+  if (!g_serumData.HasSpriteRuntimeSidecars() &&
+      (!loadedFromConcentrate || g_serumData.concentrateFileVersion < 6)) {
+    const auto stageStart = g_profileLoadTimes
+                                ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point{};
+    g_serumData.BuildSpriteRuntimeSidecars();
+    if (g_profileLoadTimes) {
+      timings.spriteSidecarBuildMs +=
+          DurationMs(stageStart, std::chrono::steady_clock::now());
+    }
+    NoteStartupRssSample("after-sprite-sidecar-build");
+  }
+  const auto criticalStart = g_profileLoadTimes
+                                 ? std::chrono::steady_clock::now()
+                                 : std::chrono::steady_clock::time_point{};
+  InitCriticalTriggerLookupRuntimeState();
+  if (g_profileLoadTimes) {
+    timings.criticalLookupInitMs +=
+        DurationMs(criticalStart, std::chrono::steady_clock::now());
+  }
+  g_perfCounters.RecordSince(SERUM_PERF_STAGE_LOAD_LOOKUPS, lookupsStartNs);
+}
+
+// Load-mode bits of the Serum_Load* flags; they never reach mySerum.flags.
+constexpr uint8_t kV1LoadModeFlags =
+    FLAG_REQUEST_V1_UPCONVERT | FLAG_REQUEST_V1_COMPAT_OUTPUT;
+
+// Moves a freshly loaded v1 project onto the v2 pipeline. Returns true if it
+// was converted; result then points to the re-prepared frame structure.
+static bool UpconvertLoadedV1(Serum_Frame_Struc*& result,
+                              uint8_t runtimeFlags) {
+  if (!result || g_serumData.SerumVersion != SERUM_V1 ||
+      !g_serumData.UpconvertV1ToV2()) {
+    return false;
+  }
+  FreeFrameOutputs();
+  result = Serum_LoadConcentratePrepared(runtimeFlags);
+  return true;
+}
+
+// Adds the v1 output fields for upconverted projects, either on request or
+// because the caller doesn't know about upconversion and still expects v1.
+static Serum_Frame_Struc* SetupV1CompatOutput(Serum_Frame_Struc* result,
+                                              uint8_t runtimeFlags,
+                                              uint8_t modeFlags) {
+  const bool upconvertRequested = (modeFlags & FLAG_REQUEST_V1_UPCONVERT) != 0;
+  if (!result || !g_serumData.IsUpconvertedV1() ||
+      (upconvertRequested &&
+       (modeFlags & FLAG_REQUEST_V1_COMPAT_OUTPUT) == 0)) {
+    return result;
+  }
+  const uint8_t planeFlag = g_serumData.fheight == 32
+                                ? FLAG_REQUEST_32P_FRAMES
+                                : FLAG_REQUEST_64P_FRAMES;
+  if (!isoriginalrequested) {
+    // The v1 fields are rebuilt from the original resolution plane.
+    FreeFrameOutputs();
+    result = Serum_LoadConcentratePrepared(runtimeFlags | planeFlag);
+    if (!result) {
+      return NULL;
+    }
+  }
+  mySerum.frame = (uint8_t*)malloc(g_serumData.fwidth * g_serumData.fheight);
+  mySerum.palette = (uint8_t*)malloc(3 * 64);
+  mySerum.rotations = (uint8_t*)malloc(MAX_COLOR_ROTATIONS * 3);
+  if (!mySerum.frame || !mySerum.palette || !mySerum.rotations) {
+    Serum_free();
+    enabled = false;
+    return NULL;
+  }
+  memset(mySerum.frame, 0, g_serumData.fwidth * g_serumData.fheight);
+  memset(mySerum.palette, 0, 3 * 64);
+  memset(mySerum.rotations, 255, MAX_COLOR_ROTATIONS * 3);
+  if (!upconvertRequested) {
+    mySerum.SerumVersion = SERUM_V1;
+  }
+  g_v1CompatOutput = true;
+  return result;
+}
+
+SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
+                                        const char* const romname,
+                                        uint8_t flags) {
+  SERUM_API_GUARD_START("Serum_Load")
+  SERUM_TRACE_SCOPE("Serum_Load");
+  const bool realMachine = is_real_machine();
+  const bool forceLoadFlags = (flags & FLAG_REQUEST_FORCE) != 0;
+  const uint8_t modeFlags = flags & kV1LoadModeFlags;
+  const bool upconvertRequested = (modeFlags & FLAG_REQUEST_V1_UPCONVERT) != 0;
+  flags &= ~kV1LoadModeFlags;
+  uint8_t runtimeFlags = flags | (realMachine ? FLAG_REQUEST_64P_FRAMES : 0);
+  uint8_t loadFlags = runtimeFlags;
+  Serum_free();
+  const uint64_t loadTotalStartNs = PerfCounters::NowNs();
+  BeginLoad();
 
   std::string pathbuf = std::string(altcolorpath);
   if (pathbuf.empty() || (pathbuf.back() != '\\' && pathbuf.back() != '/'))
@@ -2501,12 +2790,6 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
   double cromcLoadMs = 0.0;
   double rawLoadMs = 0.0;
   double cromcReloadMs = 0.0;
-  double packingNormalizeMs = 0.0;
-  double frameLookupBuildMs = 0.0;
-  double frameLookupRestoreMs = 0.0;
-  double colorRotationBuildMs = 0.0;
-  double spriteSidecarBuildMs = 0.0;
-  double criticalLookupInitMs = 0.0;
 
   // If no specific frame type is requested, activate both
   if (!forceLoadFlags &&
@@ -2545,32 +2828,28 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
       if (pFoundFile) {
         Log("Found %s", pFoundFile->c_str());
         NoteStartupRssSample("before-cromc-load");
-        const auto stageStart = g_profileLoadTimes
-                                    ? std::chrono::steady_clock::now()
-                                    : std::chrono::steady_clock::time_point{};
+        const uint64_t stageStartNs = PerfCounters::NowNs();
         result =
             Serum_LoadConcentrate(pFoundFile->c_str(), loadFlags, runtimeFlags);
-        if (g_profileLoadTimes) {
-          cromcLoadMs +=
-              DurationMs(stageStart, std::chrono::steady_clock::now());
-        }
+        RecordLoadStage(SERUM_PERF_STAGE_LOAD_CROMC, stageStartNs,
+                        cromcLoadMs);
         loadedFromConcentrate = (result != NULL);
         if (result) {
           NoteStartupRssSample("after-cromc-load");
           LogLoadedColorizationSource(*pFoundFile, true);
-          if (csvFoundFile && g_serumData.SerumVersion == SERUM_V2 && ([&]() {
-                const auto csvStart =
-                    g_profileLoadTimes
-                        ? std::chrono::steady_clock::now()
-                        : std::chrono::steady_clock::time_point{};
-                const bool parsed =
-                    g_serumData.sceneGenerator->parseCSV(csvFoundFile->c_str());
-                if (g_profileLoadTimes) {
-                  csvUpdateMs +=
-                      DurationMs(csvStart, std::chrono::steady_clock::now());
-                }
-                return parsed;
-              })()) {
+          if (upconvertRequested && UpconvertLoadedV1(result, runtimeFlags) &&
+              result && generateCRomC &&
+              Serum_SaveConcentrate(pFoundFile->c_str())) {
+            reloadConcentratePath = *pFoundFile;
+          }
+          bool csvParsed = false;
+          if (result && csvFoundFile && g_serumData.SerumVersion == SERUM_V2) {
+            const uint64_t csvStartNs = PerfCounters::NowNs();
+            csvParsed =
+                g_serumData.sceneGenerator->parseCSV(csvFoundFile->c_str());
+            RecordLoadStage(SERUM_PERF_STAGE_LOAD_CSV, csvStartNs, csvUpdateMs);
+          }
+          if (csvParsed) {
             sceneDataUpdatedFromCsv = true;
             NoteStartupRssSample("after-csv-update");
             if (!realMachine) {
@@ -2591,18 +2870,17 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
     if (pFoundFile) {
       Log("Found %s", pFoundFile->c_str());
       NoteStartupRssSample("before-cromc-load");
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
+      const uint64_t stageStartNs = PerfCounters::NowNs();
       result =
           Serum_LoadConcentrate(pFoundFile->c_str(), loadFlags, runtimeFlags);
-      if (g_profileLoadTimes) {
-        cromcLoadMs += DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
+      RecordLoadStage(SERUM_PERF_STAGE_LOAD_CROMC, stageStartNs, cromcLoadMs);
       loadedFromConcentrate = (result != NULL);
       if (result) {
         NoteStartupRssSample("after-cromc-load");
         LogLoadedColorizationSource(*pFoundFile, true);
+        if (upconvertRequested) {
+          UpconvertLoadedV1(result, runtimeFlags);
+        }
       } else {
         Log("Failed to load %s", pFoundFile->c_str());
       }
@@ -2630,25 +2908,20 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
     }
     Log("Found %s", pFoundFile->c_str());
     NoteStartupRssSample("before-crom-load");
-    const auto rawStageStart = g_profileLoadTimes
-                                   ? std::chrono::steady_clock::now()
-                                   : std::chrono::steady_clock::time_point{};
+    const uint64_t rawStageStartNs = PerfCounters::NowNs();
     result = Serum_LoadFilev1(pFoundFile->c_str(), loadFlags, runtimeFlags);
-    if (g_profileLoadTimes) {
-      rawLoadMs += DurationMs(rawStageStart, std::chrono::steady_clock::now());
+    RecordLoadStage(SERUM_PERF_STAGE_LOAD_RAW, rawStageStartNs, rawLoadMs);
+    if (result && upconvertRequested) {
+      UpconvertLoadedV1(result, runtimeFlags);
     }
     if (result) {
       NoteStartupRssSample("after-crom-load");
       LogLoadedColorizationSource(*pFoundFile, false);
       if (csvFoundFile && g_serumData.SerumVersion == SERUM_V2) {
-        const auto csvStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
+        const uint64_t csvStartNs = PerfCounters::NowNs();
         sceneDataUpdatedFromCsv =
             g_serumData.sceneGenerator->parseCSV(csvFoundFile->c_str());
-        if (g_profileLoadTimes) {
-          csvUpdateMs += DurationMs(csvStart, std::chrono::steady_clock::now());
-        }
+        RecordLoadStage(SERUM_PERF_STAGE_LOAD_CSV, csvStartNs, csvUpdateMs);
         if (sceneDataUpdatedFromCsv) {
           NoteStartupRssSample("after-csv-update");
         }
@@ -2666,15 +2939,10 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
   if (reloadConcentratePath) {
     NoteStartupRssSample("before-cromc-reload");
     Serum_free();
-    const auto reloadStart = g_profileLoadTimes
-                                 ? std::chrono::steady_clock::now()
-                                 : std::chrono::steady_clock::time_point{};
+    const uint64_t reloadStartNs = PerfCounters::NowNs();
     result = Serum_LoadConcentrate(reloadConcentratePath->c_str(), loadFlags,
                                    runtimeFlags);
-    if (g_profileLoadTimes) {
-      cromcReloadMs +=
-          DurationMs(reloadStart, std::chrono::steady_clock::now());
-    }
+    RecordLoadStage(SERUM_PERF_STAGE_LOAD_CROMC, reloadStartNs, cromcReloadMs);
     loadedFromConcentrate = (result != NULL);
     sceneDataUpdatedFromCsv = false;
     if (result) {
@@ -2684,81 +2952,18 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
       Log("Failed to reload %s after update", reloadConcentratePath->c_str());
     }
   }
+  result = SetupV1CompatOutput(result, runtimeFlags, modeFlags);
   if (result && g_serumData.sceneGenerator->isActive())
     g_serumData.sceneGenerator->setDepth(result->nocolors == 16 ? 4 : 2);
   if (result) {
-    const bool rebuildDerivedLookups = !loadedFromConcentrate ||
-                                       g_serumData.concentrateFileVersion < 6 ||
-                                       sceneDataUpdatedFromCsv;
-    if (loadedFromConcentrate && g_serumData.concentrateFileVersion < 6) {
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
-      g_serumData.BuildPackingSidecarsAndNormalize();
-      if (g_profileLoadTimes) {
-        packingNormalizeMs +=
-            DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
-      NoteStartupRssSample("after-packing-sidecar-normalize");
-    }
-    if (rebuildDerivedLookups) {
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
-      BuildFrameLookupVectors();
-      if (g_profileLoadTimes) {
-        frameLookupBuildMs +=
-            DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
-      NoteStartupRssSample("after-frame-lookup-build");
-    } else {
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
-      InitFrameLookupRuntimeStateFromStoredData();
-      if (g_profileLoadTimes) {
-        frameLookupRestoreMs +=
-            DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
-      NoteStartupRssSample("after-frame-lookup-restore");
-    }
-    if (rebuildDerivedLookups ||
-        g_serumData.colorRotationLookupByFrameAndColor.empty()) {
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
-      g_serumData.BuildColorRotationLookup();
-      if (g_profileLoadTimes) {
-        colorRotationBuildMs +=
-            DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
-      NoteStartupRssSample("after-color-rotation-build");
-    }
-    if (!g_serumData.HasSpriteRuntimeSidecars() &&
-        (!loadedFromConcentrate || g_serumData.concentrateFileVersion < 6)) {
-      const auto stageStart = g_profileLoadTimes
-                                  ? std::chrono::steady_clock::now()
-                                  : std::chrono::steady_clock::time_point{};
-      g_serumData.BuildSpriteRuntimeSidecars();
-      if (g_profileLoadTimes) {
-        spriteSidecarBuildMs +=
-            DurationMs(stageStart, std::chrono::steady_clock::now());
-      }
-      NoteStartupRssSample("after-sprite-sidecar-build");
-    }
-    const auto criticalStart = g_profileLoadTimes
-                                   ? std::chrono::steady_clock::now()
-                                   : std::chrono::steady_clock::time_point{};
-    InitCriticalTriggerLookupRuntimeState();
-    if (g_profileLoadTimes) {
-      criticalLookupInitMs +=
-          DurationMs(criticalStart, std::chrono::steady_clock::now());
-    }
+    LoadLookupTimings lookupTimings;
+    PrepareLoadedLookups(loadedFromConcentrate, sceneDataUpdatedFromCsv,
+                         lookupTimings);
     NoteStartupRssSample("before-runtime");
     LogStartupRssSummary();
+    double totalMs = 0.0;
+    RecordLoadStage(SERUM_PERF_STAGE_LOAD_TOTAL, loadTotalStartNs, totalMs);
     if (g_profileLoadTimes) {
-      const double totalMs =
-          DurationMs(loadTotalStart, std::chrono::steady_clock::now());
       Log("Perf load total: total=%.3fms cROMcLoad=%.3fms rawLoad=%.3fms "
           "csvUpdate=%.3fms cROMcReload=%.3fms packingNormalize=%.3fms "
           "frameLookupBuild=%.3fms frameLookupRestore=%.3fms "
@@ -2766,8 +2971,11 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
           "criticalLookupInit=%.3fms loadedFromConcentrate=%s "
           "concentrateVersion=%u serumVersion=%u",
           totalMs, cromcLoadMs, rawLoadMs, csvUpdateMs, cromcReloadMs,
-          packingNormalizeMs, frameLookupBuildMs, frameLookupRestoreMs,
-          colorRotationBuildMs, spriteSidecarBuildMs, criticalLookupInitMs,
+          lookupTimings.packingNormalizeMs, lookupTimings.frameLookupBuildMs,
+          lookupTimings.frameLookupRestoreMs,
+          lookupTimings.colorRotationBuildMs,
+          lookupTimings.spriteSidecarBuildMs,
+          lookupTimings.criticalLookupInitMs,
           loadedFromConcentrate ? "true" : "false",
           g_serumData.concentrateFileVersion, g_serumData.SerumVersion);
     }
@@ -2782,13 +2990,75 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
   SERUM_API_GUARD_END("Serum_Load", nullptr)
 }
 
+SERUM_API Serum_Frame_Struc* Serum_LoadFromBuffer(const uint8_t* data,
+                                                  size_t size, uint8_t flags) {
+  SERUM_API_GUARD_START("Serum_LoadFromBuffer")
+  SERUM_TRACE_SCOPE("Serum_LoadFromBuffer");
+  const bool realMachine = is_real_machine();
+  const bool forceLoadFlags = (flags & FLAG_REQUEST_FORCE) != 0;
+  const uint8_t modeFlags = flags & kV1LoadModeFlags;
+  flags &= ~kV1LoadModeFlags;
+  uint8_t runtimeFlags = flags | (realMachine ? FLAG_REQUEST_64P_FRAMES : 0);
+  Serum_free();
+  const uint64_t loadTotalStartNs = PerfCounters::NowNs();
+  BeginLoad();
+  if (!forceLoadFlags &&
+      (runtimeFlags & (FLAG_REQUEST_32P_FRAMES | FLAG_REQUEST_64P_FRAMES)) ==
+          0) {
+    runtimeFlags |= FLAG_REQUEST_32P_FRAMES | FLAG_REQUEST_64P_FRAMES;
+  }
+  if (!crc32_ready) CRC32encode();
+
+  const uint64_t stageStartNs = PerfCounters::NowNs();
+  Serum_Frame_Struc* result = NULL;
+  if (g_serumData.LoadFromBuffer(data, size, runtimeFlags)) {
+    result = Serum_LoadConcentratePrepared(runtimeFlags);
+    if (modeFlags & FLAG_REQUEST_V1_UPCONVERT) {
+      UpconvertLoadedV1(result, runtimeFlags);
+    }
+    result = SetupV1CompatOutput(result, runtimeFlags, modeFlags);
+  }
+  double cromcLoadMs = 0.0;
+  RecordLoadStage(SERUM_PERF_STAGE_LOAD_CROMC, stageStartNs, cromcLoadMs);
+  if (!result) {
+    Log("Failed to load cROMc from memory");
+    enabled = false;
+    return NULL;
+  }
+  Log("Loaded cROMc from memory (Serum v%d, concentrate v%d)",
+      g_serumData.SerumVersion, g_serumData.concentrateFileVersion);
+
+  if (g_serumData.sceneGenerator->isActive())
+    g_serumData.sceneGenerator->setDepth(result->nocolors == 16 ? 4 : 2);
+  LoadLookupTimings lookupTimings;
+  PrepareLoadedLookups(true, false, lookupTimings);
+  double totalMs = 0.0;
+  RecordLoadStage(SERUM_PERF_STAGE_LOAD_TOTAL, loadTotalStartNs, totalMs);
+  if (g_profileLoadTimes) {
+    Log("Perf load total: total=%.3fms cROMcLoad=%.3fms source=memory",
+        totalMs, cromcLoadMs);
+  }
+  ResetDynamicHotPathProfile();
+  if (realMachine) {
+    monochromeMode = true;
+  }
+
+  return result;
+  SERUM_API_GUARD_END("Serum_LoadFromBuffer", nullptr)
+}
+
 SERUM_API void Serum_Dispose(void) {
   SERUM_API_GUARD_START("Serum_Dispose")
+  g_frameCapture.Stop();
   Serum_free();
+  g_scenePrerender.Stop();
+  g_rotationScheduler.Stop();
+  g_sharedOutput.Close();
   SERUM_API_GUARD_END_VOID("Serum_Dispose")
 }
 
 static void BuildFrameLookupVectors(void) {
+  SERUM_TRACE_SCOPE("BuildFrameLookupVectors");
   uint32_t numSceneFrames = 0;
   g_serumData.frameIsScene.clear();
   g_serumData.sceneFramesBySignature.clear();
@@ -2967,6 +3237,7 @@ static uint64_t MakeSceneTripletKey(uint16_t sceneId, uint8_t group,
 }
 
 static void InitFrameLookupRuntimeStateFromStoredData(void) {
+  SERUM_TRACE_SCOPE("InitFrameLookupRuntimeStateFromStoredData");
   if (g_serumData.frameIsScene.size() != g_serumData.nframes) {
     BuildFrameLookupVectors();
     return;
@@ -2996,25 +3267,56 @@ static void InitFrameLookupRuntimeStateFromStoredData(void) {
   }
 }
 
-uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
-  const auto profileStart = g_profileDynamicHotPaths
-                                ? std::chrono::steady_clock::now()
-                                : std::chrono::steady_clock::time_point{};
-  auto finishProfile = [&](uint32_t result) -> uint32_t {
-    if (g_profileDynamicHotPaths) {
-      const uint64_t elapsedNs =
-          (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-              std::chrono::steady_clock::now() - profileStart)
-              .count();
-      g_profileIdentifyTotalNs += elapsedNs;
-      if (sceneFrameRequested) {
-        g_profileIdentifySceneNs += elapsedNs;
-        ++g_profileIdentifySceneCalls;
-      } else {
-        g_profileIdentifyNormalNs += elapsedNs;
-        ++g_profileIdentifyNormalCalls;
+struct SceneFrameCandidate {
+  uint32_t frameId;
+  uint8_t mask;
+  uint8_t shape;
+  uint32_t hash;
+};
+
+// Walks the scene frames in wrap order from `start` and returns the first
+// one whose mask/shape signature matches the frame. Only reads the loaded
+// data, so the scene pre-render worker can resolve upcoming frames with it.
+static bool FindSceneFrameCandidate(uint8_t* frame, uint32_t pixels,
+                                    uint32_t start, uint32_t inputCrc,
+                                    bool debugLog,
+                                    SceneFrameCandidate& candidate) {
+  uint32_t tj = start;
+  do {
+    if (g_serumData.frameIsScene[tj] == 1) {
+      // calculate the hashcode for the generated frame with the mask and
+      // shapemode of the current crom frame
+      const uint8_t mask = g_serumData.compmaskID[tj][0];
+      const uint8_t Shape = g_serumData.shapecompmode[tj][0];
+      const uint32_t Hashc = calc_crc32(frame, mask, pixels, Shape);
+      if (debugLog && DebugIdentifyVerboseEnabled() &&
+          DebugTraceMatches(inputCrc, tj)) {
+        Log("Serum debug identify seed: inputCrc=%u startFrame=%u "
+            "sceneRequested=true mask=%u shape=%u hash=%u",
+            inputCrc, tj, mask, Shape, Hashc);
+      }
+      auto sigIt = g_serumData.sceneFramesBySignature.find(
+          MakeFrameSignature(mask, Shape, Hashc));
+      if (sigIt != g_serumData.sceneFramesBySignature.end() &&
+          !sigIt->second.empty()) {
+        candidate = {sigIt->second.front(), mask, Shape, Hashc};
+        return true;
       }
     }
+    if (++tj >= g_serumData.nframes) tj = 0;
+  } while (tj != start);
+  return false;
+}
+
+uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
+  SERUM_TRACE_SCOPE(sceneFrameRequested ? "Identify_Frame(scene)"
+                                        : "Identify_Frame");
+  const uint64_t profileStartNs = PerfCounters::NowNs();
+  auto finishProfile = [&](uint32_t result) -> uint32_t {
+    g_perfCounters.RecordSince(sceneFrameRequested
+                                   ? SERUM_PERF_STAGE_IDENTIFY_SCENE
+                                   : SERUM_PERF_STAGE_IDENTIFY_NORMAL,
+                               profileStartNs);
     return result;
   };
   if (!cromloaded) return finishProfile(IDENTIFY_NO_FRAME);
@@ -3025,7 +3327,8 @@ uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
   const uint32_t pixels = g_serumData.is256x64
                               ? (256 * 64)
                               : (g_serumData.fwidth * g_serumData.fheight);
-  const uint32_t inputCrc = crc32_fast(frame, pixels);
+  const uint32_t inputCrc =
+      DebugTracingActive() ? crc32_fast(frame, pixels) : 0;
   uint32_t& lastfound_stream =
       sceneFrameRequested ? lastfound_scene : lastfound_normal;
   bool& first_match =
@@ -3046,6 +3349,9 @@ uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
       return finishProfile(IDENTIFY_NO_FRAME);
     }
     std::vector<uint8_t> bucketVisited(bucketCount, 0);
+    const uint32_t* precomputedHashes = frame == g_precomputedHashes.frame
+                                            ? g_precomputedHashes.bucketHashes
+                                            : nullptr;
     do {
       if (g_serumData.frameIsScene[tj] != 0) {
         if (++tj >= g_serumData.nframes) tj = 0;
@@ -3063,7 +3369,9 @@ uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
       const uint8_t mask = bucket.mask;
       const uint8_t Shape = bucket.shape;
 
-      const uint32_t Hashc = calc_crc32(frame, mask, pixels, Shape);
+      const uint32_t Hashc = precomputedHashes
+                                 ? precomputedHashes[bucketIndex]
+                                 : calc_crc32(frame, mask, pixels, Shape);
       if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, tj)) {
         Log("Serum debug identify seed: inputCrc=%u startFrame=%u "
             "sceneRequested=false mask=%u shape=%u hash=%u",
@@ -3094,93 +3402,58 @@ uint32_t Identify_Frame(uint8_t* frame, bool sceneFrameRequested) {
     return finishProfile(IDENTIFY_NO_FRAME);
   }
 
-  memset(framechecked, false, g_serumData.nframes);
-  do {
-    if (g_serumData.frameIsScene[tj] != (sceneFrameRequested ? 1 : 0)) {
-      if (++tj >= g_serumData.nframes) tj = 0;
-      continue;
+  SceneFrameCandidate candidate;
+  if (FindSceneFrameCandidate(frame, pixels, tj, inputCrc, true, candidate)) {
+    const uint32_t ti = candidate.frameId;
+    const uint8_t mask = candidate.mask;
+    if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, ti)) {
+      Log("Serum debug identify scene candidate: inputCrc=%u frameId=%u "
+          "mask=%u shape=%u hash=%u storedHash=%u lastfound=%u",
+          inputCrc, ti, mask, candidate.shape, candidate.hash,
+          g_serumData.hashcodes[ti][0], lastfound_stream);
+    }
+    if (first_match || ti != lastfound_stream || mask < 255) {
+      if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, ti)) {
+        Log("Serum debug identify decision: inputCrc=%u frameId=%u "
+            "reason=%s firstMatch=%s lastfoundStream=%u mask=%u "
+            "fullCrcBefore=%u",
+            inputCrc, ti,
+            first_match ? "first-match"
+                        : (ti != lastfound_stream ? "new-frame-id"
+                                                  : "mask-lt-255"),
+            first_match ? "true" : "false", lastfound_stream, mask,
+            lastframe_full_crc);
+      }
+      lastfound_stream = ti;
+      lastfound = ti;
+      lastframe_full_crc = FrameCrc32(frame, pixels);
+      first_match = false;
+      return finishProfile(ti);
+    }
+
+    uint32_t full_crc = FrameCrc32(frame, pixels);
+    if (full_crc != lastframe_full_crc) {
+      if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, ti)) {
+        Log("Serum debug identify decision: inputCrc=%u frameId=%u "
+            "reason=full-crc-diff firstMatch=%s lastfoundStream=%u "
+            "mask=%u fullCrcBefore=%u fullCrcNow=%u",
+            inputCrc, ti, first_match ? "true" : "false", lastfound_stream,
+            mask, lastframe_full_crc, full_crc);
+      }
+      lastframe_full_crc = full_crc;
+      lastfound = ti;
+      return finishProfile(ti);
     }
-    if (!framechecked[tj]) {
-      // calculate the hashcode for the generated frame with the mask and
-      // shapemode of the current crom frame
-      uint8_t mask = g_serumData.compmaskID[tj][0];
-      uint8_t Shape = g_serumData.shapecompmode[tj][0];
-      uint32_t Hashc = calc_crc32(frame, mask, pixels, Shape);
-      if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, tj)) {
-        Log("Serum debug identify seed: inputCrc=%u startFrame=%u "
-            "sceneRequested=%s mask=%u shape=%u hash=%u",
-            inputCrc, tj, sceneFrameRequested ? "true" : "false", mask, Shape,
-            Hashc);
-      }
-      if (sceneFrameRequested) {
-        auto sigIt = g_serumData.sceneFramesBySignature.find(
-            MakeFrameSignature(mask, Shape, Hashc));
-        if (sigIt == g_serumData.sceneFramesBySignature.end()) {
-          framechecked[tj] = true;
-          if (++tj >= g_serumData.nframes) tj = 0;
-          continue;
-        }
-        for (uint32_t ti : sigIt->second) {
-          if (DebugIdentifyVerboseEnabled() &&
-              DebugTraceMatches(inputCrc, ti)) {
-            Log("Serum debug identify scene candidate: inputCrc=%u frameId=%u "
-                "mask=%u shape=%u hash=%u storedHash=%u lastfound=%u",
-                inputCrc, ti, mask, Shape, Hashc, g_serumData.hashcodes[ti][0],
-                lastfound_stream);
-          }
-          if (first_match || ti != lastfound_stream || mask < 255) {
-            if (DebugIdentifyVerboseEnabled() &&
-                DebugTraceMatches(inputCrc, ti)) {
-              Log("Serum debug identify decision: inputCrc=%u frameId=%u "
-                  "reason=%s firstMatch=%s lastfoundStream=%u mask=%u "
-                  "fullCrcBefore=%u",
-                  inputCrc, ti,
-                  first_match ? "first-match"
-                              : (ti != lastfound_stream ? "new-frame-id"
-                                                        : "mask-lt-255"),
-                  first_match ? "true" : "false", lastfound_stream, mask,
-                  lastframe_full_crc);
-            }
-            lastfound_stream = ti;
-            lastfound = ti;
-            lastframe_full_crc = crc32_fast(frame, pixels);
-            first_match = false;
-            return finishProfile(ti);
-          }
-
-          uint32_t full_crc = crc32_fast(frame, pixels);
-          if (full_crc != lastframe_full_crc) {
-            if (DebugIdentifyVerboseEnabled() &&
-                DebugTraceMatches(inputCrc, ti)) {
-              Log("Serum debug identify decision: inputCrc=%u frameId=%u "
-                  "reason=full-crc-diff firstMatch=%s lastfoundStream=%u "
-                  "mask=%u fullCrcBefore=%u fullCrcNow=%u",
-                  inputCrc, ti, first_match ? "true" : "false",
-                  lastfound_stream, mask, lastframe_full_crc, full_crc);
-            }
-            lastframe_full_crc = full_crc;
-            lastfound = ti;
-            return finishProfile(ti);
-          }
-          if (DebugIdentifyVerboseEnabled() &&
-              DebugTraceMatches(inputCrc, ti)) {
-            Log("Serum debug identify decision: inputCrc=%u frameId=%u "
-                "reason=same-frame firstMatch=%s lastfoundStream=%u mask=%u "
-                "fullCrc=%u",
-                inputCrc, ti, first_match ? "true" : "false", lastfound_stream,
-                mask, full_crc);
-          }
-          lastfound = ti;
-          return finishProfile(IDENTIFY_SAME_FRAME);
-        }
-        framechecked[tj] = true;
-        if (++tj >= g_serumData.nframes) tj = 0;
-        continue;
-      }
-      framechecked[tj] = true;
+    if (DebugIdentifyVerboseEnabled() && DebugTraceMatches(inputCrc, ti)) {
+      Log("Serum debug identify decision: inputCrc=%u frameId=%u "
+          "reason=same-frame firstMatch=%s lastfoundStream=%u mask=%u "
+          "fullCrc=%u",
+          inputCrc, ti, first_match ? "true" : "false", lastfound_stream, mask,
+          full_crc);
     }
-    if (++tj >= g_serumData.nframes) tj = 0;
-  } while (tj != lastfound_stream);
+    lastfound = ti;
+    return finishProfile(IDENTIFY_SAME_FRAME);
+  }
 
   if (DebugIdentifyVerboseEnabled() && DebugTraceMatchesInputCrc(inputCrc)) {
     Log("Serum debug identify miss: inputCrc=%u sceneRequested=%s", inputCrc,
@@ -3410,6 +3683,7 @@ bool Check_Spritesv2(uint8_t* recframe, uint32_t quelleframe,
                      uint8_t* pquelsprites, uint8_t* nspr, uint16_t* pfrx,
                      uint16_t* pfry, uint16_t* pspx, uint16_t* pspy,
                      uint16_t* pwid, uint16_t* phei) {
+  SERUM_TRACE_SCOPE("Check_Spritesv2");
   *nspr = 0;
   if (g_serumData.fwidth < 4 || quelleframe >= g_serumData.nframes) {
     return false;
@@ -3419,16 +3693,9 @@ bool Check_Spritesv2(uint8_t* recframe, uint32_t quelleframe,
   std::unordered_set<uint32_t> frameDwords;
   frameDwords.reserve(static_cast<size_t>(g_serumData.fheight) *
                       std::max(1u, g_serumData.fwidth - 3));
-  for (uint32_t y = 0; y < g_serumData.fheight; ++y) {
-    const uint32_t rowBase = y * g_serumData.fwidth;
-    uint32_t dword = (uint32_t)(recframe[rowBase] << 8) |
-                     (uint32_t)(recframe[rowBase + 1] << 16) |
-                     (uint32_t)(recframe[rowBase + 2] << 24);
-    for (uint32_t x = 0; x <= g_serumData.fwidth - 4; ++x) {
-      dword = (dword >> 8) | (uint32_t)(recframe[rowBase + x + 3] << 24);
-      frameDwords.insert(dword);
-    }
-  }
+  const GeometryKernels& kernels = *g_frameKernels;
+  kernels.collectRowDwords(recframe, g_serumData.fwidth, g_serumData.fheight,
+                           frameDwords);
   std::unordered_set<uint32_t> frameShapeDwords;
   bool frameShapeDwordsBuilt = false;
 
@@ -3492,9 +3759,8 @@ bool Check_Spritesv2(uint8_t* recframe, uint32_t quelleframe,
                                   : (g_serumData.sprshapemode[qspr][0] > 0);
     if (isshapecheck && frameHasShapeCandidates) {
       if (!hasShapeFrameBuffer) {
-        for (int i = 0; i < g_serumData.fwidth * g_serumData.fheight; i++) {
-          frameshape[i] = (Frame[i] > 0) ? 1 : 0;
-        }
+        g_simdKernels->buildShape(Frame, frameshape,
+                                  g_serumData.fwidth * g_serumData.fheight);
         hasShapeFrameBuffer = true;
       }
       Frame = frameshape;
@@ -3502,17 +3768,8 @@ bool Check_Spritesv2(uint8_t* recframe, uint32_t quelleframe,
         frameShapeDwords.clear();
         frameShapeDwords.reserve(static_cast<size_t>(g_serumData.fheight) *
                                  std::max(1u, g_serumData.fwidth - 3));
-        for (uint32_t y = 0; y < g_serumData.fheight; ++y) {
-          const uint32_t rowBase = y * g_serumData.fwidth;
-          uint32_t dword = (uint32_t)(frameshape[rowBase] << 8) |
-                           (uint32_t)(frameshape[rowBase + 1] << 16) |
-                           (uint32_t)(frameshape[rowBase + 2] << 24);
-          for (uint32_t x = 0; x <= g_serumData.fwidth - 4; ++x) {
-            dword =
-                (dword >> 8) | (uint32_t)(frameshape[rowBase + x + 3] << 24);
-            frameShapeDwords.insert(dword);
-          }
-        }
+        kernels.collectRowDwords(frameshape, g_serumData.fwidth,
+                                 g_serumData.fheight, frameShapeDwords);
         frameShapeDwordsBuilt = true;
       }
     }
@@ -3805,6 +4062,15 @@ bool ColorInRotation(uint32_t IDfound, uint16_t col, uint16_t* norot,
   return false;
 }
 
+// True if a v2 frame has any color rotation, i.e. ColorInRotation() can match
+// its colors.
+static bool HasColorRotations(const uint16_t* rotations) {
+  for (int i = 0; i < MAX_COLOR_ROTATION_V2; i++) {
+    if (rotations[i * MAX_LENGTH_COLOR_ROTATION] > 0) return true;
+  }
+  return false;
+}
+
 void CheckDynaShadow(uint16_t* pfr, const uint8_t* shadowDirByLayer,
                      const uint16_t* shadowColorByLayer, uint8_t dynacouche,
                      uint8_t* isdynapix, uint16_t fx, uint16_t fy, uint32_t fw,
@@ -3828,30 +4094,46 @@ void CheckDynaShadow(uint16_t* pfr, const uint8_t* shadowDirByLayer,
   }
 }
 
-void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
-                      bool applySceneBackground = false,
-                      bool blackOutStaticContent = false,
-                      bool replaceDynamicBlackContent = false,
-                      bool suppressFrameBackgroundImage = false) {
+// Output planes and rotation phases Colorize_Framev2 renders with. The live
+// target is mySerum; the scene pre-render worker renders into its own slots.
+struct ColorizeTarget {
+  uint16_t* frame32;
+  uint16_t* frame64;
+  uint16_t* rotationsinframe32;
+  uint16_t* rotationsinframe64;
+  uint32_t width32;
+  uint32_t width64;
+  uint8_t flags;
+  const uint32_t* colorshifts32;
+  const uint32_t* colorshifts64;
+  bool logAssets;
+};
+
+static void Colorize_Framev2Into(ColorizeTarget& target, uint8_t* frame,
+                                 uint32_t IDfound, bool applySceneBackground,
+                                 bool blackOutStaticContent,
+                                 bool replaceDynamicBlackContent,
+                                 bool suppressFrameBackgroundImage) {
+  SERUM_TRACE_SCOPE("Colorize_Framev2");
   uint16_t tj, ti;
   // Generate the colorized version of a frame once identified in the crom
   // frames
   bool isextra = CheckExtraFrameAvailable(IDfound);
-  mySerum.flags &= 0b11111100;
+  target.flags &= 0b11111100;
   uint16_t* pfr;
   uint16_t* prot;
   uint16_t* prt;
-  uint32_t* cshft;
+  const uint32_t* cshft;
   uint16_t* pSceneBackgroundFrame;
-  if (mySerum.frame32) mySerum.width32 = 0;
-  if (mySerum.frame64) mySerum.width64 = 0;
+  if (target.frame32) target.width32 = 0;
+  if (target.frame64) target.width64 = 0;
   uint8_t isdynapix[256 * 64];
   const bool renderExtra =
       isextrarequested && (!isoriginalfallbackrequested || isextra);
   const bool renderOriginal =
       (isoriginalrequested || (isoriginalfallbackrequested && !isextra));
-  if (((mySerum.frame32 && g_serumData.fheight == 32) ||
-       (mySerum.frame64 && g_serumData.fheight == 64)) &&
+  if (((target.frame32 && g_serumData.fheight == 32) ||
+       (target.frame64 && g_serumData.fheight == 64)) &&
       renderOriginal) {
     const uint16_t backgroundId = g_serumData.backgroundIDs[IDfound][0];
     const bool hasBackground = backgroundId < g_serumData.nbackgrounds;
@@ -3873,27 +4155,29 @@ void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
         frameHasDynamic ? g_serumData.dynashadowscol[IDfound] : nullptr;
     // create the original res frame
     if (g_serumData.fheight == 32) {
-      pfr = mySerum.frame32;
-      mySerum.flags |= FLAG_RETURNED_32P_FRAME_OK;
-      prot = mySerum.rotationsinframe32;
-      mySerum.width32 = g_serumData.fwidth;
+      pfr = target.frame32;
+      target.flags |= FLAG_RETURNED_32P_FRAME_OK;
+      prot = target.rotationsinframe32;
+      target.width32 = g_serumData.fwidth;
       prt = g_serumData.colorrotations_v2[IDfound];
-      cshft = colorshifts32;
-      pSceneBackgroundFrame = mySerum.frame32;
+      cshft = target.colorshifts32;
+      pSceneBackgroundFrame = target.frame32;
     } else {
-      pfr = mySerum.frame64;
-      mySerum.flags |= FLAG_RETURNED_64P_FRAME_OK;
-      prot = mySerum.rotationsinframe64;
-      mySerum.width64 = g_serumData.fwidth;
+      pfr = target.frame64;
+      target.flags |= FLAG_RETURNED_64P_FRAME_OK;
+      prot = target.rotationsinframe64;
+      target.width64 = g_serumData.fwidth;
       prt = g_serumData.colorrotations_v2[IDfound];
-      cshft = colorshifts64;
-      pSceneBackgroundFrame = mySerum.frame64;
+      cshft = target.colorshifts64;
+      pSceneBackgroundFrame = target.frame64;
+    }
+    if (target.logAssets) {
+      DebugLogColorizeFrameV2Assets(
+          IDfound, g_debugCurrentInputCrc, false, g_serumData.fwidth,
+          g_serumData.fheight, frameColors, frameBackgroundMask,
+          frameBackground, frameHasDynamic, frameDyna, frameDynaActive,
+          frameDynaColors, prt, backgroundId);
     }
-    DebugLogColorizeFrameV2Assets(
-        IDfound, g_debugCurrentInputCrc, false, g_serumData.fwidth,
-        g_serumData.fheight, frameColors, frameBackgroundMask, frameBackground,
-        frameHasDynamic, frameDyna, frameDynaActive, frameDynaColors, prt,
-        backgroundId);
     if (applySceneBackground)
       memcpy(sceneBackgroundFrame, pSceneBackgroundFrame,
              g_serumData.fwidth * g_serumData.fheight * sizeof(uint16_t));
@@ -3901,8 +4185,24 @@ void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
       sceneBackgroundWidth = g_serumData.fwidth;
       sceneBackgroundHeight = g_serumData.fheight;
     }
-    memset(isdynapix, 0, g_serumData.fheight * g_serumData.fwidth);
-    for (tj = 0; tj < g_serumData.fheight; tj++) {
+    const bool staticFrame =
+        !frameHasDynamic && !applySceneBackground && !blackOutStaticContent &&
+        !suppressFrameBackgroundImage && !HasColorRotations(prt);
+    if (staticFrame) {
+      // Nothing left to decide per pixel: each one is the frame color, or the
+      // background color where the mask shows the background through.
+      const uint32_t pixels = g_serumData.fwidth * g_serumData.fheight;
+      if (hasBackground) {
+        g_simdKernels->composeStatic(pfr, frameColors, frameBackground, frame,
+                                     frameBackgroundMask, pixels);
+      } else {
+        memcpy(pfr, frameColors, pixels * sizeof(uint16_t));
+      }
+      g_simdKernels->clearRotations(prot, pixels);
+    } else {
+      memset(isdynapix, 0, g_serumData.fheight * g_serumData.fwidth);
+    }
+    for (tj = 0; !staticFrame && tj < g_serumData.fheight; tj++) {
       for (ti = 0; ti < g_serumData.fwidth; ti++) {
         uint16_t tk = tj * g_serumData.fwidth + ti;
         if (hasBackground && (frame[tk] == 0) &&
@@ -3988,8 +4288,8 @@ void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
     }
   }
   if (isextra && renderExtra &&
-      ((mySerum.frame32 && g_serumData.fheight_extra == 32) ||
-       (mySerum.frame64 && g_serumData.fheight_extra == 64)) &&
+      ((target.frame32 && g_serumData.fheight_extra == 32) ||
+       (target.frame64 && g_serumData.fheight_extra == 64)) &&
       isextrarequested) {
     const uint16_t backgroundId = g_serumData.backgroundIDs[IDfound][0];
     const bool hasBackground = backgroundId < g_serumData.nbackgrounds;
@@ -4018,27 +4318,30 @@ void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
                              : nullptr;
     // create the extra res frame
     if (g_serumData.fheight_extra == 32) {
-      pfr = mySerum.frame32;
-      mySerum.flags |= FLAG_RETURNED_32P_FRAME_OK;
-      prot = mySerum.rotationsinframe32;
-      mySerum.width32 = g_serumData.fwidth_extra;
+      pfr = target.frame32;
+      target.flags |= FLAG_RETURNED_32P_FRAME_OK;
+      prot = target.rotationsinframe32;
+      target.width32 = g_serumData.fwidth_extra;
       prt = g_serumData.colorrotations_v2_extra[IDfound];
-      cshft = colorshifts32;
-      pSceneBackgroundFrame = mySerum.frame32;
+      cshft = target.colorshifts32;
+      pSceneBackgroundFrame = target.frame32;
     } else {
-      pfr = mySerum.frame64;
-      mySerum.flags |= FLAG_RETURNED_64P_FRAME_OK;
-      prot = mySerum.rotationsinframe64;
-      mySerum.width64 = g_serumData.fwidth_extra;
+      pfr = target.frame64;
+      target.flags |= FLAG_RETURNED_64P_FRAME_OK;
+      prot = target.rotationsinframe64;
+      target.width64 = g_serumData.fwidth_extra;
       prt = g_serumData.colorrotations_v2_extra[IDfound];
-      cshft = colorshifts64;
-      pSceneBackgroundFrame = mySerum.frame64;
+      cshft = target.colorshifts64;
+      pSceneBackgroundFrame = target.frame64;
+    }
+    if (target.logAssets) {
+      DebugLogColorizeFrameV2Assets(
+          IDfound, g_debugCurrentInputCrc, true, g_serumData.fwidth_extra,
+          g_serumData.fheight_extra, frameColorsExtra,
+          frameBackgroundMaskExtra, frameBackgroundExtra, frameHasDynamicExtra,
+          frameDynaExtra, frameDynaExtraActive, frameDynaColorsExtra, prt,
+          backgroundId);
     }
-    DebugLogColorizeFrameV2Assets(
-        IDfound, g_debugCurrentInputCrc, true, g_serumData.fwidth_extra,
-        g_serumData.fheight_extra, frameColorsExtra, frameBackgroundMaskExtra,
-        frameBackgroundExtra, frameHasDynamicExtra, frameDynaExtra,
-        frameDynaExtraActive, frameDynaColorsExtra, prt, backgroundId);
     if (applySceneBackground)
       memcpy(sceneBackgroundFrame, pSceneBackgroundFrame,
              g_serumData.fwidth_extra * g_serumData.fheight_extra *
@@ -4147,6 +4450,29 @@ void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
   }
 }
 
+void Colorize_Framev2(uint8_t* frame, uint32_t IDfound,
+                      bool applySceneBackground = false,
+                      bool blackOutStaticContent = false,
+                      bool replaceDynamicBlackContent = false,
+                      bool suppressFrameBackgroundImage = false) {
+  ColorizeTarget target = {mySerum.frame32,
+                           mySerum.frame64,
+                           mySerum.rotationsinframe32,
+                           mySerum.rotationsinframe64,
+                           mySerum.width32,
+                           mySerum.width64,
+                           mySerum.flags,
+                           colorshifts32,
+                           colorshifts64,
+                           true};
+  Colorize_Framev2Into(target, frame, IDfound, applySceneBackground,
+                       blackOutStaticContent, replaceDynamicBlackContent,
+                       suppressFrameBackgroundImage);
+  mySerum.width32 = target.width32;
+  mySerum.width64 = target.width64;
+  mySerum.flags = target.flags;
+}
+
 void Colorize_Spritev1(uint8_t nosprite, uint16_t frx, uint16_t fry,
                        uint16_t spx, uint16_t spy, uint16_t wid, uint16_t hei) {
   if (!g_serumData.spritedescriptionso_opaque.hasData(nosprite)) return;
@@ -4167,6 +4493,7 @@ void Colorize_Spritev1(uint8_t nosprite, uint16_t frx, uint16_t fry,
 void Colorize_Spritev2(uint8_t* oframe, uint8_t nosprite, uint16_t frx,
                        uint16_t fry, uint16_t spx, uint16_t spy, uint16_t wid,
                        uint16_t hei, uint32_t IDfound) {
+  SERUM_TRACE_SCOPE("Colorize_Spritev2");
   uint16_t *pfr, *prot;
   uint16_t* prt;
   uint32_t* cshft;
@@ -4227,7 +4554,18 @@ void Colorize_Spritev2(uint8_t* oframe, uint8_t nosprite, uint16_t frx,
       prt = g_serumData.colorrotations_v2[IDfound];
       cshft = colorshifts64;
     }
-    for (uint16_t tj = 0; tj < hei; tj++) {
+    const bool staticSprite =
+        hasColor && !hasDynaActive && !HasColorRotations(prt);
+    if (staticSprite) {
+      const uint16_t* spriteColors = g_serumData.spritecolored[nosprite];
+      for (uint16_t tj = 0; tj < hei; tj++) {
+        const uint32_t tk = (fry + tj) * g_serumData.fwidth + frx;
+        const uint32_t tl = (tj + spy) * MAX_SPRITE_WIDTH + spx;
+        g_simdKernels->blendSprite(&pfr[tk], &prot[tk * 2], &spriteColors[tl],
+                                   &spriteOpaque[tl], wid);
+      }
+    }
+    for (uint16_t tj = 0; !staticSprite && tj < hei; tj++) {
       for (uint16_t ti = 0; ti < wid; ti++) {
         uint16_t tk = (fry + tj) * g_serumData.fwidth + frx + ti;
         uint32_t tl = (tj + spy) * MAX_SPRITE_WIDTH + ti + spx;
@@ -4461,7 +4799,8 @@ uint32_t Serum_ColorizeWithMetadatav1(uint8_t* frame) {
 
   // Let's first identify the incoming frame among the ones we have in the crom
   const uint32_t inputCrc =
-      (frame && g_serumData.fwidth > 0 && g_serumData.fheight > 0)
+      (DebugTracingActive() && frame && g_serumData.fwidth > 0 &&
+       g_serumData.fheight > 0)
           ? crc32_fast(frame, g_serumData.fwidth * g_serumData.fheight)
           : 0;
   g_debugCurrentInputCrc = inputCrc;
@@ -4531,13 +4870,23 @@ uint32_t Serum_ColorizeWithMetadatav1(uint8_t* frame) {
         wid[MAX_SPRITES_PER_FRAME], hei[MAX_SPRITES_PER_FRAME];
     memset(nosprite, 255, MAX_SPRITES_PER_FRAME);
 
-    bool isspr = Check_Spritesv1(frame, (uint32_t)lastfound, nosprite, &nspr,
-                                 frx, fry, spx, spy, wid, hei);
+    bool isspr;
+    {
+      ScopedPerfStage perfStage(g_perfCounters, SERUM_PERF_STAGE_SPRITE_CHECK);
+      isspr = Check_Spritesv1(frame, (uint32_t)lastfound, nosprite, &nspr, frx,
+                              fry, spx, spy, wid, hei);
+    }
     if (((frameID < MAX_NUMBER_FRAMES) || isspr) &&
         FrameHasRenderableContent(lastfound)) {
-      Colorize_Framev1(frame, lastfound);
-      Copy_Frame_Palette(lastfound);
       {
+        ScopedPerfStage perfStage(g_perfCounters,
+                                  SERUM_PERF_STAGE_COLORIZE_FRAME);
+        Colorize_Framev1(frame, lastfound);
+        Copy_Frame_Palette(lastfound);
+      }
+      if (nspr > 0) {
+        ScopedPerfStage perfStage(g_perfCounters,
+                                  SERUM_PERF_STAGE_COLORIZE_SPRITE);
         uint32_t ti = 0;
         while (ti < nspr) {
           Colorize_Spritev1(nosprite[ti], frx[ti], fry[ti], spx[ti], spy[ti],
@@ -4665,10 +5014,7 @@ static bool CaptureMonochromePaletteFromFrameV2(uint32_t frameId) {
 
 static bool IsFullBlackFrame(const uint8_t* frame, uint32_t size) {
   if (!frame || size == 0) return false;
-  for (uint32_t i = 0; i < size; i++) {
-    if (frame[i] != 0) return false;
-  }
-  return true;
+  return g_simdKernels->isZero(frame, size);
 }
 
 static void ConfigureSceneEndHold(uint16_t sceneId, bool interruptable,
@@ -4716,6 +5062,132 @@ static void ForceNormalFrameRefreshAfterSceneEnd(void) {
   lastframe_full_crc_normal = 0xffffffff;
 }
 
+// Bytes per input frame read by Identify_Frame(): files for 256x64 ROMs
+// always take 256x64 frames.
+static uint32_t InputFramePixels(void) {
+  return g_serumData.is256x64 ? (256 * 64)
+                              : (g_serumData.fwidth * g_serumData.fheight);
+}
+
+static uint32_t OutputPlaneWidth(uint32_t height) {
+  if (g_serumData.fheight == height) return g_serumData.fwidth;
+  return g_serumData.fheight_extra == height ? g_serumData.fwidth_extra : 0;
+}
+
+// Runs on the pre-render worker with the API mutex held. Resolves the frame
+// the same way Serum_RenderScene() would (triplet lookup, else generate and
+// search the scene frames) and colorizes it into the slot. The worker emits
+// no trace events or debug logs; they would be attributed to whichever call
+// happens to be running.
+static bool PrerenderSceneFrame(const ScenePrerenderJob& job,
+                                uint16_t frameIndex, ScenePrerenderChain& chain,
+                                ScenePrerenderSlot& slot) {
+  serum_trace::g_threadSuppressed = true;
+  if (!cromloaded || !g_serumData.sceneGenerator ||
+      chain.input.size() < sizeof(sceneFrame)) {
+    return false;
+  }
+  uint32_t frameId = IDENTIFY_NO_FRAME;
+  if (!g_serumData.sceneFrameIdByTriplet.empty()) {
+    auto it = g_serumData.sceneFrameIdByTriplet.find(
+        MakeSceneTripletKey(job.sceneId, job.group, frameIndex));
+    if (it != g_serumData.sceneFrameIdByTriplet.end() &&
+        it->second < g_serumData.nframes) {
+      frameId = it->second;
+    }
+  }
+  if (frameId == IDENTIFY_NO_FRAME) {
+    g_serumData.sceneGenerator->renderFrame(job.sceneId, frameIndex, job.group,
+                                            chain.input.data());
+    const uint32_t pixels = g_serumData.is256x64
+                                ? (256 * 64)
+                                : (g_serumData.fwidth * g_serumData.fheight);
+    SceneFrameCandidate candidate;
+    if (!FindSceneFrameCandidate(chain.input.data(), pixels, chain.searchStart,
+                                 0, false, candidate)) {
+      return false;
+    }
+    frameId = candidate.frameId;
+  }
+  chain.searchStart = frameId;
+
+  const uint32_t width32 = mySerum.frame32 ? OutputPlaneWidth(32) : 0;
+  const uint32_t width64 = mySerum.frame64 ? OutputPlaneWidth(64) : 0;
+  slot.frame32.resize(32 * width32);
+  slot.rotationsinframe32.resize(2 * 32 * width32);
+  slot.frame64.resize(64 * width64);
+  slot.rotationsinframe64.resize(2 * 64 * width64);
+  ColorizeTarget target = {width32 ? slot.frame32.data() : nullptr,
+                           width64 ? slot.frame64.data() : nullptr,
+                           slot.rotationsinframe32.data(),
+                           slot.rotationsinframe64.data(),
+                           mySerum.width32,
+                           mySerum.width64,
+                           0,
+                           job.colorshifts32,
+                           job.colorshifts64,
+                           false};
+  Colorize_Framev2Into(target, chain.input.data(), frameId, false, false, false,
+                       false);
+  slot.frameId = frameId;
+  slot.width32 = target.width32;
+  slot.width64 = target.width64;
+  slot.flags = target.flags;
+  return true;
+}
+
+// Uses the pre-rendered slot instead of Colorize_Framev2() when it was
+// rendered from the same input, frame and rotation phases, which makes the
+// copied planes identical to a synchronous render.
+static bool ApplyPrerenderedSceneFrame(const uint8_t* frame, uint32_t frameId) {
+  const ScenePrerenderSlot* slot = g_scenePrerenderHit;
+  const ScenePrerenderJob* job = g_scenePrerender.ActiveJob();
+  const uint32_t pixels = g_serumData.fwidth * g_serumData.fheight;
+  if (!slot || !job || slot->frameId != frameId ||
+      slot->after.input.size() < pixels ||
+      memcmp(slot->after.input.data(), frame, pixels) != 0 ||
+      memcmp(job->colorshifts32, colorshifts32, sizeof(colorshifts32)) != 0 ||
+      memcmp(job->colorshifts64, colorshifts64, sizeof(colorshifts64)) != 0) {
+    return false;
+  }
+  if (mySerum.frame32 && !slot->frame32.empty()) {
+    memcpy(mySerum.frame32, slot->frame32.data(),
+           slot->frame32.size() * sizeof(uint16_t));
+    memcpy(mySerum.rotationsinframe32, slot->rotationsinframe32.data(),
+           slot->rotationsinframe32.size() * sizeof(uint16_t));
+  }
+  if (mySerum.frame64 && !slot->frame64.empty()) {
+    memcpy(mySerum.frame64, slot->frame64.data(),
+           slot->frame64.size() * sizeof(uint16_t));
+    memcpy(mySerum.rotationsinframe64, slot->rotationsinframe64.data(),
+           slot->rotationsinframe64.size() * sizeof(uint16_t));
+  }
+  mySerum.width32 = slot->width32;
+  mySerum.width64 = slot->width64;
+  mySerum.flags = (mySerum.flags & 0b11111100) | (slot->flags & 0b00000011);
+  return true;
+}
+
+// Hands the frames after the one just rendered to the pre-render worker.
+static void RequestScenePrerender(uint8_t group) {
+  if (!g_scenePrerenderEnabled || sceneCurrentFrame == 0 ||
+      sceneCurrentFrame >= sceneFrameCount ||
+      (sceneOptionFlags & FLAG_SCENE_AS_BACKGROUND) ==
+          FLAG_SCENE_AS_BACKGROUND) {
+    return;
+  }
+  ScenePrerenderJob job;
+  job.sceneId = static_cast<uint16_t>(lastTriggerID);
+  job.group = group;
+  job.frameCount = sceneFrameCount;
+  job.firstFrame = sceneCurrentFrame;
+  job.chain.searchStart = lastfound_scene;
+  job.chain.input.assign(sceneFrame, sceneFrame + sizeof(sceneFrame));
+  memcpy(job.colorshifts32, colorshifts32, sizeof(colorshifts32));
+  memcpy(job.colorshifts64, colorshifts64, sizeof(colorshifts64));
+  g_scenePrerender.Request(job);
+}
+
 static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
                                                      bool sceneFrameRequested,
                                                      uint32_t knownFrameId) {
@@ -4727,9 +5199,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
   mySerum.frameID = IDENTIFY_NO_FRAME;
   g_debugCurrentInputCrc = 0;
   bool backgroundScenePrimedThisCall = false;
-  if (g_profileDynamicHotPaths && !sceneFrameRequested &&
-      knownFrameId >= g_serumData.nframes) {
-    ++g_profileIncomingFrameCalls;
+  if (!sceneFrameRequested && knownFrameId >= g_serumData.nframes) {
+    ++g_perfCounters.inputFrames;
   }
 
   // Identify frame unless caller already resolved a concrete frame ID.
@@ -4743,8 +5214,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
   if (fastRejectNonInterruptableScene) {
     frameID = IdentifyCriticalTriggerFrame(frame);
     if (frameID == IDENTIFY_NO_FRAME) {
-      if (g_profileDynamicHotPaths && !sceneFrameRequested) {
-        ++g_profileNoFrameReturns;
+      if (!sceneFrameRequested) {
+        ++g_perfCounters.noFrameReturns;
       }
       MaybeLogDynamicHotPathProfileWindow(sceneFrameRequested);
       return IDENTIFY_NO_FRAME;
@@ -4770,7 +5241,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
   } else {
     frameID = Identify_Frame(frame, sceneFrameRequested);
   }
-  if (frame && g_serumData.fwidth > 0 && g_serumData.fheight > 0) {
+  if (DebugTracingActive() && frame && g_serumData.fwidth > 0 &&
+      g_serumData.fheight > 0) {
     g_debugCurrentInputCrc =
         crc32_fast(frame, g_serumData.fwidth * g_serumData.fheight);
   }
@@ -4826,8 +5298,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
             mySerum.triggerID >= PUP_TRIGGER_MAX_THRESHOLD)
           mySerum.triggerID = 0xffffffff;
         // Scene is active and not interruptable
-        if (g_profileDynamicHotPaths && !sceneFrameRequested) {
-          ++g_profileNoFrameReturns;
+        if (!sceneFrameRequested) {
+          ++g_perfCounters.noFrameReturns;
         }
         MaybeLogDynamicHotPathProfileWindow(sceneFrameRequested);
         return IDENTIFY_NO_FRAME;
@@ -4874,8 +5346,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
       if (keepTriggersInternal ||
           mySerum.triggerID >= PUP_TRIGGER_MAX_THRESHOLD)
         mySerum.triggerID = 0xffffffff;
-      if (g_profileDynamicHotPaths && !sceneFrameRequested) {
-        ++g_profileSameFrameReturns;
+      if (!sceneFrameRequested) {
+        ++g_perfCounters.sameFrameReturns;
       }
       MaybeLogDynamicHotPathProfileWindow(sceneFrameRequested);
       return IDENTIFY_SAME_FRAME;
@@ -4915,9 +5387,7 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
         // New frame has the same Trigger ID, continuing an already running
         // seamless looped scene.
         // Wait for the next rotation to have a smooth transition.
-        if (g_profileDynamicHotPaths) {
-          ++g_profileSameFrameReturns;
-        }
+        ++g_perfCounters.sameFrameReturns;
         MaybeLogDynamicHotPathProfileWindow(sceneFrameRequested);
         return IDENTIFY_SAME_FRAME;
       } else if (sceneIsLastBackgroundFrame &&
@@ -4932,9 +5402,7 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
                  ShouldSuppressFinishedSceneRetrigger(matchedTriggerId)) {
         // Keep the last visible scene frame instead of immediately
         // retriggering the same scene on the next matching normal frame.
-        if (g_profileDynamicHotPaths) {
-          ++g_profileSameFrameReturns;
-        }
+        ++g_perfCounters.sameFrameReturns;
         MaybeLogDynamicHotPathProfileWindow(sceneFrameRequested);
         return IDENTIFY_SAME_FRAME;
       } else {
@@ -5083,22 +5551,29 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
         wid[MAX_SPRITES_PER_FRAME], hei[MAX_SPRITES_PER_FRAME];
     memset(nosprite, 255, MAX_SPRITES_PER_FRAME);
 
-    bool isspr = (sceneFrameRequested && !isBackgroundSceneRequested)
-                     ? false
-                     : Check_Spritesv2(
-                           isBackgroundSceneRequested ? lastFrame : frame,
-                           isBackgroundSceneRequested ? lastFrameId : lastfound,
-                           nosprite, &nspr, frx, fry, spx, spy, wid, hei);
+    bool isspr = false;
+    if (!sceneFrameRequested || isBackgroundSceneRequested) {
+      ScopedPerfStage perfStage(g_perfCounters, SERUM_PERF_STAGE_SPRITE_CHECK);
+      isspr = Check_Spritesv2(
+          isBackgroundSceneRequested ? lastFrame : frame,
+          isBackgroundSceneRequested ? lastFrameId : lastfound, nosprite, &nspr,
+          frx, fry, spx, spy, wid, hei);
+    }
     if (((frameID < MAX_NUMBER_FRAMES) || isspr) &&
         FrameHasRenderableContent(lastfound)) {
-      const bool profileNow = g_profileDynamicHotPaths;
-      std::chrono::steady_clock::time_point profStart;
-      if (profileNow) {
-        profStart = std::chrono::steady_clock::now();
+      if (!sceneFrameRequested && g_serumData.IsUpconvertedV1()) {
+        // v1 reloads the frame palette for every new frame, which restarts
+        // its color rotations at their first color.
+        memset(colorshifts32, 0, sizeof(colorshifts32));
+        memset(colorshifts64, 0, sizeof(colorshifts64));
       }
+      const uint64_t frameStartNs = PerfCounters::NowNs();
       if (!sceneIsLastBackgroundFrame && !backgroundScenePrimedThisCall) {
-        Colorize_Framev2(frame, lastfound, false, false, false,
-                         suppressPlaceholderBackground);
+        if (!sceneFrameRequested || isBackgroundScene ||
+            !ApplyPrerenderedSceneFrame(frame, lastfound)) {
+          Colorize_Framev2(frame, lastfound, false, false, false,
+                           suppressPlaceholderBackground);
+        }
         DebugHashCurrentOutputFrame(lastfound, false);
       }
       if ((isBackgroundSceneRequested) || sceneIsLastBackgroundFrame) {
@@ -5112,17 +5587,9 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
                          replaceDynamicBlackForeground);
         DebugHashCurrentOutputFrame(lastFrameId, false);
       }
-      if (profileNow) {
-        g_profileColorizeFrameV2Ns +=
-            (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-                std::chrono::steady_clock::now() - profStart)
-                .count();
-      }
+      g_perfCounters.RecordSince(SERUM_PERF_STAGE_COLORIZE_FRAME, frameStartNs);
       if (isspr) {
-        std::chrono::steady_clock::time_point spriteStart;
-        if (profileNow) {
-          spriteStart = std::chrono::steady_clock::now();
-        }
+        const uint64_t spriteStartNs = PerfCounters::NowNs();
         uint8_t ti = 0;
         while (ti < nspr) {
           Colorize_Spritev2(
@@ -5150,12 +5617,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
               g_debugCurrentInputCrc,
               static_cast<unsigned long long>(spriteHash), nspr);
         }
-        if (profileNow) {
-          g_profileColorizeSpriteV2Ns +=
-              (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
-                  std::chrono::steady_clock::now() - spriteStart)
-                  .count();
-        }
+        g_perfCounters.RecordSince(SERUM_PERF_STAGE_COLORIZE_SPRITE,
+                                   spriteStartNs);
       }
       FinishProfileRenderedFrameOperationMaybe();
 
@@ -5373,8 +5836,8 @@ static uint32_t Serum_ColorizeWithMetadatav2Internal(uint8_t* frame,
     return 0;  // "colorized" frame with no rotations
   }
 
-  if (g_profileDynamicHotPaths && !sceneFrameRequested) {
-    ++g_profileNoFrameReturns;
+  if (!sceneFrameRequested) {
+    ++g_perfCounters.noFrameReturns;
   }
   return IDENTIFY_NO_FRAME;  // no new frame, client has to update rotations!
 }
@@ -5391,16 +5854,502 @@ Serum_ColorizeWithMetadatav2(uint8_t* frame, bool sceneFrameRequested = false) {
   SERUM_API_GUARD_END("Serum_ColorizeWithMetadatav2", IDENTIFY_NO_FRAME)
 }
 
+// Rebuilds the v1 palette of an upconverted project from the frame palette
+// and the running v2 color rotation shifts.
+static void UpdateV1CompatPalette(void) {
+  uint8_t original[3 * 64] = {};
+  memcpy(original, g_serumData.cpal[g_v1CompatFrameId],
+         3 * g_serumData.nccolors);
+  memcpy(mySerum.palette, original, sizeof(original));
+  const uint32_t* shifts =
+      g_serumData.fheight == 32 ? colorshifts32 : colorshifts64;
+  for (uint32_t ti = 0; ti < MAX_COLOR_ROTATION_V2; ti++) {
+    const uint8_t first = mySerum.rotations[ti * 3];
+    const uint8_t length = mySerum.rotations[ti * 3 + 1];
+    if (first == 255 || length == 0) continue;
+    for (uint32_t tj = 0; tj < length; tj++) {
+      memcpy(&mySerum.palette[(first + tj) * 3],
+             &original[(first + (tj + shifts[ti]) % length) * 3], 3);
+    }
+  }
+}
+
+// Maps the colorized original resolution plane of an upconverted project
+// back to the v1 palette indices of the identified frame.
+static void UpdateV1CompatFrame(void) {
+  if (lastfound >= g_serumData.nframes) return;
+  g_v1CompatFrameId = lastfound;
+  memcpy(mySerum.rotations, g_serumData.colorrotations[lastfound],
+         MAX_COLOR_ROTATIONS * 3);
+  uint8_t palette[3 * 64];
+  memcpy(palette, g_serumData.cpal[lastfound], 3 * g_serumData.nccolors);
+  uint16_t palette565[64];
+  bool rotating[64] = {};
+  for (uint32_t ti = 0; ti < g_serumData.nccolors; ti++) {
+    palette565[ti] = (uint16_t)(((palette[ti * 3] >> 3) << 11) |
+                                ((palette[ti * 3 + 1] >> 2) << 5) |
+                                (palette[ti * 3 + 2] >> 3));
+  }
+  for (uint32_t ti = 0; ti < MAX_COLOR_ROTATION_V2; ti++) {
+    const uint8_t first = mySerum.rotations[ti * 3];
+    if (first == 255) continue;
+    for (uint32_t tj = 0; tj < mySerum.rotations[ti * 3 + 1]; tj++) {
+      rotating[first + tj] = true;
+    }
+  }
+
+  const bool is32 = g_serumData.fheight == 32;
+  const uint16_t* plane = is32 ? mySerum.frame32 : mySerum.frame64;
+  const uint16_t* prot =
+      is32 ? mySerum.rotationsinframe32 : mySerum.rotationsinframe64;
+  uint16_t lastColor = 0;
+  uint8_t lastIndex = 0;
+  bool hasLast = false;
+  const uint32_t pixels = g_serumData.fwidth * g_serumData.fheight;
+  for (uint32_t tk = 0; tk < pixels; tk++) {
+    const uint16_t rotation = prot[tk * 2];
+    if (rotation < MAX_COLOR_ROTATION_V2 &&
+        mySerum.rotations[rotation * 3] != 255) {
+      mySerum.frame[tk] =
+          (uint8_t)(mySerum.rotations[rotation * 3] + prot[tk * 2 + 1]);
+      continue;
+    }
+    const uint16_t color = plane[tk];
+    if (!hasLast || color != lastColor) {
+      // Non-rotating pixels must not pick up a rotating index of the same
+      // color, that index would change with the palette.
+      lastIndex = 0;
+      bool found = false;
+      for (int pass = 0; pass < 2 && !found; pass++) {
+        for (uint32_t ti = 0; ti < g_serumData.nccolors; ti++) {
+          if (palette565[ti] == color && rotating[ti] == (pass == 1)) {
+            lastIndex = (uint8_t)ti;
+            found = true;
+            break;
+          }
+        }
+      }
+      lastColor = color;
+      hasLast = true;
+    }
+    mySerum.frame[tk] = lastIndex;
+  }
+  UpdateV1CompatPalette();
+}
+
+static void UpdateV1CompatOutput(uint32_t result) {
+  if (result == IDENTIFY_NO_FRAME || result == IDENTIFY_SAME_FRAME) return;
+  if (mySerum.frameID == 0xfffffffd) {
+    memcpy(mySerum.palette, standardPalette, standardPaletteLength);
+    memset(mySerum.rotations, 255, MAX_COLOR_ROTATIONS * 3);
+    return;
+  }
+  UpdateV1CompatFrame();
+}
+
+static void CopyToPaddedCallerPlane(const CallerOutputPlane& plane,
+                                    const uint16_t* frame, uint32_t width,
+                                    uint32_t height) {
+  if (!plane.frame || !frame || width == 0) return;
+  for (uint32_t y = 0; y < height; y++) {
+    memcpy(plane.frame + y * plane.stride, frame + y * width,
+           width * sizeof(uint16_t));
+  }
+}
+
+// Moves one output plane to the caller's buffers, or back to the library's
+// with a null request. The current frame is carried over, so rotations keep
+// working on it.
+template <typename T>
+static void SwapOutputBuffer(T*& current, T*& owned, T* requested,
+                             size_t count) {
+  T* target = requested ? requested : owned;
+  if (!target || target == current) return;
+  memcpy(target, current, count * sizeof(T));
+  if (!owned) owned = current;
+  current = target;
+  if (!requested) owned = nullptr;
+}
+
+// Checks a Serum_SetOutputBuffers() request for one plane without changing
+// anything and returns the row stride to use in stride.
+static bool ValidateOutputPlane(const Serum_Output_Plane& request,
+                                uint32_t height, uint32_t alignment,
+                                const uint16_t* frame, uint32_t& stride) {
+  const uint32_t width = OutputPlaneWidth(height);
+  if (!frame && (request.frame || request.rotationsinframe ||
+                 request.modifiedelements)) {
+    Log("Serum_SetOutputBuffers: no %up output plane was requested at load",
+        height);
+    return false;
+  }
+  stride = request.stride;
+  if (stride == 0) {
+    const uint32_t rowBytes = width * sizeof(uint16_t);
+    stride = ((rowBytes + alignment - 1) / alignment * alignment) /
+             sizeof(uint16_t);
+  }
+  if (request.frame &&
+      (stride < width || (stride * sizeof(uint16_t)) % alignment != 0 ||
+       (uintptr_t)request.frame % alignment != 0)) {
+    Log("Serum_SetOutputBuffers: %up buffer or stride %u is not aligned to "
+        "%u bytes or shorter than the width %u",
+        height, stride, alignment, width);
+    return false;
+  }
+  if ((uintptr_t)request.rotationsinframe % alignment != 0 ||
+      (uintptr_t)request.modifiedelements % alignment != 0) {
+    Log("Serum_SetOutputBuffers: %up rotation or modified element buffer is "
+        "not aligned to %u bytes",
+        height, alignment);
+    return false;
+  }
+  return true;
+}
+
+// Switches one plane to a request ValidateOutputPlane() accepted.
+static void BindOutputPlane(const Serum_Output_Plane& request, uint32_t height,
+                            uint32_t stride, CallerOutputPlane& plane,
+                            uint16_t*& frame, uint16_t*& rotationsInFrame,
+                            uint8_t*& modifiedElements) {
+  if (!frame) return;
+  const uint32_t width = OutputPlaneWidth(height);
+  const size_t pixels = (size_t)width * height;
+  const bool packed = request.frame && stride == width;
+  SwapOutputBuffer(frame, plane.ownedFrame, packed ? request.frame : nullptr,
+                   pixels);
+  SwapOutputBuffer(rotationsInFrame, plane.ownedRotationsInFrame,
+                   request.rotationsinframe, 2 * pixels);
+  if (modifiedElements) {
+    SwapOutputBuffer(modifiedElements, plane.ownedModifiedElements,
+                     request.modifiedelements, pixels);
+  }
+  plane.frame = (request.frame && !packed) ? request.frame : nullptr;
+  plane.stride = stride;
+  CopyToPaddedCallerPlane(plane, frame, width, height);
+}
+
+SERUM_API bool Serum_SetOutputBuffers(const Serum_Output_Plane* plane32,
+                                      const Serum_Output_Plane* plane64,
+                                      uint32_t alignment) {
+  SERUM_API_GUARD_START("Serum_SetOutputBuffers")
+  if (alignment == 0) alignment = 1;
+  if ((alignment & (alignment - 1)) != 0) {
+    Log("Serum_SetOutputBuffers: alignment %u is not a power of two",
+        alignment);
+    return false;
+  }
+  const Serum_Output_Plane none = {};
+  const Serum_Output_Plane& request32 = plane32 ? *plane32 : none;
+  const Serum_Output_Plane& request64 = plane64 ? *plane64 : none;
+  // Both planes are checked before either is switched, so a rejected call
+  // leaves the previous buffers in place.
+  uint32_t stride32 = 0;
+  uint32_t stride64 = 0;
+  if (!ValidateOutputPlane(request32, 32, alignment, mySerum.frame32,
+                           stride32) ||
+      !ValidateOutputPlane(request64, 64, alignment, mySerum.frame64,
+                           stride64)) {
+    return false;
+  }
+  BindOutputPlane(request32, 32, stride32, g_callerPlane32, mySerum.frame32,
+                  mySerum.rotationsinframe32, mySerum.modifiedelements32);
+  BindOutputPlane(request64, 64, stride64, g_callerPlane64, mySerum.frame64,
+                  mySerum.rotationsinframe64, mySerum.modifiedelements64);
+  return true;
+  SERUM_API_GUARD_END("Serum_SetOutputBuffers", false)
+}
+
+static uint32_t OutputFormatBytesPerPixel(uint8_t format) {
+  switch (format) {
+    case SERUM_PIXEL_FORMAT_RGB888:
+      return 3;
+    case SERUM_PIXEL_FORMAT_RGBA8888:
+    case SERUM_PIXEL_FORMAT_BGRA8888:
+      return 4;
+    default:
+      return 2;
+  }
+}
+
+// Size of output32/output64 for the current frame, 0 if it isn't filled.
+static uint32_t ConvertedOutputBytes(uint8_t format, const uint8_t* output,
+                                     uint32_t width, uint32_t height) {
+  if (!output) return 0;
+  return width * height * OutputFormatBytesPerPixel(format);
+}
+
+// Converts an RGB565 output plane into output, allocated for the full plane
+// on first use. The whole plane is converted: rotations touch pixels all
+// over it and the SIMD conversion of a 256x64 plane costs about as much as
+// finding the changed ones would.
+static void ConvertOutputPlane(uint8_t format, const uint16_t* frame,
+                               uint32_t width, uint32_t height,
+                               uint8_t*& output) {
+  if (format == SERUM_PIXEL_FORMAT_RGB565 || !frame || width == 0) return;
+  const uint32_t pixels = width * height;
+  if (!output) {
+    output = (uint8_t*)malloc((size_t)OutputPlaneWidth(height) * height *
+                              OutputFormatBytesPerPixel(format));
+    if (!output) {
+      Log("Can't allocate the %up output in pixel format %u", height, format);
+      return;
+    }
+  }
+  switch (format) {
+    case SERUM_PIXEL_FORMAT_RGB565_BE:
+      // Native RGB565 already is big-endian on big-endian hosts.
+      if constexpr (std::endian::native == std::endian::big) {
+        memcpy(output, frame, pixels * sizeof(uint16_t));
+      } else {
+        g_simdKernels->swapBytes16((uint16_t*)output, frame, pixels);
+      }
+      break;
+    case SERUM_PIXEL_FORMAT_RGB888:
+      g_simdKernels->rgb565ToRgb888(output, frame, pixels);
+      break;
+    case SERUM_PIXEL_FORMAT_RGBA8888:
+    case SERUM_PIXEL_FORMAT_BGRA8888:
+      g_simdKernels->rgb565ToRgba8888(
+          output, frame, pixels, format == SERUM_PIXEL_FORMAT_BGRA8888);
+      break;
+  }
+}
+
+static void ConvertOutputPlanes(void) {
+  ConvertOutputPlane(g_outputFormat32, mySerum.frame32, mySerum.width32, 32,
+                     mySerum.output32);
+  ConvertOutputPlane(g_outputFormat64, mySerum.frame64, mySerum.width64, 64,
+                     mySerum.output64);
+}
+
+SERUM_API bool Serum_SetOutputFormat(uint8_t format32, uint8_t format64) {
+  SERUM_API_GUARD_START("Serum_SetOutputFormat")
+  if (format32 >= SERUM_PIXEL_FORMAT_COUNT ||
+      format64 >= SERUM_PIXEL_FORMAT_COUNT) {
+    Log("Serum_SetOutputFormat: unknown pixel format %u/%u", format32,
+        format64);
+    return false;
+  }
+  if (format32 != g_outputFormat32) Free_element((void**)&mySerum.output32);
+  if (format64 != g_outputFormat64) Free_element((void**)&mySerum.output64);
+  g_outputFormat32 = format32;
+  g_outputFormat64 = format64;
+  if (cromloaded) ConvertOutputPlanes();
+  return true;
+  SERUM_API_GUARD_END("Serum_SetOutputFormat", false)
+}
+
+// Brings an indexed plane up to date with its RGB565 plane; after a rotation
+// tick only the palette entries of the rotations that moved are rewritten.
+static void UpdateIndexedPlane(IndexedOutput& indexed, const uint16_t* frame,
+                               const uint16_t* rotationsInFrame,
+                               const uint16_t* rotations,
+                               const uint32_t* shifts, uint32_t width,
+                               uint32_t height, bool rotationOnly,
+                               uint8_t*& index, uint16_t*& palette,
+                               uint32_t& paletteSize) {
+  if (!frame || width == 0) {
+    indexed.Reset();
+  } else if (rotationOnly && indexed.HasFrame()) {
+    indexed.UpdateRotations(rotations, shifts);
+  } else {
+    indexed.Build(frame, rotationsInFrame, width * height, shifts);
+  }
+  index = indexed.Index();
+  palette = indexed.Palette();
+  paletteSize = indexed.PaletteSize();
+}
+
+static void UpdateIndexedPlanes(bool rotationOnly) {
+  if (!g_indexedOutput) return;
+  UpdateIndexedPlane(g_indexed32, mySerum.frame32, mySerum.rotationsinframe32,
+                     mySerum.rotations32, colorshifts32, mySerum.width32, 32,
+                     rotationOnly, mySerum.index32, mySerum.palette32,
+                     mySerum.palettesize32);
+  UpdateIndexedPlane(g_indexed64, mySerum.frame64, mySerum.rotationsinframe64,
+                     mySerum.rotations64, colorshifts64, mySerum.width64, 64,
+                     rotationOnly, mySerum.index64, mySerum.palette64,
+                     mySerum.palettesize64);
+}
+
+SERUM_API void Serum_SetIndexedOutput(bool enable) {
+  SERUM_API_GUARD_START("Serum_SetIndexedOutput")
+  g_indexedOutput = enable;
+  if (enable) {
+    if (cromloaded) UpdateIndexedPlanes(false);
+    return;
+  }
+  ClearIndexedPlanes();
+  SERUM_API_GUARD_END_VOID("Serum_SetIndexedOutput")
+}
+
+// The pixels of the stream follow the byte order of an RGB565_BE plane;
+// the other formats get RGB565 little-endian.
+static void EncodeDeltaPlane(DeltaEncoder& encoder, const uint16_t* frame,
+                             uint32_t width, uint32_t height, uint8_t format,
+                             uint8_t*& delta, uint32_t& deltaSize,
+                             Serum_Rect& dirty) {
+  delta = NULL;
+  deltaSize = 0;
+  dirty = Serum_Rect();
+  if (!frame || width == 0) return;
+  encoder.Encode(frame, width, height,
+                 format == SERUM_PIXEL_FORMAT_RGB565_BE);
+  delta = (uint8_t*)encoder.Stream();
+  deltaSize = encoder.StreamSize();
+  dirty = encoder.Dirty();
+}
+
+static void EncodeDeltaPlanes(void) {
+  if (!g_deltaOutput) return;
+  EncodeDeltaPlane(g_delta32, mySerum.frame32, mySerum.width32, 32,
+                   g_outputFormat32, mySerum.delta32, mySerum.deltasize32,
+                   mySerum.dirty32);
+  EncodeDeltaPlane(g_delta64, mySerum.frame64, mySerum.width64, 64,
+                   g_outputFormat64, mySerum.delta64, mySerum.deltasize64,
+                   mySerum.dirty64);
+}
+
+SERUM_API void Serum_SetDeltaOutput(bool enable) {
+  SERUM_API_GUARD_START("Serum_SetDeltaOutput")
+  ClearDeltaPlanes();
+  g_deltaOutput = enable;
+  SERUM_API_GUARD_END_VOID("Serum_SetDeltaOutput")
+}
+
+SERUM_API bool Serum_OpenSharedOutput(const char* name, uint32_t slots) {
+  SERUM_API_GUARD_START("Serum_OpenSharedOutput")
+  if (slots == 0) slots = 8;
+  if (!g_sharedOutput.Open(name, slots)) {
+    Log("Serum_OpenSharedOutput: can't create shared memory %s: %s",
+        name ? name : "(null)", strerror(errno));
+    return false;
+  }
+  return true;
+  SERUM_API_GUARD_END("Serum_OpenSharedOutput", false)
+}
+
+SERUM_API void Serum_CloseSharedOutput(void) {
+  SERUM_API_GUARD_START("Serum_CloseSharedOutput")
+  g_sharedOutput.Close();
+  SERUM_API_GUARD_END_VOID("Serum_CloseSharedOutput")
+}
+
+// Converts the output of the last call to the selected pixel formats,
+// indexes and deltas and hands it to padded caller planes, the render thread
+// and the shared output ring, if they asked for it. result is the return
+// value of that call, rotationOnly is set when only color rotations moved.
+static void PublishOutputFrame(uint32_t result, bool rotationOnly) {
+  ConvertOutputPlanes();
+  UpdateIndexedPlanes(rotationOnly);
+  EncodeDeltaPlanes();
+  if (g_callerPlane32.frame && mySerum.width32) {
+    CopyToPaddedCallerPlane(g_callerPlane32, mySerum.frame32, mySerum.width32,
+                            32);
+  }
+  if (g_callerPlane64.frame && mySerum.width64) {
+    CopyToPaddedCallerPlane(g_callerPlane64, mySerum.frame64, mySerum.width64,
+                            64);
+  }
+  if (g_sharedOutput.IsOpen()) {
+    g_sharedOutput.Publish(mySerum, mySerum.frame ? g_serumData.fwidth : 0,
+                           mySerum.frame ? g_serumData.fheight : 0, result);
+  }
+  if (!g_frameExchange.IsEnabled()) return;
+  const uint32_t v1FramePixels =
+      mySerum.frame ? g_serumData.fwidth * g_serumData.fheight : 0;
+  g_frameExchange.Publish(
+      mySerum, v1FramePixels,
+      ConvertedOutputBytes(g_outputFormat32, mySerum.output32,
+                           mySerum.width32, 32),
+      ConvertedOutputBytes(g_outputFormat64, mySerum.output64,
+                           mySerum.width64, 64));
+}
+
+static void RememberScheduledPlanes(void) {
+  g_scheduledPlane32.assign(mySerum.frame32,
+                            mySerum.frame32 ? mySerum.frame32 +
+                                                  32 * mySerum.width32
+                                            : nullptr);
+  g_scheduledPlane64.assign(mySerum.frame64,
+                            mySerum.frame64 ? mySerum.frame64 +
+                                                  64 * mySerum.width64
+                                            : nullptr);
+}
+
+// Schedules the next rotation or scene step from a Serum_Colorize(),
+// Serum_Rotate() or Serum_Scene_Trigger() return value. newOutput is set when
+// the host got a new frame from the call, which the next changed regions are
+// relative to.
+static void RearmRotationScheduler(uint32_t result, bool newOutput) {
+  if (!g_rotationScheduler.IsRunning()) return;
+  if (newOutput) RememberScheduledPlanes();
+  g_rotationScheduler.Arm(result & 0xffff);
+}
+
+// ChangedRegion() against a plane kept by RememberScheduledPlanes(); all of
+// current counts as changed if the plane size changed.
+static Serum_Rect ScheduledPlaneChange(const std::vector<uint16_t>& previous,
+                                       const uint16_t* current, uint32_t width,
+                                       uint32_t height) {
+  if (!current || width == 0) return Serum_Rect();
+  if (previous.size() != (size_t)width * height) {
+    Serum_Rect rect = {};
+    rect.width = (uint16_t)width;
+    rect.height = (uint16_t)height;
+    return rect;
+  }
+  return ChangedRegion(previous.data(), current, width, height);
+}
+
+static void RunScheduledRotation(void) {
+  const uint32_t result = Serum_Rotate();
+  if (!(result & 0xffff0000)) return;
+  Serum_Frame_Ready ready = {};
+  ready.result = result;
+  if (mySerum.flags & FLAG_RETURNED_32P_FRAME_OK) {
+    ready.changed32 = ScheduledPlaneChange(g_scheduledPlane32, mySerum.frame32,
+                                           mySerum.width32, 32);
+  }
+  if (mySerum.flags & FLAG_RETURNED_64P_FRAME_OK) {
+    ready.changed64 = ScheduledPlaneChange(g_scheduledPlane64, mySerum.frame64,
+                                           mySerum.width64, 64);
+  }
+  RememberScheduledPlanes();
+  if (g_frameReadyCallback) {
+    g_frameReadyCallback(&ready, g_frameReadyUserData);
+  }
+}
+
 SERUM_API uint32_t Serum_Colorize(uint8_t* frame) {
   SERUM_API_GUARD_START("Serum_Colorize")
   // return IDENTIFY_NO_FRAME if no new frame detected
   // return 0 if new frame with no rotation detected
   // return > 0 if new frame with rotations detected, the value is the delay
   // before the first rotation in ms
-  if (g_serumData.SerumVersion == SERUM_V2)
-    return Serum_ColorizeWithMetadatav2(frame);
-  else
-    return Serum_ColorizeWithMetadatav1(frame);
+  const bool capturing = g_frameCapture.IsActive();
+  if (capturing) {
+    // Records every byte Identify_Frame() reads, see InputFramePixels().
+    const bool is256x64 = g_serumData.is256x64;
+    g_frameCapture.BeginColorize(
+        frame, is256x64 ? 256 : (uint16_t)g_serumData.fwidth,
+        is256x64 ? 64 : (uint16_t)g_serumData.fheight, GetMonotonicTimeMs());
+  }
+  const uint32_t result = (g_serumData.SerumVersion == SERUM_V2)
+                              ? Serum_ColorizeWithMetadatav2(frame)
+                              : Serum_ColorizeWithMetadatav1(frame);
+  if (g_v1CompatOutput) {
+    UpdateV1CompatOutput(result);
+  }
+  if (result != IDENTIFY_NO_FRAME && result != IDENTIFY_SAME_FRAME) {
+    PublishOutputFrame(result, false);
+    RearmRotationScheduler(result, true);
+  }
+  if (capturing) {
+    g_frameCapture.Commit(result);
+  }
+  return result;
   SERUM_API_GUARD_END("Serum_Colorize", IDENTIFY_NO_FRAME)
 }
 
@@ -5440,8 +6389,11 @@ uint32_t Serum_ApplyRotationsv1(void) {
 }
 
 uint32_t Serum_RenderScene(void) {
+  SERUM_TRACE_SCOPE("Serum_RenderScene");
   BeginProfileFrameOperation();
+  const uint64_t sceneStartNs = PerfCounters::NowNs();
   auto finishSceneProfile = [&](uint32_t result) -> uint32_t {
+    g_perfCounters.RecordSince(SERUM_PERF_STAGE_SCENE_RENDER, sceneStartNs);
     EndProfileFrameOperation();
     return result;
   };
@@ -5541,7 +6493,11 @@ uint32_t Serum_RenderScene(void) {
         }
         mySerum.rotationtimer = sceneDurationPerFrame;
         sceneNextFrameAtMs = now + sceneDurationPerFrame;
+        g_scenePrerenderHit = g_scenePrerender.Find(
+            static_cast<uint16_t>(lastTriggerID), currentGroup,
+            sceneCurrentFrame);
         Serum_ColorizeWithMetadatav2Internal(sceneFrame, true, it->second);
+        g_scenePrerenderHit = nullptr;
         renderedFromDirectTriplet = true;
       }
     }
@@ -5582,7 +6538,12 @@ uint32_t Serum_RenderScene(void) {
       }
       mySerum.rotationtimer = sceneDurationPerFrame;
       sceneNextFrameAtMs = now + sceneDurationPerFrame;
+      g_scenePrerenderHit =
+          hasGroup ? g_scenePrerender.Find(static_cast<uint16_t>(lastTriggerID),
+                                           currentGroup, sceneCurrentFrame)
+                   : nullptr;
       Serum_ColorizeWithMetadatav2(sceneFrame, true);
+      g_scenePrerenderHit = nullptr;
     } else {
       DebugLogSceneEvent("triplet-render", static_cast<uint16_t>(lastTriggerID),
                          sceneCurrentFrame, sceneFrameCount,
@@ -5592,6 +6553,9 @@ uint32_t Serum_RenderScene(void) {
     }
 
     sceneCurrentFrame++;
+    if (hasGroup) {
+      RequestScenePrerender(currentGroup);
+    }
     if (sceneCurrentFrame >= sceneFrameCount && sceneRepeatCount > 0) {
       if (sceneRepeatCount == 1) {
         sceneCurrentFrame = 0;  // loop
@@ -5667,10 +6631,13 @@ uint32_t Serum_RenderScene(void) {
                               FLAG_RETURNED_V2_SCENE);
   }
 
-  return finishSceneProfile(0);
+  // No scene running: keep idle rotate ticks out of the scene render stats.
+  EndProfileFrameOperation();
+  return 0;
 }
 
 uint32_t Serum_ApplyRotationsv2(void) {
+  SERUM_TRACE_SCOPE("Serum_ApplyRotationsv2");
   uint32_t sceneRotationResult = Serum_RenderScene();
   bool sceneIsActive = (sceneRotationResult & FLAG_RETURNED_V2_SCENE) != 0;
   bool sceneIsBackground =
@@ -5692,6 +6659,8 @@ uint32_t Serum_ApplyRotationsv2(void) {
   uint32_t now = GetMonotonicTimeMs();
   if (mySerum.frame32 && (mySerum.flags & FLAG_RETURNED_32P_FRAME_OK)) {
     sizeframe = 32 * mySerum.width32;
+    const GeometryKernels& kernels =
+        PlaneKernels(g_plane32Kernels, mySerum.width32, 32);
     if (mySerum.modifiedelements32)
       memset(mySerum.modifiedelements32, 0, sizeframe);
     for (int ti = 0; ti < MAX_COLOR_ROTATION_V2; ti++) {
@@ -5708,23 +6677,19 @@ uint32_t Serum_ApplyRotationsv2(void) {
         colorrotnexttime32[ti] =
             now + mySerum.rotations32[ti * MAX_LENGTH_COLOR_ROTATION + 1];
         isrotation |= FLAG_RETURNED_V2_ROTATED32;
-        for (uint32_t tj = 0; tj < sizeframe; tj++) {
-          if (mySerum.rotationsinframe32[tj * 2] == ti) {
-            // if we have a pixel which is part of this rotation, we modify it
-            mySerum.frame32[tj] =
-                mySerum.rotations32
-                    [ti * MAX_LENGTH_COLOR_ROTATION + 2 +
-                     (mySerum.rotationsinframe32[tj * 2 + 1] +
-                      colorshifts32[ti]) %
-                         mySerum.rotations32[ti * MAX_LENGTH_COLOR_ROTATION]];
-            if (mySerum.modifiedelements32) mySerum.modifiedelements32[tj] = 1;
-          }
-        }
+        // modify the pixels which are part of this rotation
+        kernels.applyRotation(
+            mySerum.frame32, mySerum.rotationsinframe32,
+            mySerum.modifiedelements32, static_cast<uint16_t>(ti),
+            &mySerum.rotations32[ti * MAX_LENGTH_COLOR_ROTATION],
+            colorshifts32[ti], sizeframe);
       }
     }
   }
   if (mySerum.frame64 && (mySerum.flags & FLAG_RETURNED_64P_FRAME_OK)) {
     sizeframe = 64 * mySerum.width64;
+    const GeometryKernels& kernels =
+        PlaneKernels(g_plane64Kernels, mySerum.width64, 64);
     if (mySerum.modifiedelements64)
       memset(mySerum.modifiedelements64, 0, sizeframe);
     for (int ti = 0; ti < MAX_COLOR_ROTATION_V2; ti++) {
@@ -5741,18 +6706,12 @@ uint32_t Serum_ApplyRotationsv2(void) {
         colorrotnexttime64[ti] =
             now + mySerum.rotations64[ti * MAX_LENGTH_COLOR_ROTATION + 1];
         isrotation |= FLAG_RETURNED_V2_ROTATED64;
-        for (uint32_t tj = 0; tj < sizeframe; tj++) {
-          if (mySerum.rotationsinframe64[tj * 2] == ti) {
-            // if we have a pixel which is part of this rotation, we modify it
-            mySerum.frame64[tj] =
-                mySerum.rotations64
-                    [ti * MAX_LENGTH_COLOR_ROTATION + 2 +
-                     (mySerum.rotationsinframe64[tj * 2 + 1] +
-                      colorshifts64[ti]) %
-                         mySerum.rotations64[ti * MAX_LENGTH_COLOR_ROTATION]];
-            if (mySerum.modifiedelements64) mySerum.modifiedelements64[tj] = 1;
-          }
-        }
+        // modify the pixels which are part of this rotation
+        kernels.applyRotation(
+            mySerum.frame64, mySerum.rotationsinframe64,
+            mySerum.modifiedelements64, static_cast<uint16_t>(ti),
+            &mySerum.rotations64[ti * MAX_LENGTH_COLOR_ROTATION],
+            colorshifts64[ti], sizeframe);
       }
     }
   }
@@ -5775,14 +6734,174 @@ uint32_t Serum_ApplyRotationsv2(void) {
          (sceneIsActive ? FLAG_RETURNED_V2_SCENE : 0);
 }
 
+// Fills hashes[i * buckets + b] with the CRC of frame i for normal identify
+// bucket b and fullCrcs[i] with its full CRC, on threadCount threads. The
+// comparison masks are copied first because the sparse vector decode cache
+// isn't thread-safe; the CRC kernels themselves only read shared tables.
+static void PrecomputeBatchIdentifyHashes(const uint8_t* frames,
+                                          uint32_t stride, uint32_t count,
+                                          uint32_t threadCount,
+                                          std::vector<uint32_t>& hashes,
+                                          std::vector<uint32_t>& fullCrcs) {
+  const uint32_t buckets =
+      static_cast<uint32_t>(g_serumData.normalIdentifyBuckets.size());
+  const uint32_t pixels = InputFramePixels();
+  std::vector<std::vector<uint8_t>> masks(buckets);
+  for (uint32_t b = 0; b < buckets; ++b) {
+    const uint8_t mask = g_serumData.normalIdentifyBuckets[b].mask;
+    if (mask < 255) {
+      const uint8_t* pmask = g_serumData.compmasks[mask];
+      masks[b].assign(pmask, pmask + pixels);
+    }
+  }
+  hashes.assign((size_t)count * buckets, 0);
+  fullCrcs.assign(count, 0);
+
+  const GeometryKernels& kernels = *g_frameKernels;
+  std::atomic<uint32_t> next{0};
+  auto worker = [&]() {
+    uint32_t i;
+    while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+      const uint8_t* frame = frames + (size_t)i * stride;
+      uint32_t* frameHashes = &hashes[(size_t)i * buckets];
+      for (uint32_t b = 0; b < buckets; ++b) {
+        const bool shape = g_serumData.normalIdentifyBuckets[b].shape == 1;
+        if (!masks[b].empty()) {
+          frameHashes[b] =
+              shape ? kernels.crc32MaskShape(crc32_table, frame,
+                                             masks[b].data(), pixels)
+                    : kernels.crc32Mask(crc32_table, frame, masks[b].data(),
+                                        pixels);
+        } else {
+          frameHashes[b] =
+              shape ? kernels.crc32Shape(crc32_table, frame, pixels)
+                    : kernels.crc32(crc32_table, frame, pixels);
+        }
+      }
+      fullCrcs[i] = kernels.crc32(crc32_table, frame, pixels);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (uint32_t t = 1; t < threadCount; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+static void CopyBatchOutput(uint32_t result, Serum_Batch_Output& output) {
+  output.result = result;
+  output.frameID = mySerum.frameID;
+  output.triggerID = mySerum.triggerID;
+  output.width32 =
+      (mySerum.flags & FLAG_RETURNED_32P_FRAME_OK) ? mySerum.width32 : 0;
+  output.width64 =
+      (mySerum.flags & FLAG_RETURNED_64P_FRAME_OK) ? mySerum.width64 : 0;
+  if (output.frame32 && output.width32) {
+    memcpy(output.frame32, mySerum.frame32,
+           32 * output.width32 * sizeof(uint16_t));
+  }
+  if (output.frame64 && output.width64) {
+    memcpy(output.frame64, mySerum.frame64,
+           64 * output.width64 * sizeof(uint16_t));
+  }
+}
+
+SERUM_API bool Serum_ColorizeBatch(const uint8_t* frames,
+                                   const uint32_t* timestampsMs,
+                                   uint32_t count,
+                                   Serum_Batch_Output* outputs) {
+  SERUM_API_GUARD_START("Serum_ColorizeBatch")
+  if (!frames || !outputs) {
+    return false;
+  }
+  if (!cromloaded || g_serumData.SerumVersion != SERUM_V2) {
+    Log("Serum_ColorizeBatch: no Serum v2 file loaded");
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+  const uint32_t stride = InputFramePixels();
+  // The pre-pass hashes every bucket while Identify_Frame() stops at the
+  // first match, so it only pays off when it runs on several cores. Frames
+  // are hashed in chunks so the hash table doesn't grow with the batch.
+  constexpr uint32_t kChunkFrames = 1024;
+  constexpr uint32_t kMaxThreads = 8;
+  const uint32_t threadCount =
+      std::min({std::thread::hardware_concurrency(), kMaxThreads, count});
+  const bool precompute = threadCount > 1;
+  std::vector<uint32_t> hashes;
+  std::vector<uint32_t> fullCrcs;
+  const size_t buckets = g_serumData.normalIdentifyBuckets.size();
+
+  for (uint32_t first = 0; first < count; first += kChunkFrames) {
+    const uint32_t chunk = std::min(kChunkFrames, count - first);
+    const uint8_t* chunkFrames = frames + (size_t)first * stride;
+    if (precompute) {
+      PrecomputeBatchIdentifyHashes(chunkFrames, stride, chunk,
+                                    std::min(threadCount, chunk), hashes,
+                                    fullCrcs);
+    }
+    // Everything that depends on the previous frames runs in input order
+    // through the regular entry points, so the outputs match a host calling
+    // them one frame at a time.
+    for (uint32_t i = 0; i < chunk; ++i) {
+      uint8_t* frame = const_cast<uint8_t*>(chunkFrames + (size_t)i * stride);
+      if (timestampsMs) {
+        Serum_SetVirtualTime(timestampsMs[first + i]);
+      }
+      if (precompute) {
+        g_precomputedHashes = {frame, hashes.data() + i * buckets,
+                               fullCrcs[i]};
+      }
+      const uint32_t result = Serum_Colorize(frame);
+      g_precomputedHashes = {};
+      if (timestampsMs &&
+          (result == IDENTIFY_NO_FRAME || result == IDENTIFY_SAME_FRAME)) {
+        Serum_Rotate();
+      }
+      CopyBatchOutput(result, outputs[first + i]);
+    }
+  }
+  return true;
+  SERUM_API_GUARD_END("Serum_ColorizeBatch", false)
+}
+
 SERUM_API uint32_t Serum_Rotate(void) {
   SERUM_API_GUARD_START("Serum_Rotate")
-  if (g_serumData.SerumVersion == SERUM_V2) {
-    return Serum_ApplyRotationsv2();
-  } else {
-    return Serum_ApplyRotationsv1();
+  ScopedPerfStage perfStage(g_perfCounters, SERUM_PERF_STAGE_ROTATE);
+  const bool capturing = g_frameCapture.IsActive();
+  if (capturing) {
+    g_frameCapture.BeginRotate(GetMonotonicTimeMs());
+  }
+  uint32_t result = (g_serumData.SerumVersion == SERUM_V2)
+                        ? Serum_ApplyRotationsv2()
+                        : Serum_ApplyRotationsv1();
+  if (g_v1CompatOutput && mySerum.frameID != 0xfffffffd) {
+    const uint32_t rotated = g_serumData.fheight == 32
+                                 ? FLAG_RETURNED_V2_ROTATED32
+                                 : FLAG_RETURNED_V2_ROTATED64;
+    if (result & FLAG_RETURNED_V2_SCENE) {
+      // Scene frames are rendered here, not in Serum_Colorize().
+      UpdateV1CompatFrame();
+    } else if (result & rotated) {
+      UpdateV1CompatPalette();
+    }
+    if ((result & rotated) && mySerum.SerumVersion == SERUM_V1) {
+      result |= FLAG_RETURNED_V1_ROTATED;
+    }
+  }
+  if (result & 0xffff0000) {
+    PublishOutputFrame(result, (result & FLAG_RETURNED_V2_SCENE) == 0);
+  }
+  RearmRotationScheduler(result, false);
+  if (capturing) {
+    g_frameCapture.Commit(result);
   }
-  return 0;
+  return result;
   SERUM_API_GUARD_END("Serum_Rotate", 0)
 }
 
@@ -5831,6 +6950,244 @@ SERUM_API bool Serum_GetRuntimeMetadata(Serum_Runtime_Metadata* metadata) {
   SERUM_API_GUARD_END("Serum_GetRuntimeMetadata", false)
 }
 
+SERUM_API bool Serum_GetPerfCounters(Serum_Perf_Counters* counters) {
+  SERUM_API_GUARD_START("Serum_GetPerfCounters")
+  if (counters == nullptr) {
+    return false;
+  }
+
+  if (counters->size != 0 && counters->size < sizeof(Serum_Perf_Counters)) {
+    return false;
+  }
+
+  memset(counters, 0, sizeof(*counters));
+  counters->size = sizeof(*counters);
+  g_perfCounters.Fill(counters);
+  counters->residentBytes = GetProcessResidentMemoryBytes();
+  return true;
+  SERUM_API_GUARD_END("Serum_GetPerfCounters", false)
+}
+
+SERUM_API void Serum_ResetPerfCounters(void) {
+  SERUM_API_GUARD_START("Serum_ResetPerfCounters")
+  g_perfCounters.Reset();
+  ResetDynamicHotPathProfile();
+  SERUM_API_GUARD_END_VOID("Serum_ResetPerfCounters")
+}
+
+SERUM_API void Serum_SetTraceCallback(Serum_TraceCallback callback,
+                                      const void* userData) {
+  SERUM_API_GUARD_START("Serum_SetTraceCallback")
+  serum_trace::SetCallback(callback, userData);
+  SERUM_API_GUARD_END_VOID("Serum_SetTraceCallback")
+}
+
+SERUM_API bool Serum_StartTraceFile(const char* const filename) {
+  SERUM_API_GUARD_START("Serum_StartTraceFile")
+#ifdef SERUM_ENABLE_TRACING
+  if (!serum_trace::StartFile(filename)) {
+    Log("Failed to open trace file %s", filename ? filename : "(null)");
+    return false;
+  }
+  return true;
+#else
+  (void)filename;
+  return false;
+#endif
+  SERUM_API_GUARD_END("Serum_StartTraceFile", false)
+}
+
+SERUM_API void Serum_StopTraceFile(void) {
+  SERUM_API_GUARD_START("Serum_StopTraceFile")
+  serum_trace::StopFile();
+  SERUM_API_GUARD_END_VOID("Serum_StopTraceFile")
+}
+
+SERUM_API bool Serum_StartCapture(const char* const filename) {
+  SERUM_API_GUARD_START("Serum_StartCapture")
+  if (!g_frameCapture.Start(filename, GetMonotonicTimeMs())) {
+    Log("Failed to open capture file %s", filename ? filename : "(null)");
+    return false;
+  }
+  Log("Capturing API calls to %s", filename);
+  return true;
+  SERUM_API_GUARD_END("Serum_StartCapture", false)
+}
+
+SERUM_API void Serum_StopCapture(void) {
+  SERUM_API_GUARD_START("Serum_StopCapture")
+  g_frameCapture.Stop();
+  SERUM_API_GUARD_END_VOID("Serum_StopCapture")
+}
+
+SERUM_API void Serum_StartRotationScheduler(Serum_FrameReadyCallback callback,
+                                           const void* userData) {
+  SERUM_API_GUARD_START("Serum_StartRotationScheduler")
+  g_frameReadyCallback = callback;
+  g_frameReadyUserData = userData;
+  g_rotationScheduler.Start();
+  RememberScheduledPlanes();
+  g_rotationScheduler.Arm(mySerum.rotationtimer & 0xffff);
+  SERUM_API_GUARD_END_VOID("Serum_StartRotationScheduler")
+}
+
+SERUM_API void Serum_StopRotationScheduler(void) {
+  SERUM_API_GUARD_START("Serum_StopRotationScheduler")
+  g_rotationScheduler.Stop();
+  g_scheduledPlane32.clear();
+  g_scheduledPlane64.clear();
+  SERUM_API_GUARD_END_VOID("Serum_StopRotationScheduler")
+}
+
+SERUM_API bool Serum_StartFrameQueue(Serum_FrameDoneCallback callback,
+                                    const void* userData, bool coalesce) {
+  SERUM_API_GUARD_START("Serum_StartFrameQueue")
+  if (!cromloaded) {
+    Log("Serum_StartFrameQueue: no Serum file loaded");
+    return false;
+  }
+  StopFrameQueue();
+  g_frameDoneCallback = callback;
+  g_frameDoneUserData = userData;
+  if (!g_frameQueue.Start(InputFramePixels(), coalesce)) {
+    Log("Serum_StartFrameQueue: unsupported frame size %ux%u",
+        g_serumData.fwidth, g_serumData.fheight);
+    return false;
+  }
+  return true;
+  SERUM_API_GUARD_END("Serum_StartFrameQueue", false)
+}
+
+SERUM_API void Serum_StopFrameQueue(void) {
+  SERUM_API_GUARD_START("Serum_StopFrameQueue")
+  StopFrameQueue();
+  SERUM_API_GUARD_END_VOID("Serum_StopFrameQueue")
+}
+
+// No API guard: the capture thread must not wait for a colorize call in
+// progress.
+SERUM_API bool Serum_SubmitFrame(const uint8_t* frame, uint32_t timestampMs) {
+  return frame && g_frameQueue.Submit(frame, timestampMs);
+}
+
+SERUM_API void Serum_SetTripleBufferedOutput(bool enable) {
+  SERUM_API_GUARD_START("Serum_SetTripleBufferedOutput")
+  g_frameExchange.SetEnabled(enable);
+  SERUM_API_GUARD_END_VOID("Serum_SetTripleBufferedOutput")
+}
+
+// No API guard: these run on the host's render thread and must not wait for
+// a colorize call in progress.
+SERUM_API const Serum_Frame_Struc* Serum_AcquireLatestFrame(void) {
+  return g_frameExchange.Acquire();
+}
+
+SERUM_API void Serum_ReleaseFrame(void) { g_frameExchange.Release(); }
+
+SERUM_API uint64_t Serum_GetOutputHash(void) {
+  SERUM_API_GUARD_START("Serum_GetOutputHash")
+  uint64_t hash = 1469598103934665603ull;
+  if (g_serumData.SerumVersion == SERUM_V2) {
+    if ((mySerum.flags & FLAG_RETURNED_32P_FRAME_OK) && mySerum.frame32) {
+      hash = DebugHashBytesFNV1a64(
+          mySerum.frame32, 32 * mySerum.width32 * sizeof(uint16_t), hash);
+    }
+    if ((mySerum.flags & FLAG_RETURNED_64P_FRAME_OK) && mySerum.frame64) {
+      hash = DebugHashBytesFNV1a64(
+          mySerum.frame64, 64 * mySerum.width64 * sizeof(uint16_t), hash);
+    }
+  } else if (g_serumData.SerumVersion == SERUM_V1 && mySerum.frame &&
+             mySerum.palette) {
+    hash = DebugHashBytesFNV1a64(
+        mySerum.frame, g_serumData.fwidth * g_serumData.fheight, hash);
+    hash = DebugHashBytesFNV1a64(mySerum.palette, PALETTE_SIZE, hash);
+  }
+  return hash;
+  SERUM_API_GUARD_END("Serum_GetOutputHash", 0)
+}
+
+SERUM_API uint32_t Serum_GetInputFrameSize(void) {
+  SERUM_API_GUARD_START("Serum_GetInputFrameSize")
+  return cromloaded ? InputFramePixels() : 0;
+  SERUM_API_GUARD_END("Serum_GetInputFrameSize", 0)
+}
+
+// Moves every absolute timestamp from the old clock to the new one so running
+// rotations and scenes continue where they are. Zero means "not scheduled"
+// for the next-time and hold values and stays zero.
+static void RebaseTimers(uint32_t oldNow, uint32_t newNow) {
+  const uint32_t delta = newNow - oldNow;
+  const auto shift = [delta](uint32_t& t) { t += delta; };
+  const auto shiftScheduled = [delta](uint32_t& t) {
+    if (t != 0) t += delta;
+  };
+  shift(colorrotseruminit);
+  shift(lastframe_found);
+  shiftScheduled(lasttriggerTimestamp);
+  shiftScheduled(sceneNextFrameAtMs);
+  shiftScheduled(sceneEndHoldUntilMs);
+  for (int ti = 0; ti < MAX_COLOR_ROTATIONS; ti++) {
+    shift(colorshiftinittime[ti]);
+    shiftScheduled(colorrotnexttime[ti]);
+  }
+  for (int ti = 0; ti < MAX_COLOR_ROTATION_V2; ti++) {
+    shift(colorshiftinittime32[ti]);
+    shift(colorshiftinittime64[ti]);
+    shiftScheduled(colorrotnexttime32[ti]);
+    shiftScheduled(colorrotnexttime64[ti]);
+  }
+  for (auto& [sceneId, state] : g_sceneResumeState) {
+    shift(state.timestampMs);
+  }
+  if (g_serumData.sceneGenerator) {
+    g_serumData.sceneGenerator->rebaseFrameTimer(delta);
+  }
+}
+
+// Every pair Serum_SetTimeSource() published, see serum_time::CallbackSource.
+static std::vector<std::unique_ptr<const serum_time::CallbackSource>>
+    g_timeCallbackSources;
+
+SERUM_API void Serum_SetTimeSource(Serum_TimeSourceCallback callback,
+                                   const void* userData) {
+  SERUM_API_GUARD_START("Serum_SetTimeSource")
+  const uint32_t oldNow = GetMonotonicTimeMs();
+  if (callback) {
+    g_timeCallbackSources.push_back(
+        std::make_unique<const serum_time::CallbackSource>(
+            serum_time::CallbackSource{callback, userData}));
+    serum_time::g_callbackSource.store(g_timeCallbackSources.back().get(),
+                                       std::memory_order_release);
+  }
+  serum_time::g_source.store(
+      callback ? serum_time::Source::Callback : serum_time::Source::Steady);
+  RebaseTimers(oldNow, GetMonotonicTimeMs());
+  SERUM_API_GUARD_END_VOID("Serum_SetTimeSource")
+}
+
+SERUM_API void Serum_SetVirtualTime(uint32_t milliseconds) {
+  SERUM_API_GUARD_START("Serum_SetVirtualTime")
+  if (serum_time::g_source.load() != serum_time::Source::Virtual) {
+    RebaseTimers(GetMonotonicTimeMs(), milliseconds);
+    serum_time::g_virtualMs.store(milliseconds);
+    serum_time::g_source.store(serum_time::Source::Virtual);
+  } else {
+    serum_time::g_virtualMs.store(milliseconds);
+  }
+  SERUM_API_GUARD_END_VOID("Serum_SetVirtualTime")
+}
+
+SERUM_API void Serum_AdvanceVirtualTime(uint32_t milliseconds) {
+  SERUM_API_GUARD_START("Serum_AdvanceVirtualTime")
+  if (serum_time::g_source.load() != serum_time::Source::Virtual) {
+    const uint32_t now = GetMonotonicTimeMs();
+    serum_time::g_virtualMs.store(now);
+    serum_time::g_source.store(serum_time::Source::Virtual);
+  }
+  serum_time::g_virtualMs.fetch_add(milliseconds);
+  SERUM_API_GUARD_END_VOID("Serum_AdvanceVirtualTime")
+}
+
 SERUM_API bool Serum_Scene_ParseCSV(const char* const csv_filename) {
   SERUM_API_GUARD_START("Serum_Scene_ParseCSV")
   if (!g_serumData.sceneGenerator) return false;
@@ -5867,8 +7224,7 @@ SERUM_API bool Serum_Scene_GenerateFrame(uint16_t sceneId, uint16_t frameIndex,
   SERUM_API_GUARD_END("Serum_Scene_GenerateFrame", false)
 }
 
-SERUM_API uint32_t Serum_Scene_Trigger(uint16_t sceneId) {
-  SERUM_API_GUARD_START("Serum_Scene_Trigger")
+static uint32_t SceneTrigger(uint16_t sceneId) {
   if (!g_serumData.sceneGenerator || g_serumData.SerumVersion != SERUM_V2) {
     return 0;
   }
@@ -5951,6 +7307,23 @@ SERUM_API uint32_t Serum_Scene_Trigger(uint16_t sceneId) {
 
   mySerum.rotationtimer = sceneDurationPerFrame;
   return (mySerum.rotationtimer & 0xffff) | FLAG_RETURNED_V2_SCENE;
+}
+
+SERUM_API uint32_t Serum_Scene_Trigger(uint16_t sceneId) {
+  SERUM_API_GUARD_START("Serum_Scene_Trigger")
+  const bool capturing = g_frameCapture.IsActive();
+  if (capturing) {
+    g_frameCapture.BeginSceneTrigger(sceneId, GetMonotonicTimeMs());
+  }
+  const uint32_t result = SceneTrigger(sceneId);
+  if (result & FLAG_RETURNED_V2_SCENE) {
+    PublishOutputFrame(result, false);
+  }
+  RearmRotationScheduler(result, true);
+  if (capturing) {
+    g_frameCapture.Commit(result);
+  }
+  return result;
   SERUM_API_GUARD_END("Serum_Scene_Trigger", 0)
 }
 
@@ -28,6 +28,12 @@ SERUM_API void Serum_SetLogCallback(Serum_LogCallback callback,
  * if available) / FLAG_REQUEST_64P_FRAMES (same for 64-pixel-high frame) /
  * FLAG_REQUEST_FILL_MODIFIED_ELEMENTS (Serum_Rotate() fills the
  * modifiedelementsXX buffers to know which points have changed in the rotation)
+ * / FLAG_REQUEST_V1_UPCONVERT (run a v1 file on the v2 pipeline, it then
+ * returns v2 frames; if the file can't be converted exactly it is loaded as v1
+ * and the reason is logged) / FLAG_REQUEST_V1_COMPAT_OUTPUT (keep filling the
+ * v1 frame, palette and rotations of an upconverted file). A cROMc written
+ * from an upconverted file (cROMc version 12 or later) still returns v1
+ * output to callers that don't pass FLAG_REQUEST_V1_UPCONVERT.
  *
  *  @return A pointer to the Serum_Frame_Struc as described in the serum.h file
  * (to keep and read all along the use of the loaded Serum)
@@ -36,6 +42,21 @@ SERUM_API Serum_Frame_Struc* Serum_Load(const char* const altcolorpath,
                                         const char* const romname,
                                         uint8_t flags);
 
+/** @brief Load a cROMc image that is already in memory
+ *
+ * Behaves like Serum_Load() for a cROMc file, without searching the
+ * altcolor directory. The buffer is not referenced after the call returns.
+ *
+ *  @param data: cROMc image as written by Serum_Load ("CROM" header followed
+ * by the compressed archive)
+ *  @param size: size of data in bytes
+ *  @param flags: same as for Serum_Load()
+ *
+ *  @return A pointer to the Serum_Frame_Struc, or NULL on error
+ */
+SERUM_API Serum_Frame_Struc* Serum_LoadFromBuffer(const uint8_t* data,
+                                                  size_t size, uint8_t flags);
+
 /** @brief Set timeout for skipping unknown frames
  *
  * Unknown frames are ignored until this timeout elapses and a full lookup is
@@ -81,6 +102,129 @@ SERUM_API void Serum_Dispose(void);
  */
 SERUM_API uint32_t Serum_Colorize(uint8_t* frame);
 
+/** @brief Get the size of the frames Serum_Colorize() reads
+ *
+ * @return 256*64 bytes for files made for 256x64 ROMs, width*height bytes
+ * otherwise, 0 if nothing is loaded
+ */
+SERUM_API uint32_t Serum_GetInputFrameSize(void);
+
+/** @brief Render the output planes into caller memory
+ *
+ * With a packed plane (stride equal to the width), colorization, rotations
+ * and scenes write straight into the caller's buffer and the
+ * Serum_Frame_Struc points to it. A padded plane is rendered internally and
+ * its rows are copied into the caller's buffer after each call that changes
+ * the output. The buffers can be swapped at any time, e.g. once per frame;
+ * the current frame is copied into the new buffers, so the previous ones
+ * must stay valid until this call returns. Serum_Load() and Serum_Dispose()
+ * go back to the library's buffers. The buffers always receive RGB565; the
+ * planes converted for Serum_SetOutputFormat() (output32/output64) stay in
+ * library memory.
+ *
+ * @param plane32: buffers for the 32p plane, NULL for the library's
+ * @param plane64: buffers for the 64p plane, NULL for the library's
+ * @param alignment: power of two in bytes that all buffers and row strides
+ * are aligned to; also used to pad the rows when stride is 0
+ * @return false if a plane was not requested at load (FLAG_REQUEST_32P_FRAMES
+ * / FLAG_REQUEST_64P_FRAMES) or a buffer doesn't match the alignment; neither
+ * plane is changed then
+ */
+SERUM_API bool Serum_SetOutputBuffers(const Serum_Output_Plane* plane32,
+                                      const Serum_Output_Plane* plane64,
+                                      uint32_t alignment);
+
+/** @brief Select the pixel format of each output plane
+ *
+ * Output planes are always rendered as RGB565 into frame32/frame64. For any
+ * other format, every call that changes the output also converts the plane
+ * into output32/output64 of the Serum_Frame_Struc, so hosts can upload it
+ * without converting it themselves. The converted planes are always in
+ * library memory, also with Serum_SetOutputBuffers(). The setting is kept
+ * across Serum_Load() calls.
+ *
+ * @param format32: SERUM_PIXEL_FORMAT_* of the 32p plane
+ * @param format64: SERUM_PIXEL_FORMAT_* of the 64p plane
+ * @return false if a format is unknown
+ */
+SERUM_API bool Serum_SetOutputFormat(uint8_t format32, uint8_t format64);
+
+/** @brief Also output the planes as palette indexes
+ *
+ * Every call that changes the output fills index32/palette32/palettesize32
+ * (and the 64p ones) of the Serum_Frame_Struc with an 8-bit index per pixel
+ * and the RGB565 colors of the indexes. Each rotating color has its own
+ * entry, so when Serum_Rotate() returns FLAG_RETURNED_V2_ROTATED32/64
+ * without FLAG_RETURNED_V2_SCENE only palette entries changed and the index
+ * plane is the same as before. Frames with more than 256 entries have
+ * palettesize 0 and must be sent from frame32/frame64. The setting is kept
+ * across Serum_Load() calls.
+ */
+SERUM_API void Serum_SetIndexedOutput(bool enable);
+
+/** @brief Also output the changes of each plane as a run stream
+ *
+ * Every call that changes the output fills delta32/deltasize32/dirty32 (and
+ * the 64p ones) of the Serum_Frame_Struc with the pixels that differ from
+ * the previous output change. The stream is a sequence of runs in
+ * row-major order: uint16_t skip (unchanged pixels since the end of the
+ * previous run), uint16_t count, then count RGB565 pixels. skip and count
+ * are little-endian; the pixels are big-endian while the plane's format is
+ * SERUM_PIXEL_FORMAT_RGB565_BE and little-endian for every other format.
+ * Hosts must apply every delta in order; the first one after this call or
+ * Serum_Load() is against a black plane, so calling it again resynchronizes
+ * a display. Deltas are not part of the triple-buffered output, whose
+ * reader may skip frames.
+ */
+SERUM_API void Serum_SetDeltaOutput(bool enable);
+
+/** @brief Publish every output change into a POSIX shared-memory ring
+ *
+ * Creates the named segment and copies the 32p and 64p planes (the frame
+ * and palette for v1 content), frame ID, trigger ID, rotation timer and
+ * return value of every call that changes the output into its next slot,
+ * so a display process can read them in place. A segment left under that
+ * name is unlinked first; its readers must open the name again.
+ * serum-shm.h describes the layout and has a reader that doesn't need
+ * libserum. Serum_Dispose() closes the ring. Not available on Windows and
+ * Android.
+ *
+ * @param name: shm_open() name, e.g. "/serum-output"
+ * @param slots: number of frames kept, 0 for 8
+ * @return false if the segment can't be created
+ */
+SERUM_API bool Serum_OpenSharedOutput(const char* name, uint32_t slots);
+
+/** @brief Stop publishing and remove the shared-memory ring */
+SERUM_API void Serum_CloseSharedOutput(void);
+
+/** @brief Colorize a sequence of frames for offline tools
+ *
+ * Gives the same output as calling Serum_Colorize() for every frame in order
+ * (and Serum_Rotate() when it returns IDENTIFY_NO_FRAME or
+ * IDENTIFY_SAME_FRAME and timestamps are given). On multi-core machines the
+ * identification hashes of the frames are computed in parallel first, in
+ * chunks of 1024 frames on at most 8 threads. Only for Serum v2 (or
+ * upconverted v1) files.
+ *
+ * @param frames: count input frames back to back, each the size
+ * Serum_Colorize() reads: 256*64 bytes for files made for 256x64 ROMs,
+ * width*height bytes otherwise
+ * @param timestampsMs: time of each frame in milliseconds, or NULL. When
+ * given, the virtual clock is set to each timestamp before its frame (and is
+ * left active afterwards), so rotations and scenes advance with the
+ * timestamps; otherwise the current clock is used.
+ * @param count: number of frames
+ * @param outputs: count entries. The caller sets frame32/frame64 to buffers
+ * of 32 * width32 / 64 * width64 pixels (as returned by Serum_Load()) or
+ * NULL; the other fields are filled.
+ * @return false if no v2 file is loaded or on invalid arguments
+ */
+SERUM_API bool Serum_ColorizeBatch(const uint8_t* frames,
+                                   const uint32_t* timestampsMs,
+                                   uint32_t count,
+                                   Serum_Batch_Output* outputs);
+
 /** @brief Perform the color rotations of the current frame. For v1, it modifies
  * "palette", for v2, it modifies "frame32" and/or "frame64"
  *
@@ -118,6 +262,202 @@ SERUM_API void Serum_EnablePupTrigers(void);
  */
 SERUM_API bool Serum_GetRuntimeMetadata(Serum_Runtime_Metadata* metadata);
 
+/** @brief Get cumulative performance counters
+ *
+ * Reports call counts, total/max time and a log2 latency histogram with
+ * p50/p99 estimates for every pipeline and load stage since the last
+ * Serum_ResetPerfCounters() call. Counters survive Serum_Load/Serum_Dispose.
+ *
+ * @param counters: Output structure. counters->size should be set to
+ * sizeof(Serum_Perf_Counters); zero is also accepted for current versions.
+ * @return true if counters were filled, false on invalid arguments
+ */
+SERUM_API bool Serum_GetPerfCounters(Serum_Perf_Counters* counters);
+
+/** @brief Reset all performance counters to zero
+ */
+SERUM_API void Serum_ResetPerfCounters(void);
+
+/** @brief Set the stage tracing callback
+ *
+ * The callback receives a begin and an end event around frame
+ * identification, sprite detection, colorization, scene rendering, rotation
+ * and every Serum_Load stage. Pass NULL to remove it. Without
+ * ENABLE_TRACING at build time no events are emitted. The callback may call
+ * the tracing functions itself; an event emitted while the callback is being
+ * replaced can still reach the previous one.
+ *
+ * @param callback
+ * @param userData
+ */
+SERUM_API void Serum_SetTraceCallback(Serum_TraceCallback callback,
+                                      const void* userData);
+
+/** @brief Write stage events to a Chrome trace-event JSON file
+ *
+ * The file can be opened in chrome://tracing or Perfetto. A trace file that
+ * is already open is finished first.
+ *
+ * @param filename: Path of the JSON file to create
+ * @return true if the file was opened, false on error or if the library was
+ * built without ENABLE_TRACING
+ */
+SERUM_API bool Serum_StartTraceFile(const char* const filename);
+
+/** @brief Finish and close the trace file opened by Serum_StartTraceFile
+ */
+SERUM_API void Serum_StopTraceFile(void);
+
+/** @brief Record API calls into a capture file for serum_replay
+ *
+ * Every Serum_Colorize() input frame and every Serum_Rotate() and
+ * Serum_Scene_Trigger() call is written with its timestamp and return value
+ * to an LZ4 compressed file. A running capture is finished first. Setting the
+ * SERUM_CAPTURE_FILE environment variable starts a capture on Serum_Load().
+ *
+ * @param filename: Path of the capture file to create
+ * @return true if the file was opened
+ */
+SERUM_API bool Serum_StartCapture(const char* const filename);
+
+/** @brief Finish and close the capture file
+ *
+ * Serum_Dispose() also finishes a running capture.
+ */
+SERUM_API void Serum_StopCapture(void);
+
+/** @brief Run color rotations and scenes on an internal timer
+ *
+ * Starts a scheduler thread that calls Serum_Rotate() when the next color
+ * rotation or scene frame is due, so the host doesn't have to poll it. Every
+ * Serum_Colorize(), Serum_Rotate() and Serum_Scene_Trigger() call re-arms the
+ * timer with the delay it returns; without an active rotation or scene the
+ * thread sleeps. Timers follow the steady clock, not Serum_SetTimeSource() or
+ * the virtual clock. The scheduler keeps running across Serum_Load() until
+ * Serum_StopRotationScheduler() or Serum_Dispose().
+ *
+ * @param callback: Called on the scheduler thread, with the Serum_Frame_Struc
+ * safe to read, each time a rotation or scene step changed the output. The
+ * changed rectangles cover every pixel that differs from the previous output
+ * the host got (for v2 files). Serum_Dispose() and
+ * Serum_StopRotationScheduler() must not be called from it. May be NULL.
+ * @param userData: Passed back to the callback
+ */
+SERUM_API void Serum_StartRotationScheduler(Serum_FrameReadyCallback callback,
+                                           const void* userData);
+
+/** @brief Stop the rotation scheduler thread
+ */
+SERUM_API void Serum_StopRotationScheduler(void);
+
+/** @brief Start colorizing frames on a libserum worker thread
+ *
+ * Frames passed to Serum_SubmitFrame() are queued in a ring of 8 slots and
+ * colorized by a worker thread through Serum_Colorize(), so the caller's
+ * thread only pays for a copy. A running queue is stopped first, and
+ * Serum_Load() and Serum_Dispose() stop it.
+ *
+ * @param callback: Called on the worker thread after each frame with the
+ * Serum_Colorize() return value and the frame timestamp. The Serum_Frame_Struc
+ * may be read during the call; Serum_Load(), Serum_Dispose() and
+ * Serum_StopFrameQueue() must not be called from it. May be NULL, e.g. to
+ * read the output with Serum_AcquireLatestFrame() instead.
+ * @param userData: Passed back to the callback
+ * @param coalesce: true to skip frames that already have a newer frame queued
+ * behind them when the worker gets to them. Skipped frames don't fire
+ * triggers, so leave it false if every frame must be identified.
+ * @return true if the worker was started, false if no Serum file is loaded
+ */
+SERUM_API bool Serum_StartFrameQueue(Serum_FrameDoneCallback callback,
+                                    const void* userData, bool coalesce);
+
+/** @brief Stop the frame queue worker
+ *
+ * Frames that are still queued are discarded.
+ */
+SERUM_API void Serum_StopFrameQueue(void);
+
+/** @brief Queue a frame for colorization on the worker thread
+ *
+ * Doesn't wait for the API lock; call it from one thread only. It may run
+ * while the queue is stopped or restarted, the frame is then rejected.
+ *
+ * @param frame: same as for Serum_Colorize(), copied before returning
+ * @param timestampMs: passed back to the Serum_FrameDoneCallback
+ * @return false if the queue isn't running or is full (the frame is dropped)
+ */
+SERUM_API bool Serum_SubmitFrame(const uint8_t* frame, uint32_t timestampMs);
+
+/** @brief Publish every output frame for a separate render thread
+ *
+ * When enabled, each Serum_Colorize(), Serum_Rotate() and
+ * Serum_Scene_Trigger() call that changes the output copies it into one of
+ * three buffers and publishes it with an atomic index swap. The render
+ * thread reads it with Serum_AcquireLatestFrame() while the next frame is
+ * being colorized, without locking and without torn frames.
+ *
+ * @param enable: true to publish output frames, false to stop
+ */
+SERUM_API void Serum_SetTripleBufferedOutput(bool enable);
+
+/** @brief Get the latest published output frame
+ *
+ * Lock-free, call it from one render thread only. The returned structure and
+ * the buffers it points to are a copy of the output fields of the
+ * Serum_Frame_Struc; they don't change until Serum_ReleaseFrame(), and
+ * calling this again before that returns the same frame. Buffers that are
+ * not available for the frame (width32/width64 is 0) are NULL.
+ *
+ * @return The latest frame, or NULL if triple-buffered output is disabled,
+ * no frame has been published yet or the Serum file was disposed
+ */
+SERUM_API const Serum_Frame_Struc* Serum_AcquireLatestFrame(void);
+
+/** @brief Release the frame returned by Serum_AcquireLatestFrame()
+ */
+SERUM_API void Serum_ReleaseFrame(void);
+
+/** @brief Get a hash of the current output
+ *
+ * FNV-1a hash over the frame32/frame64 planes returned by the last call (v2)
+ * or the frame and palette (v1), to compare runs for bit-exact output.
+ *
+ * @return 64-bit hash of the output planes
+ */
+SERUM_API uint64_t Serum_GetOutputHash(void);
+
+/** @brief Replace the clock used for rotation and scene timing
+ *
+ * Color rotations, scene frame durations and the unknown frames timeout read
+ * their time from the callback instead of the steady clock. Pending timers
+ * are moved to the new clock, so a running rotation or scene keeps its
+ * phase. Pass NULL to go back to the steady clock.
+ *
+ * @param callback: Returns the current time in milliseconds
+ * @param userData: Passed back to the callback
+ */
+SERUM_API void Serum_SetTimeSource(Serum_TimeSourceCallback callback,
+                                   const void* userData);
+
+/** @brief Switch to the virtual clock and set its time
+ *
+ * While the virtual clock is active, time only moves through
+ * Serum_SetVirtualTime() and Serum_AdvanceVirtualTime(). Offline rendering
+ * and replays can then produce the same rotation phases and scene frames as a
+ * real-time run, as fast as the machine allows.
+ *
+ * @param milliseconds: New virtual time
+ */
+SERUM_API void Serum_SetVirtualTime(uint32_t milliseconds);
+
+/** @brief Advance the virtual clock
+ *
+ * Switches to the virtual clock if another source was active.
+ *
+ * @param milliseconds: Time to add
+ */
+SERUM_API void Serum_AdvanceVirtualTime(uint32_t milliseconds);
+
 /** @brief Get the full version of this library
  *
  * @return A string formatted "major.minor.patch"
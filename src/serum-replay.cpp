@@ -0,0 +1,282 @@
+// serum_replay: plays a capture recorded with Serum_StartCapture() or
+// SERUM_CAPTURE_FILE back against a colorization.
+//
+// Usage:
+//   serum_replay [options] <capture> <file.cROMc>
+//   serum_replay [options] <capture> <altcolor path> <rom name>
+//
+// Options:
+//   --realtime          pace the calls like the recording instead of
+//                       replaying as fast as possible
+//   --iterations N      replay the capture N times
+//   --flags N           Serum_Load flags (default: 32P and 64P frames)
+//   --expect-hash HEX   exit with status 2 if the rolling output hash differs
+//   --json FILE         write the report as JSON ("-" for stdout)
+//
+// The library runs on the virtual clock, set to the recorded timestamp before
+// every call, so rotations and scene frames come out the same on every replay
+// no matter how fast it runs. The report lists the latency distribution of
+// every call type, the number of return values that differ from the
+// recording and a rolling hash over Serum_GetOutputHash() after every call,
+// so optimized builds can be checked for bit-exact output against a
+// reference build. Colorize records of another frame size than the
+// colorization reads are skipped.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameCapture.h"
+#include "serum-decode.h"
+
+namespace {
+
+struct CallStats {
+  const char* name;
+  std::vector<uint64_t> latenciesNs = {};
+  uint64_t resultMismatches = 0;
+};
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t index =
+      std::min(sorted.size() - 1,
+               (size_t)(fraction * (double)(sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+bool ReadFile(const char* filename, std::vector<uint8_t>& out) {
+  FILE* fp = fopen(filename, "rb");
+  if (!fp) {
+    return false;
+  }
+  uint8_t buffer[64 * 1024];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    out.insert(out.end(), buffer, buffer + n);
+  }
+  fclose(fp);
+  return !out.empty();
+}
+
+void PrintUsage(const char* argv0) {
+  printf(
+      "Usage: %s [--realtime] [--iterations N] [--flags N] [--expect-hash HEX]"
+      "\n          [--json FILE] <capture> <file.cROMc | altcolor-path rom>\n",
+      argv0);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  bool realtime = false;
+  uint32_t iterations = 1;
+  uint8_t flags = FLAG_REQUEST_32P_FRAMES | FLAG_REQUEST_64P_FRAMES;
+  const char* jsonFile = nullptr;
+  const char* expectHash = nullptr;
+  std::vector<const char*> positional;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--realtime") {
+      realtime = true;
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--flags" && hasValue) {
+      flags = (uint8_t)strtoul(argv[++i], nullptr, 0);
+    } else if (arg == "--expect-hash" && hasValue) {
+      expectHash = argv[++i];
+    } else if (arg == "--json" && hasValue) {
+      jsonFile = argv[++i];
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      PrintUsage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  if (positional.size() != 2 && positional.size() != 3) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  const char* captureFile = positional[0];
+
+  Serum_SetVirtualTime(0);
+  Serum_Frame_Struc* serum = nullptr;
+  if (positional.size() == 2) {
+    std::vector<uint8_t> image;
+    if (!ReadFile(positional[1], image)) {
+      fprintf(stderr, "Failed to read %s\n", positional[1]);
+      return 1;
+    }
+    serum = Serum_LoadFromBuffer(image.data(), image.size(), flags);
+  } else {
+    serum = Serum_Load(positional[1], positional[2], flags);
+  }
+  if (!serum) {
+    fprintf(stderr, "Failed to load the colorization\n");
+    return 1;
+  }
+
+  // Colorize records of another size would be read past their end.
+  const uint32_t inputFrameSize = Serum_GetInputFrameSize();
+
+  CallStats colorize{"colorize"};
+  CallStats rotate{"rotate"};
+  CallStats scene{"scene_trigger"};
+  uint64_t rollingHash = 1469598103934665603ull;
+  uint32_t virtualMs = 0;
+  uint32_t passBaseMs = 0;
+  uint64_t records = 0;
+  uint64_t skippedFrames = 0;
+  const auto replayStart = std::chrono::steady_clock::now();
+
+  for (uint32_t pass = 0; pass < iterations; ++pass) {
+    CaptureReader reader;
+    if (!reader.Open(captureFile)) {
+      fprintf(stderr, "Failed to open capture %s\n", captureFile);
+      Serum_Dispose();
+      return 1;
+    }
+    const auto passStart = std::chrono::steady_clock::now();
+    CaptureRecord record;
+    while (reader.Next(record)) {
+      if (realtime) {
+        std::this_thread::sleep_until(
+            passStart + std::chrono::milliseconds(record.timestampMs));
+      }
+      virtualMs = passBaseMs + record.timestampMs;
+      Serum_SetVirtualTime(virtualMs);
+      CallStats* stats = nullptr;
+      uint32_t result = 0;
+      const auto start = std::chrono::steady_clock::now();
+      switch (record.type) {
+        case CaptureRecordType::Colorize:
+          if ((uint32_t)record.width * record.height != inputFrameSize ||
+              (uint32_t)record.frame.size() != inputFrameSize) {
+            ++skippedFrames;
+            continue;
+          }
+          result = Serum_Colorize(record.frame.data());
+          stats = &colorize;
+          break;
+        case CaptureRecordType::Rotate:
+          result = Serum_Rotate();
+          stats = &rotate;
+          break;
+        case CaptureRecordType::SceneTrigger:
+          result = Serum_Scene_Trigger(record.sceneId);
+          stats = &scene;
+          break;
+      }
+      const auto end = std::chrono::steady_clock::now();
+      stats->latenciesNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count());
+      if (result != record.result) {
+        ++stats->resultMismatches;
+      }
+      const uint64_t outputHash = Serum_GetOutputHash();
+      for (int i = 0; i < 8; ++i) {
+        rollingHash ^= (outputHash >> (8 * i)) & 0xff;
+        rollingHash *= 1099511628211ull;
+      }
+      ++records;
+    }
+    passBaseMs = virtualMs + 1;
+    if (reader.HasError()) {
+      fprintf(stderr, "Capture %s is damaged after %" PRIu64 " records\n",
+              captureFile, records);
+    }
+  }
+  const double wallMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - replayStart)
+                            .count();
+  Serum_Dispose();
+  if (skippedFrames) {
+    fprintf(stderr,
+            "Skipped %" PRIu64 " colorize records that aren't %u bytes, the "
+            "frame size the colorization reads\n",
+            skippedFrames, inputFrameSize);
+  }
+
+  FILE* json = nullptr;
+  if (jsonFile) {
+    json = strcmp(jsonFile, "-") == 0 ? stdout : fopen(jsonFile, "wb");
+    if (!json) {
+      fprintf(stderr, "Failed to open %s for writing\n", jsonFile);
+      return 1;
+    }
+  }
+  // Keep stdout clean for "--json -".
+  FILE* report = json == stdout ? stderr : stdout;
+  char hashText[17];
+  snprintf(hashText, sizeof(hashText), "%016" PRIx64, rollingHash);
+  const double capturedMs = (double)virtualMs;
+
+  fprintf(report,
+          "records %" PRIu64
+          ", captured %.1f ms, replayed in %.1f ms (%.1fx)\n",
+          records, capturedMs, wallMs, wallMs > 0 ? capturedMs / wallMs : 0.0);
+  fprintf(report, "%-14s %9s %10s %10s %10s %10s %10s %10s\n", "call",
+          "count", "mean_us", "p50_us", "p90_us", "p99_us", "max_us",
+          "mismatch");
+  if (json) {
+    fprintf(json,
+            "{\n  \"records\": %" PRIu64 ",\n  \"captured_ms\": %.3f,\n"
+            "  \"replay_ms\": %.3f,\n  \"output_hash\": \"%s\",\n"
+            "  \"calls\": {",
+            records, capturedMs, wallMs, hashText);
+  }
+  bool firstJson = true;
+  for (CallStats* stats : {&colorize, &rotate, &scene}) {
+    std::vector<uint64_t>& samples = stats->latenciesNs;
+    std::sort(samples.begin(), samples.end());
+    uint64_t total = 0;
+    for (uint64_t sample : samples) {
+      total += sample;
+    }
+    const double mean = samples.empty() ? 0.0 : (double)total / samples.size();
+    const uint64_t p50 = Percentile(samples, 0.50);
+    const uint64_t p90 = Percentile(samples, 0.90);
+    const uint64_t p99 = Percentile(samples, 0.99);
+    const uint64_t max = samples.empty() ? 0 : samples.back();
+    fprintf(report,
+            "%-14s %9zu %10.2f %10.2f %10.2f %10.2f %10.2f %10" PRIu64 "\n",
+            stats->name, samples.size(), mean / 1000.0, p50 / 1000.0,
+            p90 / 1000.0, p99 / 1000.0, max / 1000.0, stats->resultMismatches);
+    if (json) {
+      fprintf(json,
+              "%s\n    \"%s\": {\"count\": %zu, \"mean_ns\": %.1f, "
+              "\"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64
+              ", \"p99_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64
+              ", \"result_mismatches\": %" PRIu64 "}",
+              firstJson ? "" : ",", stats->name, samples.size(), mean, p50,
+              p90, p99, max, stats->resultMismatches);
+      firstJson = false;
+    }
+  }
+  fprintf(report, "output hash %s\n", hashText);
+  if (json) {
+    fprintf(json, "\n  }\n}\n");
+    if (json != stdout) {
+      fclose(json);
+    }
+  }
+
+  if (expectHash && strtoull(expectHash, nullptr, 16) != rollingHash) {
+    fprintf(stderr, "Output hash mismatch: expected %s, got %s\n", expectHash,
+            hashText);
+    return 2;
+  }
+  return 0;
+}
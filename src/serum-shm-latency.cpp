@@ -0,0 +1,265 @@
+// serum_shm_latency: measures how long colorized frames take to reach a
+// separate process through the shared-memory output ring.
+//
+// Usage:
+//   serum_shm_latency [options] <capture> <file.cROMc>
+//
+// Options:
+//   --interval-ms N   pause between the recorded calls (default 0: as fast
+//                     as possible)
+//   --slots N         ring slots (default 8)
+//   --flags N         Serum_Load flags (default: 32P and 64P frames)
+//
+// A forked reader process polls the ring and reads every frame in place; the
+// latency of a frame is the time from its publication in Serum_Colorize(),
+// Serum_Rotate() or Serum_Scene_Trigger() until the reader finished reading
+// its pixels. The calls of the capture (see serum_replay) are played once on
+// the virtual clock.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameCapture.h"
+#include "serum-decode.h"
+#include "serum-shm.h"
+
+namespace {
+
+uint64_t SteadyNowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t index =
+      std::min(sorted.size() - 1,
+               (size_t)(fraction * (double)(sorted.size() - 1) + 0.5));
+  return sorted[index];
+}
+
+bool ReadFile(const char* filename, std::vector<uint8_t>& out) {
+  FILE* fp = fopen(filename, "rb");
+  if (!fp) {
+    return false;
+  }
+  uint8_t buffer[64 * 1024];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    out.insert(out.end(), buffer, buffer + n);
+  }
+  fclose(fp);
+  return !out.empty();
+}
+
+// Reader process: waits for the ring, tells the writer through readyFd that
+// it follows it, then reads frames until the writer sends the number of
+// frames it published through doneFd and all of them are accounted for.
+int RunReader(const char* name, int readyFd, int doneFd) {
+  SerumShmReader reader;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (!reader.Open(name)) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      fprintf(stderr, "Reader can't open %s\n", name);
+      return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::vector<uint64_t> latenciesNs;
+  uint64_t next = reader.Published();
+  const char ready = 1;
+  if (write(readyFd, &ready, 1) != 1) return 1;
+  close(readyFd);
+  uint64_t total = UINT64_MAX;
+  uint64_t lapped = 0;
+  uint32_t sum = 0;
+  while (next < total) {
+    if (total == UINT64_MAX && read(doneFd, &total, sizeof(total)) <= 0) {
+      total = UINT64_MAX;
+    }
+    if (next >= reader.Published()) {
+      std::this_thread::yield();
+      continue;
+    }
+    const uint64_t n = next++;
+    const Serum_Shm_Slot* slot = reader.Begin(n);
+    if (!slot) {
+      ++lapped;
+      continue;
+    }
+    const uint32_t pixels32 =
+        std::min<uint32_t>(slot->width32, SERUM_SHM_MAX_WIDTH) * 32;
+    const uint32_t pixels64 =
+        std::min<uint32_t>(slot->width64, SERUM_SHM_MAX_WIDTH) * 64;
+    for (uint32_t i = 0; i < pixels32; ++i) sum += slot->frame32[i];
+    for (uint32_t i = 0; i < pixels64; ++i) sum += slot->frame64[i];
+    const uint32_t pixels =
+        std::min<uint32_t>(slot->width, SERUM_SHM_MAX_WIDTH) *
+        std::min<uint32_t>(slot->height, 64);
+    for (uint32_t i = 0; i < pixels; ++i) sum += slot->frame[i];
+    const uint64_t publishedNs = slot->timestampNs;
+    if (!reader.End(slot, n)) {
+      ++lapped;
+      continue;
+    }
+    latenciesNs.push_back(SteadyNowNs() - publishedNs);
+  }
+
+  std::sort(latenciesNs.begin(), latenciesNs.end());
+  printf("frames read: %zu, lapped: %" PRIu64 " (checksum %08x)\n",
+         latenciesNs.size(), lapped, sum);
+  printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+         Percentile(latenciesNs, 0.5) / 1000.0,
+         Percentile(latenciesNs, 0.9) / 1000.0,
+         Percentile(latenciesNs, 0.99) / 1000.0,
+         Percentile(latenciesNs, 1.0) / 1000.0);
+  return 0;
+}
+
+void PrintUsage(const char* argv0) {
+  printf(
+      "Usage: %s [--interval-ms N] [--slots N] [--flags N] <capture> "
+      "<file.cROMc>\n",
+      argv0);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  uint32_t intervalMs = 0;
+  uint32_t slots = 8;
+  uint8_t flags = FLAG_REQUEST_32P_FRAMES | FLAG_REQUEST_64P_FRAMES;
+  std::vector<const char*> positional;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--interval-ms" && hasValue) {
+      intervalMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--slots" && hasValue) {
+      slots = std::max(1, atoi(argv[++i]));
+    } else if (arg == "--flags" && hasValue) {
+      flags = (uint8_t)strtoul(argv[++i], nullptr, 0);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      PrintUsage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  if (positional.size() != 2) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // The reader is forked before libserum starts any thread. It waits for
+  // the ring and reports back before the first call, so it sees every
+  // frame.
+  const std::string name = "/serum-latency-" + std::to_string(getpid());
+  int ready[2];
+  int done[2];
+  if (pipe(ready) != 0 || pipe(done) != 0) {
+    fprintf(stderr, "pipe failed\n");
+    return 1;
+  }
+  fflush(stdout);
+  const pid_t child = fork();
+  if (child == 0) {
+    close(ready[0]);
+    close(done[1]);
+    fcntl(done[0], F_SETFL, O_NONBLOCK);
+    const int status = RunReader(name.c_str(), ready[1], done[0]);
+    fflush(stdout);
+    _exit(status);
+  }
+  close(ready[1]);
+  close(done[0]);
+  if (child < 0) {
+    fprintf(stderr, "fork failed\n");
+    return 1;
+  }
+  auto fail = [&](const std::string& message) {
+    fprintf(stderr, "%s\n", message.c_str());
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+    Serum_Dispose();
+    return 1;
+  };
+
+  std::vector<uint8_t> image;
+  if (!ReadFile(positional[1], image)) {
+    return fail(std::string("Failed to read ") + positional[1]);
+  }
+  Serum_SetVirtualTime(0);
+  if (!Serum_LoadFromBuffer(image.data(), image.size(), flags)) {
+    return fail("Failed to load the colorization");
+  }
+  if (!Serum_OpenSharedOutput(name.c_str(), slots)) {
+    return fail(std::string("Failed to create the ring: ") +
+                Serum_GetLastErrorMessage());
+  }
+  char readyByte;
+  if (read(ready[0], &readyByte, 1) != 1) {
+    return fail("The reader of " + name + " failed");
+  }
+  SerumShmReader ring;
+  if (!ring.Open(name.c_str())) {
+    return fail("Failed to open " + name);
+  }
+
+  CaptureReader capture;
+  if (!capture.Open(positional[0])) {
+    return fail(std::string("Failed to open capture ") + positional[0]);
+  }
+  const uint32_t inputFrameSize = Serum_GetInputFrameSize();
+  CaptureRecord record;
+  while (capture.Next(record)) {
+    Serum_SetVirtualTime(record.timestampMs);
+    switch (record.type) {
+      case CaptureRecordType::Colorize:
+        // Frames of another size would be read past their end.
+        if ((uint32_t)record.width * record.height != inputFrameSize ||
+            (uint32_t)record.frame.size() != inputFrameSize) {
+          continue;
+        }
+        Serum_Colorize(record.frame.data());
+        break;
+      case CaptureRecordType::Rotate:
+        Serum_Rotate();
+        break;
+      case CaptureRecordType::SceneTrigger:
+        Serum_Scene_Trigger(record.sceneId);
+        break;
+    }
+    if (intervalMs) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+  }
+  const uint64_t published = ring.Published();
+  printf("frames published: %" PRIu64 "\n", published);
+  fflush(stdout);
+  if (write(done[1], &published, sizeof(published)) != sizeof(published)) {
+    kill(child, SIGTERM);
+  }
+  close(done[1]);
+
+  int status = 0;
+  waitpid(child, &status, 0);
+  Serum_Dispose();
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
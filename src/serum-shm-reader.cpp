@@ -0,0 +1,131 @@
+// serum_shm_reader: reference consumer of the shared-memory output ring
+// created with Serum_OpenSharedOutput(). Only needs serum-shm.h, not
+// libserum.
+//
+// Usage:
+//   serum_shm_reader [--count N] [--latest] <name>
+//
+// Options:
+//   --count N    exit after N frames (default: run until interrupted)
+//   --latest     jump to the newest frame instead of reading every frame,
+//                as a display that only shows the current frame would
+//
+// Prints one line per frame with its IDs, the plane sizes, a checksum of the
+// pixels read in place and the time since the frame was published. Frames
+// the writer overwrote before they were read are counted as lapped, frames
+// passed over with --latest as skipped.
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "serum-shm.h"
+
+namespace {
+
+uint64_t SteadyNowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename Pixel>
+uint32_t Checksum(const Pixel* pixels, uint32_t count) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    sum = sum * 31 + pixels[i];
+  }
+  return sum;
+}
+
+void PrintUsage(const char* argv0) {
+  printf("Usage: %s [--count N] [--latest] <name>\n", argv0);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  uint64_t count = 0;
+  bool latest = false;
+  const char* name = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--count" && i + 1 < argc) {
+      count = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--latest") {
+      latest = true;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      PrintUsage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 1;
+    } else {
+      name = argv[i];
+    }
+  }
+  if (!name) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  SerumShmReader reader;
+  while (!reader.Open(name)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  printf("Opened %s with %u slots\n", name, reader.SlotCount());
+
+  uint64_t next = reader.Published();
+  uint64_t read = 0;
+  uint64_t lapped = 0;
+  uint64_t skipped = 0;
+  while (count == 0 || read < count) {
+    const uint64_t published = reader.Published();
+    if (next >= published) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+    if (latest) {
+      skipped += published - 1 - next;
+      next = published - 1;
+    }
+    const uint64_t n = next++;
+    const Serum_Shm_Slot* slot = reader.Begin(n);
+    if (!slot) {
+      ++lapped;
+      continue;
+    }
+    const uint32_t frameID = slot->frameID;
+    const uint32_t triggerID = slot->triggerID;
+    const uint32_t result = slot->result;
+    const uint32_t width32 = slot->width32;
+    const uint32_t width64 = slot->width64;
+    const uint32_t width = slot->width;
+    const uint32_t height = slot->height;
+    uint32_t sum = 0;
+    if (width32 <= SERUM_SHM_MAX_WIDTH) {
+      sum ^= Checksum(slot->frame32, width32 * 32);
+    }
+    if (width64 <= SERUM_SHM_MAX_WIDTH) {
+      sum ^= Checksum(slot->frame64, width64 * 64);
+    }
+    if (width <= SERUM_SHM_MAX_WIDTH && height <= 64) {
+      sum ^= Checksum(slot->frame, width * height);
+      sum ^= Checksum(slot->palette, sizeof(slot->palette));
+    }
+    const uint64_t publishedNs = slot->timestampNs;
+    if (!reader.End(slot, n)) {
+      ++lapped;
+      continue;
+    }
+    ++read;
+    printf("#%" PRIu64 " frame %u trigger %u result 0x%08x 32p %u 64p %u "
+           "v1 %ux%u sum %08x age %.1f us\n",
+           n, frameID, triggerID, result, width32, width64, width, height, sum,
+           (double)(SteadyNowNs() - publishedNs) / 1000.0);
+  }
+  printf("%" PRIu64 " frames read, %" PRIu64 " lapped, %" PRIu64 " skipped\n",
+         read, lapped, skipped);
+  return 0;
+}
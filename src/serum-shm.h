@@ -0,0 +1,139 @@
+#pragma once
+
+// Layout of the shared-memory output ring written by Serum_OpenSharedOutput()
+// and a reader for it, so a display process can consume the colorized
+// frames in place without linking libserum. POSIX only, not on Android,
+// whose libc has no shm_open().
+//
+// The segment starts with a Serum_Shm_Header followed by slotCount
+// Serum_Shm_Slot. Frame n (counted from 0) is written to slot
+// n % slotCount; header.published is the number of frames written. Each
+// slot is a sequence lock: its sequence is 2n+1 while frame n is written
+// and 2n+2 once it is complete. A reader checks the sequence before and
+// after using the slot; if it changed, the writer lapped the reader and
+// the data read in between must be discarded.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SERUM_SHM_MAGIC 0x4d485353u  // "SSHM"
+#define SERUM_SHM_VERSION 2
+#define SERUM_SHM_MAX_WIDTH 256  // widest plane a slot holds
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "the ring needs address-free atomics");
+
+struct Serum_Shm_Header {
+  std::atomic<uint32_t> magic;  // SERUM_SHM_MAGIC once the ring is set up
+  uint32_t version;             // SERUM_SHM_VERSION
+  uint32_t slotCount;
+  uint32_t slotSize;  // sizeof(Serum_Shm_Slot)
+  std::atomic<uint64_t> published;
+};
+
+struct Serum_Shm_Slot {
+  std::atomic<uint64_t> sequence;
+  uint64_t timestampNs;    // steady clock when the frame was published
+  uint32_t result;         // return value of the call that changed the output
+  uint32_t frameID;        // Serum_Frame_Struc fields after that call
+  uint32_t triggerID;
+  uint32_t rotationtimer;
+  uint32_t width32;        // 0 if the frame has no 32p plane
+  uint32_t width64;        // 0 if the frame has no 64p plane
+  uint32_t width;          // size of the v1 frame, 0 for v2 content
+  uint32_t height;
+  uint16_t frame32[SERUM_SHM_MAX_WIDTH * 32];  // width32 * 32 pixels used
+  uint16_t frame64[SERUM_SHM_MAX_WIDTH * 64];  // width64 * 64 pixels used
+  uint8_t frame[SERUM_SHM_MAX_WIDTH * 64];  // width * height palette indices
+  uint8_t palette[64 * 3];                  // RGB888 palette of frame
+};
+
+inline size_t Serum_Shm_SegmentSize(uint32_t slotCount) {
+  return sizeof(Serum_Shm_Header) + (size_t)slotCount * sizeof(Serum_Shm_Slot);
+}
+
+inline Serum_Shm_Slot* Serum_Shm_Slots(Serum_Shm_Header* header) {
+  return reinterpret_cast<Serum_Shm_Slot*>(header + 1);
+}
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+
+// Read-only view of a ring. Usage:
+//
+//   uint64_t n = reader.Published() - 1;        // newest frame
+//   const Serum_Shm_Slot* slot = reader.Begin(n);
+//   if (slot) { ...use slot...; if (!reader.End(slot, n)) discard; }
+class SerumShmReader {
+ public:
+  ~SerumShmReader() { Close(); }
+
+  bool Open(const char* name) {
+    Close();
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Serum_Shm_Header)) {
+      close(fd);
+      return false;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    m_header = static_cast<Serum_Shm_Header*>(map);
+    m_size = (size_t)st.st_size;
+    if (m_header->magic.load(std::memory_order_acquire) != SERUM_SHM_MAGIC ||
+        m_header->version != SERUM_SHM_VERSION ||
+        m_header->slotSize != sizeof(Serum_Shm_Slot) ||
+        m_size < Serum_Shm_SegmentSize(m_header->slotCount)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() {
+    if (m_header) munmap(m_header, m_size);
+    m_header = nullptr;
+    m_size = 0;
+  }
+
+  bool IsOpen() const { return m_header != nullptr; }
+  uint32_t SlotCount() const { return m_header->slotCount; }
+
+  // Number of frames written so far.
+  uint64_t Published() const {
+    return m_header->published.load(std::memory_order_acquire);
+  }
+
+  // Slot holding frame n, or nullptr if it was overwritten or isn't
+  // complete.
+  const Serum_Shm_Slot* Begin(uint64_t n) const {
+    const Serum_Shm_Slot* slot =
+        Serum_Shm_Slots(m_header) + n % m_header->slotCount;
+    if (slot->sequence.load(std::memory_order_acquire) != 2 * n + 2) {
+      return nullptr;
+    }
+    return slot;
+  }
+
+  // True if frame n was still in the slot while it was being read.
+  bool End(const Serum_Shm_Slot* slot, uint64_t n) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == 2 * n + 2;
+  }
+
+ private:
+  Serum_Shm_Header* m_header = nullptr;
+  size_t m_size = 0;
+};
+
+#endif
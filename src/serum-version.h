@@ -3,7 +3,7 @@
 #define SERUM_VERSION_MAJOR 2        // X Digits
 #define SERUM_VERSION_MINOR 6        // Max 2 Digits
 #define SERUM_VERSION_PATCH 0        // Max 2 Digits
-#define SERUM_CONCENTRATE_VERSION 7  // Max 2 Digits
+#define SERUM_CONCENTRATE_VERSION 12  // Max 2 Digits
 
 #define _SERUM_STR(x) #x
 #define SERUM_STR(x) _SERUM_STR(x)
@@ -8,11 +8,53 @@
 
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 typedef void(SERUM_CALLBACK* Serum_LogCallback)(const char* format,
                                                 va_list args,
                                                 const void* userData);
 
+enum  // phase passed to Serum_TraceCallback
+{
+  SERUM_TRACE_BEGIN = 0,
+  SERUM_TRACE_END = 1,
+};
+
+// stage is a static string, timestampNs comes from the monotonic
+// (steady) clock
+typedef void(SERUM_CALLBACK* Serum_TraceCallback)(const char* stage,
+                                                  uint32_t phase,
+                                                  uint64_t timestampNs,
+                                                  const void* userData);
+
+// returns the current time in milliseconds; only differences are used, so
+// any monotonic origin works
+typedef uint32_t(SERUM_CALLBACK* Serum_TimeSourceCallback)(
+    const void* userData);
+
+// result is the Serum_Colorize() return value for the frame submitted with
+// timestampMs
+typedef void(SERUM_CALLBACK* Serum_FrameDoneCallback)(uint32_t result,
+                                                      uint32_t timestampMs,
+                                                      const void* userData);
+
+typedef struct _Serum_Rect {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;  // 0 if the rectangle is empty
+  uint16_t height;
+} Serum_Rect;
+
+typedef struct _Serum_Frame_Ready {
+  uint32_t result;       // Serum_Rotate() return value
+  Serum_Rect changed32;  // pixels of frame32 changed since the last output
+  Serum_Rect changed64;  // pixels of frame64 changed since the last output
+} Serum_Frame_Ready;
+
+// called by the rotation scheduler after it changed the output
+typedef void(SERUM_CALLBACK* Serum_FrameReadyCallback)(
+    const Serum_Frame_Ready* ready, const void* userData);
+
 // mask for the mutually exclusive scene-finish behavior bits
 #define FLAG_SCENE_FINISH_MODE_MASK 3
 
@@ -51,6 +93,13 @@ enum {
   FLAG_REQUEST_FALLBACK =
       16,  // if extra-only output is requested, fall back to original output
            // when no extra-resolution frame is available
+  FLAG_REQUEST_V1_UPCONVERT =
+      32,  // convert Serum v1 projects to v2 at load time, so they run on the
+           // v2 pipeline and return RGB565 frames (colors are reduced to
+           // RGB565, rotations follow the v2 timing rules)
+  FLAG_REQUEST_V1_COMPAT_OUTPUT =
+      64,  // with FLAG_REQUEST_V1_UPCONVERT: keep filling the v1 frame,
+           // palette and rotations fields as well
 };
 
 enum  // returned values in Serum_Frame_Sttruc::flags for v2+ format
@@ -73,6 +122,16 @@ enum  // returned flags that are added to the timings if there were rotations
   FLAG_RETURNED_V2_SCENE = 0x40000,
 };
 
+enum  // pixel formats of the output planes, see Serum_SetOutputFormat()
+{
+  SERUM_PIXEL_FORMAT_RGB565 = 0,     // native, only frame32/frame64 are filled
+  SERUM_PIXEL_FORMAT_RGB565_BE = 1,  // 2 bytes per pixel, big-endian
+  SERUM_PIXEL_FORMAT_RGB888 = 2,     // 3 bytes per pixel: R, G, B
+  SERUM_PIXEL_FORMAT_RGBA8888 = 3,   // 4 bytes per pixel: R, G, B, 0xff
+  SERUM_PIXEL_FORMAT_BGRA8888 = 4,   // 4 bytes per pixel: B, G, R, 0xff
+  SERUM_PIXEL_FORMAT_COUNT
+};
+
 enum  // runtime metadata feature flags
 {
   SERUM_RUNTIME_FEATURE_MATCHED = 1 << 0,
@@ -97,6 +156,49 @@ typedef struct _Serum_Runtime_Metadata {
   uint32_t reserved;
 } Serum_Runtime_Metadata;
 
+enum  // stages reported in Serum_Perf_Counters::stages
+{
+  SERUM_PERF_STAGE_IDENTIFY_NORMAL = 0,
+  SERUM_PERF_STAGE_IDENTIFY_SCENE,
+  SERUM_PERF_STAGE_CRITICAL_TRIGGER,
+  SERUM_PERF_STAGE_SPRITE_CHECK,
+  SERUM_PERF_STAGE_COLORIZE_FRAME,
+  SERUM_PERF_STAGE_COLORIZE_SPRITE,
+  SERUM_PERF_STAGE_ROTATE,
+  SERUM_PERF_STAGE_SCENE_RENDER,
+  SERUM_PERF_STAGE_FRAME_ROUND_TRIP,  // whole colorize call of rendered frames
+  SERUM_PERF_STAGE_LOAD_TOTAL,
+  SERUM_PERF_STAGE_LOAD_CROMC,
+  SERUM_PERF_STAGE_LOAD_RAW,
+  SERUM_PERF_STAGE_LOAD_CSV,
+  SERUM_PERF_STAGE_LOAD_LOOKUPS,  // runtime lookup tables built after load
+  SERUM_PERF_STAGE_COUNT
+};
+
+// histogram bucket i counts samples in [2^i, 2^(i+1)) nanoseconds, bucket 0
+// also holds zero-length samples and the last bucket is open-ended
+#define SERUM_PERF_HISTOGRAM_BUCKETS 32
+
+typedef struct _Serum_Perf_Stage {
+  uint64_t calls;
+  uint64_t totalNs;
+  uint64_t maxNs;
+  uint64_t p50Ns;  // estimated from the histogram
+  uint64_t p99Ns;  // estimated from the histogram
+  uint64_t histogram[SERUM_PERF_HISTOGRAM_BUCKETS];
+} Serum_Perf_Stage;
+
+typedef struct _Serum_Perf_Counters {
+  uint32_t size;
+  uint32_t stageCount;  // number of valid entries in stages
+  uint64_t inputFrames;       // frames passed to Serum_Colorize
+  uint64_t renderedFrames;    // frames that produced new output
+  uint64_t sameFrameReturns;  // IDENTIFY_SAME_FRAME results
+  uint64_t noFrameReturns;    // IDENTIFY_NO_FRAME results
+  uint64_t residentBytes;     // process RSS when the counters were read
+  Serum_Perf_Stage stages[SERUM_PERF_STAGE_COUNT];
+} Serum_Perf_Counters;
+
 typedef struct _Serum_Frame_Struc {
   // data for v1 Serum format
   uint8_t* frame;      // return the colorized frame
@@ -143,8 +245,50 @@ typedef struct _Serum_Frame_Struc {
                        // the trigger if one is set for that frame
   uint32_t frameID;    // for CDMD ingame tester
   uint32_t rotationtimer;
+  // frame32/frame64 converted to the format set with Serum_SetOutputFormat(),
+  // packed rows; NULL while the plane is output as SERUM_PIXEL_FORMAT_RGB565
+  uint8_t* output32;
+  uint8_t* output64;
+  // indexed copies of frame32/frame64, see Serum_SetIndexedOutput(): one
+  // palette index per pixel and up to 256 RGB565 palette entries; NULL and 0
+  // when indexed output is off or the frame needs more than 256 entries
+  uint8_t* index32;
+  uint16_t* palette32;
+  uint32_t palettesize32;
+  uint8_t* index64;
+  uint16_t* palette64;
+  uint32_t palettesize64;
+  // changes of frame32/frame64 since the previous output change, see
+  // Serum_SetDeltaOutput(); NULL and 0 when delta output is off or the
+  // plane didn't change
+  uint8_t* delta32;
+  uint32_t deltasize32;  // in bytes
+  Serum_Rect dirty32;    // bounding rectangle of the changed pixels
+  uint8_t* delta64;
+  uint32_t deltasize64;
+  Serum_Rect dirty64;
 } Serum_Frame_Struc;
 
+// caller memory for one output plane, see Serum_SetOutputBuffers()
+typedef struct _Serum_Output_Plane {
+  uint16_t* frame;  // receives frame32/frame64, NULL for the library's buffer
+  uint32_t stride;  // pixels per row of frame, 0 for the width rounded up to
+                    // the alignment
+  uint16_t* rotationsinframe;  // optional, width * height * 2 entries
+  uint8_t* modifiedelements;   // optional, width * height entries
+} Serum_Output_Plane;
+
+// one frame of Serum_ColorizeBatch() output
+typedef struct _Serum_Batch_Output {
+  uint16_t* frame32;  // set by the caller: receives the 32p frame, or NULL
+  uint16_t* frame64;  // set by the caller: receives the 64p frame, or NULL
+  uint32_t width32;   // 0 if there is no 32p frame for this input
+  uint32_t width64;   // 0 if there is no 64p frame for this input
+  uint32_t result;    // Serum_Colorize() return value for this input
+  uint32_t frameID;   // Serum_Frame_Struc::frameID after this input
+  uint32_t triggerID;  // Serum_Frame_Struc::triggerID after this input
+} Serum_Batch_Output;
+
 const int MAX_DYNA_4COLS_PER_FRAME =
     16;  // max number of color sets for dynamic content for each frame (old
          // version)
@@ -180,8 +324,23 @@ const uint32_t IDENTIFY_SAME_FRAME = 0xfffffffe;
 typedef Serum_Frame_Struc* (*Serum_LoadFunc)(const char* const altcolorpath,
                                              const char* const romname,
                                              uint8_t flags);
+typedef Serum_Frame_Struc* (*Serum_LoadFromBufferFunc)(const uint8_t* data,
+                                                       size_t size,
+                                                       uint8_t flags);
 typedef void (*Serum_DisposeFunc)(void);
 typedef uint32_t (*Serum_ColorizeFunc)(uint8_t* frame);
+typedef bool (*Serum_SetOutputBuffersFunc)(const Serum_Output_Plane* plane32,
+                                           const Serum_Output_Plane* plane64,
+                                           uint32_t alignment);
+typedef bool (*Serum_SetOutputFormatFunc)(uint8_t format32, uint8_t format64);
+typedef void (*Serum_SetIndexedOutputFunc)(bool enable);
+typedef void (*Serum_SetDeltaOutputFunc)(bool enable);
+typedef bool (*Serum_OpenSharedOutputFunc)(const char* name, uint32_t slots);
+typedef void (*Serum_CloseSharedOutputFunc)(void);
+typedef bool (*Serum_ColorizeBatchFunc)(const uint8_t* frames,
+                                        const uint32_t* timestampsMs,
+                                        uint32_t count,
+                                        Serum_Batch_Output* outputs);
 typedef uint32_t (*Serum_RotateFunc)(void);
 typedef const char* (*Serum_GetVersionFunc)(void);
 typedef const char* (*Serum_GetMinorVersionFunc)(void);
@@ -198,6 +357,30 @@ typedef void (*Serum_EnableColorizationFunc)(void);
 typedef void (*Serum_DisablePupTriggersFunc)(void);
 typedef void (*Serum_EnablePupTrigersFunc)(void);
 typedef bool (*Serum_GetRuntimeMetadataFunc)(Serum_Runtime_Metadata* metadata);
+typedef bool (*Serum_GetPerfCountersFunc)(Serum_Perf_Counters* counters);
+typedef void (*Serum_ResetPerfCountersFunc)(void);
+typedef void (*Serum_SetTraceCallbackFunc)(Serum_TraceCallback callback,
+                                           const void* userData);
+typedef bool (*Serum_StartTraceFileFunc)(const char* const filename);
+typedef void (*Serum_StopTraceFileFunc)(void);
+typedef bool (*Serum_StartCaptureFunc)(const char* const filename);
+typedef void (*Serum_StopCaptureFunc)(void);
+typedef void (*Serum_StartRotationSchedulerFunc)(
+    Serum_FrameReadyCallback callback, const void* userData);
+typedef void (*Serum_StopRotationSchedulerFunc)(void);
+typedef bool (*Serum_StartFrameQueueFunc)(Serum_FrameDoneCallback callback,
+                                          const void* userData, bool coalesce);
+typedef void (*Serum_StopFrameQueueFunc)(void);
+typedef bool (*Serum_SubmitFrameFunc)(const uint8_t* frame,
+                                      uint32_t timestampMs);
+typedef void (*Serum_SetTripleBufferedOutputFunc)(bool enable);
+typedef const Serum_Frame_Struc* (*Serum_AcquireLatestFrameFunc)(void);
+typedef void (*Serum_ReleaseFrameFunc)(void);
+typedef uint64_t (*Serum_GetOutputHashFunc)(void);
+typedef void (*Serum_SetTimeSourceFunc)(Serum_TimeSourceCallback callback,
+                                        const void* userData);
+typedef void (*Serum_SetVirtualTimeFunc)(uint32_t milliseconds);
+typedef void (*Serum_AdvanceVirtualTimeFunc)(uint32_t milliseconds);
 typedef bool (*Serum_Scene_ParseCSVFunc)(const char* const csv_filename);
 typedef bool (*Serum_Scene_GenerateDumpFunc)(const char* const dump_filename,
                                              int id);
@@ -13,6 +13,7 @@
 #include <utility>
 #include <vector>
 
+#include "Diagnostics.h"
 #include "LZ4Stream.h"
 
 bool is_real_machine();
@@ -28,8 +29,98 @@ inline void SetLegacyLoadExpected(bool expected) {
 }
 
 inline bool IsLegacyLoadExpected() { return LegacyLoadExpectedFlag(); }
+
+// cROMc version of the archive currently being read or written, so vectors
+// can gate fields that were added after the legacy layout.
+inline uint16_t &ArchiveVersionFlag() {
+  static uint16_t version = 0;
+  return version;
+}
+
+inline void SetArchiveVersion(uint16_t version) {
+  ArchiveVersionFlag() = version;
+}
+
+inline uint16_t ArchiveVersion() { return ArchiveVersionFlag(); }
 }  // namespace sparse_vector_serialization
 
+namespace sparse_vector_hash {
+inline uint64_t Rotl64(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t MixWord(uint64_t hash, uint64_t word) {
+  word *= 0xC2B2AE3D27D4EB4Full;
+  word = Rotl64(word, 31);
+  word *= 0x9E3779B185EBCA87ull;
+  hash ^= word;
+  return Rotl64(hash, 27) * 0x9E3779B185EBCA87ull + 0x85EBCA77C2B2AE63ull;
+}
+
+// Word-at-a-time 64-bit payload hash. Only used in memory to find duplicate
+// payloads, so the result never has to be stable across platforms.
+inline uint64_t Hash64(const uint8_t *bytes, size_t size) {
+  uint64_t hash = 0x27D4EB2F165667C5ull ^ (static_cast<uint64_t>(size) *
+                                           0x9E3779B97F4A7C15ull);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = MixWord(hash, word);
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, bytes + i, size - i);
+    hash = MixWord(hash, word);
+  }
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+}  // namespace sparse_vector_hash
+
+// Content-addressed payload storage shared by all SparseVectors of a cROMc.
+// Identical payloads (empty masks, repeated dynamic color sets, backgrounds
+// reused across planes) are stored once and referenced by offset.
+class SparsePayloadStore {
+ public:
+  uint32_t intern(const uint8_t *bytes, uint32_t size) {
+    const uint64_t payloadHash = sparse_vector_hash::Hash64(bytes, size);
+    auto &candidates = offsetsByHash[payloadHash];
+    for (const auto &candidate : candidates) {
+      if (candidate.second == size &&
+          memcmp(blob.data() + candidate.first, bytes, size) == 0) {
+        return candidate.first;
+      }
+    }
+    const uint32_t offset = static_cast<uint32_t>(blob.size());
+    blob.insert(blob.end(), bytes, bytes + size);
+    candidates.push_back({offset, size});
+    return offset;
+  }
+
+  // Drops the hash index once all vectors are interned; the blob stays.
+  void finishInterning() {
+    offsetsByHash.clear();
+    offsetsByHash.rehash(0);
+  }
+
+  void clear() {
+    blob.clear();
+    blob.shrink_to_fit();
+    finishInterning();
+  }
+
+  std::vector<uint8_t> blob;
+
+ private:
+  std::unordered_map<uint64_t, std::vector<std::pair<uint32_t, uint32_t>>>
+      offsetsByHash;
+};
+
 template <typename T>
 class SparseVector {
   static_assert(
@@ -37,7 +128,11 @@ class SparseVector {
       "SparseVector only supports trivial types like uint8_t or uint16_t");
 
  protected:
-  std::vector<std::vector<T>> index;
+  // Index-mode storage: all elements live in one contiguous array with a
+  // fixed stride, so a lookup is a plain address computation.
+  std::vector<T> indexData;
+  size_t indexStride = 0;
+  uint32_t indexCount = 0;
   std::unordered_map<uint32_t, std::vector<uint8_t>>
       data;  // Changed to uint8_t for compressed data
   std::vector<T> noData;
@@ -75,29 +170,58 @@ class SparseVector {
   std::vector<uint32_t> packedOffsets;
   std::vector<uint32_t> packedSizes;
   std::vector<uint8_t> packedBlob;
+  // When set, packedOffsets point into this shared blob instead of packedBlob.
+  const std::vector<uint8_t> *sharedBlob = nullptr;
   mutable std::unordered_map<uint32_t, uint32_t> packedIndexById;
   mutable std::vector<uint32_t> packedDenseIndexById;
   mutable bool packedIndexReady = false;
+  // Optional LZ4 dictionary shared by all compressed payloads of this vector.
+  // It is trained from the payloads themselves when packing and stays
+  // resident for decoding.
+  std::vector<uint8_t> compressionDict;
+  // Parallel to packedIds: reference element of a delta-encoded payload or
+  // UINT32_MAX for a full payload. Empty when the vector has no deltas.
+  std::vector<uint32_t> packedDeltaRefs;
+  bool useDeltaEncoding = false;
+  // Tile storage: when tilePlaneWidth is set, every payload is a map of
+  // uint32 indices into tilePool, one per kTileSize x kTileSize tile.
+  std::vector<T> tilePool;
+  uint32_t tilePlaneWidth = 0;
+  uint32_t tileEncodingWidth = 0;
 
   static constexpr uint8_t kLegacyBitPackedMagic = 0xB1;
   static constexpr uint8_t kValuePackedMagic = 0xB2;
   static constexpr uint8_t kValuePackedMode1Bit = 1;
   static constexpr uint8_t kValuePackedMode2Bit = 2;
   static constexpr uint8_t kValuePackedMode4Bit = 4;
+  static constexpr size_t kMinCompressionDictBytes = 4 * 1024;
+  static constexpr size_t kMaxCompressionDictBytes = 32 * 1024;
+  static constexpr size_t kCompressionDictSamples = 32;
+  static constexpr size_t kMinDictTrainingPayloads = 16;
+  // Chains are kept shorter than the decoded cache, so resolving a delta
+  // costs a few cached lookups and never evicts the reference it patches.
+  static constexpr uint8_t kMaxDeltaChainDepth = 4;
+  static constexpr size_t kDeltaSearchWindow = 4;
+  static constexpr uint32_t kTileSize = 8;
+  static constexpr size_t kTileValues = kTileSize * kTileSize;
 
   static bool isProfilingEnabled() {
-    static bool initialized = false;
-    static bool enabled = false;
-    if (!initialized) {
-      const char *value = std::getenv("SERUM_PROFILE_SPARSE_VECTORS");
-      enabled = value && value[0] != '\0' &&
-                (strcmp(value, "1") == 0 || strcmp(value, "true") == 0 ||
-                 strcmp(value, "TRUE") == 0 || strcmp(value, "yes") == 0 ||
-                 strcmp(value, "YES") == 0 || strcmp(value, "on") == 0 ||
-                 strcmp(value, "ON") == 0);
-      initialized = true;
-    }
-    return enabled;
+    if constexpr (!kSerumDiagnostics) {
+      return false;
+    } else {
+      static bool initialized = false;
+      static bool enabled = false;
+      if (!initialized) {
+        const char *value = std::getenv("SERUM_PROFILE_SPARSE_VECTORS");
+        enabled = value && value[0] != '\0' &&
+                  (strcmp(value, "1") == 0 || strcmp(value, "true") == 0 ||
+                   strcmp(value, "TRUE") == 0 || strcmp(value, "yes") == 0 ||
+                   strcmp(value, "YES") == 0 || strcmp(value, "on") == 0 ||
+                   strcmp(value, "ON") == 0);
+        initialized = true;
+      }
+      return enabled;
+    }
   }
 
   size_t rawByteSize() const { return elementSize * sizeof(T); }
@@ -313,6 +437,8 @@ class SparseVector {
     packedOffsets.clear();
     packedSizes.clear();
     packedBlob.clear();
+    sharedBlob = nullptr;
+    packedDeltaRefs.clear();
     packedIndexById.clear();
     packedDenseIndexById.clear();
     packedIndexReady = false;
@@ -374,19 +500,17 @@ class SparseVector {
     packedIndexReady = true;
   }
 
+  const std::vector<uint8_t> &activeBlob() const {
+    return sharedBlob ? *sharedBlob : packedBlob;
+  }
+
   static uint64_t hashPayload(const uint8_t *bytes, size_t size) {
-    uint64_t hash = 1469598103934665603ull;  // FNV-1a 64-bit offset basis
-    for (size_t i = 0; i < size; ++i) {
-      hash ^= static_cast<uint64_t>(bytes[i]);
-      hash *= 1099511628211ull;  // FNV prime
-    }
-    hash ^= static_cast<uint64_t>(size);
-    hash *= 1099511628211ull;
-    return hash;
+    return sparse_vector_hash::Hash64(bytes, size);
   }
 
   void deduplicatePackedBlob() {
-    if (packedIds.empty() || packedOffsets.size() != packedIds.size() ||
+    if (sharedBlob || packedIds.empty() ||
+        packedOffsets.size() != packedIds.size() ||
         packedSizes.size() != packedIds.size()) {
       return;
     }
@@ -443,6 +567,448 @@ class SparseVector {
     packedBlob = std::move(dedupBlob);
   }
 
+  static int compressionLevel() {
+    return is_real_machine() ? LZ4HC_CLEVEL_MIN : LZ4HC_CLEVEL_MAX;
+  }
+
+  int decompressPayload(const uint8_t *payload, uint32_t payloadSize,
+                        uint8_t *dst, size_t dstCapacity) const {
+    if (compressionDict.empty()) {
+      return LZ4_decompress_safe(reinterpret_cast<const char *>(payload),
+                                 reinterpret_cast<char *>(dst),
+                                 static_cast<int>(payloadSize),
+                                 static_cast<int>(dstCapacity));
+    }
+    return LZ4_decompress_safe_usingDict(
+        reinterpret_cast<const char *>(payload), reinterpret_cast<char *>(dst),
+        static_cast<int>(payloadSize), static_cast<int>(dstCapacity),
+        reinterpret_cast<const char *>(compressionDict.data()),
+        static_cast<int>(compressionDict.size()));
+  }
+
+  bool compressPayload(const uint8_t *src, size_t size,
+                       std::vector<uint8_t> &out) const {
+    const int maxCompressedSize = LZ4_compressBound(static_cast<int>(size));
+    out.resize(static_cast<size_t>(maxCompressedSize));
+    int compressedSize = 0;
+    if (compressionDict.empty()) {
+      compressedSize = LZ4_compress_HC(
+          reinterpret_cast<const char *>(src),
+          reinterpret_cast<char *>(out.data()), static_cast<int>(size),
+          maxCompressedSize, compressionLevel());
+    } else {
+      LZ4_streamHC_t *stream = LZ4_createStreamHC();
+      if (!stream) {
+        return false;
+      }
+      LZ4_resetStreamHC_fast(stream, compressionLevel());
+      LZ4_loadDictHC(stream,
+                     reinterpret_cast<const char *>(compressionDict.data()),
+                     static_cast<int>(compressionDict.size()));
+      compressedSize = LZ4_compress_HC_continue(
+          stream, reinterpret_cast<const char *>(src),
+          reinterpret_cast<char *>(out.data()), static_cast<int>(size),
+          maxCompressedSize);
+      LZ4_freeStreamHC(stream);
+    }
+    if (compressedSize <= 0) {
+      return false;
+    }
+    out.resize(static_cast<size_t>(compressedSize));
+    return true;
+  }
+
+  // Patch format for delta payloads (before LZ4): a list of runs, each a
+  // u32 byte offset, a u32 byte length and the replacement bytes.
+  static constexpr size_t kDeltaRunHeaderBytes = 8;
+  static constexpr size_t kDeltaRunMergeGap = 8;
+
+  static bool buildDeltaPatch(const std::vector<uint8_t> &target,
+                              const std::vector<uint8_t> &reference,
+                              std::vector<uint8_t> &patch) {
+    patch.clear();
+    const size_t size = target.size();
+    size_t pos = 0;
+    while (pos < size) {
+      if (target[pos] == reference[pos]) {
+        ++pos;
+        continue;
+      }
+      size_t end = pos + 1;
+      size_t equalRun = 0;
+      while (end < size && equalRun < kDeltaRunMergeGap) {
+        equalRun = target[end] == reference[end] ? equalRun + 1 : 0;
+        ++end;
+      }
+      end -= equalRun;
+      const uint32_t offset = static_cast<uint32_t>(pos);
+      const uint32_t length = static_cast<uint32_t>(end - pos);
+      const size_t at = patch.size();
+      patch.resize(at + kDeltaRunHeaderBytes + length);
+      memcpy(patch.data() + at, &offset, 4);
+      memcpy(patch.data() + at + 4, &length, 4);
+      memcpy(patch.data() + at + kDeltaRunHeaderBytes, target.data() + pos,
+             length);
+      if (patch.size() >= size) {
+        return false;  // Not worth a delta, and must fit the decode scratch.
+      }
+      pos = end;
+    }
+    return true;
+  }
+
+  // Replaces full payloads by a patch against one of the preceding elements
+  // when that compresses noticeably better. Consecutive animation frames
+  // usually differ in a few rows, so the patch is tiny and decoding it on
+  // top of a cached reference is a copy plus a few row writes.
+  std::unordered_map<uint32_t, uint32_t> applyDeltaEncoding(
+      const std::vector<uint32_t> &ids) {
+    std::unordered_map<uint32_t, uint32_t> refs;
+    if (!useDeltaEncoding || !useCompression || useBinaryBitPacking ||
+        !compressionDict.empty() || ids.size() < 2 ||
+        sparse_vector_serialization::ArchiveVersion() < 10) {
+      return refs;
+    }
+
+    const size_t rawBytes = rawByteSize();
+    std::vector<std::vector<uint8_t>> decoded(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      const auto &payload = data[ids[i]];
+      decoded[i].resize(rawBytes);
+      if (decompressPayload(payload.data(),
+                            static_cast<uint32_t>(payload.size()),
+                            decoded[i].data(),
+                            rawBytes) != static_cast<int>(rawBytes)) {
+        decoded[i].clear();
+      }
+    }
+
+    std::vector<uint8_t> depth(ids.size(), 0);
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> bestPatch;
+    std::vector<uint8_t> trial(
+        static_cast<size_t>(LZ4_compressBound(static_cast<int>(rawBytes))));
+    for (size_t i = 1; i < ids.size(); ++i) {
+      if (decoded[i].empty()) {
+        continue;
+      }
+      size_t bestRef = SIZE_MAX;
+      int bestSize = static_cast<int>(data[ids[i]].size() * 3 / 4);
+      const size_t first = i > kDeltaSearchWindow ? i - kDeltaSearchWindow : 0;
+      for (size_t r = first; r < i; ++r) {
+        if (decoded[r].empty() || depth[r] >= kMaxDeltaChainDepth ||
+            !buildDeltaPatch(decoded[i], decoded[r], patch)) {
+          continue;
+        }
+        const int size = LZ4_compress_default(
+            reinterpret_cast<const char *>(patch.data()),
+            reinterpret_cast<char *>(trial.data()),
+            static_cast<int>(patch.size()), static_cast<int>(trial.size()));
+        if (size > 0 && size < bestSize) {
+          bestSize = size;
+          bestRef = r;
+          bestPatch.swap(patch);
+        }
+      }
+      std::vector<uint8_t> encoded;
+      if (bestRef == SIZE_MAX ||
+          !compressPayload(bestPatch.data(), bestPatch.size(), encoded) ||
+          encoded.size() >= data[ids[i]].size()) {
+        continue;
+      }
+      data[ids[i]] = std::move(encoded);
+      refs[ids[i]] = ids[bestRef];
+      depth[i] = static_cast<uint8_t>(depth[bestRef] + 1);
+    }
+    return refs;
+  }
+
+  uint32_t deltaRefFor(uint32_t elementId) const {
+    if (packedDeltaRefs.empty()) {
+      return UINT32_MAX;
+    }
+    uint32_t packedIndex = UINT32_MAX;
+    if (elementId < packedDenseIndexById.size()) {
+      packedIndex = packedDenseIndexById[elementId];
+    } else {
+      auto it = packedIndexById.find(elementId);
+      if (it != packedIndexById.end()) packedIndex = it->second;
+    }
+    return packedIndex < packedDeltaRefs.size() ? packedDeltaRefs[packedIndex]
+                                                : UINT32_MAX;
+  }
+
+  // Splits every element into 8x8 tiles and stores each distinct tile once.
+  // Backgrounds and frames of a table share borders, logos and playfield
+  // art at tile granularity even when whole planes differ. The layout is
+  // only kept if pool plus maps are not larger than the plain payloads.
+  void applyTileEncoding(const std::vector<uint32_t> &ids) {
+    const uint32_t width = tileEncodingWidth;
+    if (width == 0 || !useCompression || useBinaryBitPacking ||
+        !compressionDict.empty() || !packedDeltaRefs.empty() ||
+        tilePlaneWidth != 0 || width % kTileSize != 0 ||
+        elementSize % width != 0 || (elementSize / width) % kTileSize != 0 ||
+        sparse_vector_serialization::ArchiveVersion() < 11) {
+      return;
+    }
+    const uint32_t height = static_cast<uint32_t>(elementSize / width);
+    const uint32_t tilesX = width / kTileSize;
+    const uint32_t tilesY = height / kTileSize;
+    const size_t rawBytes = rawByteSize();
+
+    std::vector<T> pool;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> tilesByHash;
+    std::vector<std::vector<uint8_t>> encodedMaps(ids.size());
+    std::vector<uint8_t> plane(rawBytes);
+    std::vector<uint32_t> map(static_cast<size_t>(tilesX) * tilesY);
+    T tile[kTileValues];
+    size_t plainTotal = 0;
+    size_t tiledTotal = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      const auto &payload = data[ids[i]];
+      plainTotal += payload.size();
+      if (decompressPayload(payload.data(),
+                            static_cast<uint32_t>(payload.size()),
+                            plane.data(),
+                            rawBytes) != static_cast<int>(rawBytes)) {
+        return;
+      }
+      const T *values = reinterpret_cast<const T *>(plane.data());
+      for (uint32_t ty = 0; ty < tilesY; ++ty) {
+        for (uint32_t tx = 0; tx < tilesX; ++tx) {
+          for (uint32_t row = 0; row < kTileSize; ++row) {
+            memcpy(tile + row * kTileSize,
+                   values + (ty * kTileSize + row) * width + tx * kTileSize,
+                   kTileSize * sizeof(T));
+          }
+          const uint64_t tileHash = sparse_vector_hash::Hash64(
+              reinterpret_cast<const uint8_t *>(tile), sizeof(tile));
+          auto &candidates = tilesByHash[tileHash];
+          uint32_t tileIndex = UINT32_MAX;
+          for (uint32_t candidate : candidates) {
+            if (memcmp(pool.data() + candidate * kTileValues, tile,
+                       sizeof(tile)) == 0) {
+              tileIndex = candidate;
+              break;
+            }
+          }
+          if (tileIndex == UINT32_MAX) {
+            tileIndex = static_cast<uint32_t>(pool.size() / kTileValues);
+            pool.insert(pool.end(), tile, tile + kTileValues);
+            candidates.push_back(tileIndex);
+          }
+          map[ty * tilesX + tx] = tileIndex;
+        }
+      }
+      if (!compressPayload(reinterpret_cast<const uint8_t *>(map.data()),
+                           map.size() * sizeof(uint32_t), encodedMaps[i])) {
+        return;
+      }
+      tiledTotal += encodedMaps[i].size();
+    }
+
+    if (tiledTotal + pool.size() * sizeof(T) > plainTotal) {
+      return;
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+      data[ids[i]] = std::move(encodedMaps[i]);
+    }
+    tilePool = std::move(pool);
+    tilePlaneWidth = width;
+  }
+
+  // Rebuilds a plane from its tile map, copying whole tile rows.
+  T *decodeTilesAndCache(uint32_t elementId, const uint8_t *payload,
+                         uint32_t payloadSize) {
+    const uint32_t width = tilePlaneWidth;
+    const uint32_t tilesX = width / kTileSize;
+    const uint32_t tilesY =
+        static_cast<uint32_t>(elementSize / width) / kTileSize;
+    const size_t mapBytes = static_cast<size_t>(tilesX) * tilesY * 4;
+    if (decodeScratch.size() < mapBytes) {
+      decodeScratch.resize(mapBytes);
+    }
+    if (decompressPayload(payload, payloadSize, decodeScratch.data(),
+                          mapBytes) != static_cast<int>(mapBytes)) {
+      return noData.data();
+    }
+    const size_t tileCount = tilePool.size() / kTileValues;
+    auto *entry = reserveDecodedCacheEntry(elementId);
+    T *out = entry->values.data();
+    for (uint32_t ty = 0; ty < tilesY; ++ty) {
+      for (uint32_t tx = 0; tx < tilesX; ++tx) {
+        uint32_t tileIndex;
+        memcpy(&tileIndex, decodeScratch.data() + (ty * tilesX + tx) * 4, 4);
+        if (tileIndex >= tileCount) {
+          entry->id = UINT32_MAX;
+          return noData.data();
+        }
+        const T *tile = tilePool.data() + tileIndex * kTileValues;
+        T *dst = out + ty * kTileSize * width + tx * kTileSize;
+        for (uint32_t row = 0; row < kTileSize; ++row) {
+          memcpy(dst + row * width, tile + row * kTileSize,
+                 kTileSize * sizeof(T));
+        }
+      }
+    }
+    return out;
+  }
+
+  // Decodes a delta payload on top of its (usually cached) reference.
+  T *resolveDeltaAndCache(uint32_t elementId, uint32_t refId,
+                          const uint8_t *payload, uint32_t payloadSize) {
+    const size_t rawBytes = rawByteSize();
+    const T *reference = (*this)[refId];
+    if (reference == noData.data()) {
+      return noData.data();
+    }
+    // Resolving the reference reuses decodeScratch, so the patch itself is
+    // only decompressed afterwards.
+    if (decodeScratch.size() < rawBytes) {
+      decodeScratch.resize(rawBytes);
+    }
+    const int decodedSize = decompressPayload(
+        payload, payloadSize, decodeScratch.data(), decodeScratch.size());
+    if (decodedSize < 0) {
+      return noData.data();
+    }
+    const uint8_t *patch = decodeScratch.data();
+    const size_t patchSize = static_cast<size_t>(decodedSize);
+
+    auto *entry = reserveDecodedCacheEntry(elementId);
+    if (entry->values.data() != reference) {
+      memcpy(entry->values.data(), reference, rawBytes);
+    }
+    uint8_t *out = reinterpret_cast<uint8_t *>(entry->values.data());
+    size_t pos = 0;
+    while (pos + kDeltaRunHeaderBytes <= patchSize) {
+      uint32_t offset;
+      uint32_t length;
+      memcpy(&offset, patch + pos, 4);
+      memcpy(&length, patch + pos + 4, 4);
+      pos += kDeltaRunHeaderBytes;
+      if (length > patchSize - pos || offset > rawBytes ||
+          length > rawBytes - offset) {
+        entry->id = UINT32_MAX;
+        return noData.data();
+      }
+      memcpy(out + offset, patch + pos, length);
+      pos += length;
+    }
+    return entry->values.data();
+  }
+
+  // Builds a dictionary from evenly spaced payloads and recompresses all
+  // payloads against it. Small frames share most of their content (borders,
+  // logos, fonts), which an empty LZ4 history cannot exploit. The dictionary
+  // is only kept if it pays for its own size.
+  void trainCompressionDict(const std::vector<uint32_t> &ids) {
+    if (!useCompression || !compressionDict.empty() ||
+        ids.size() < kMinDictTrainingPayloads ||
+        sparse_vector_serialization::ArchiveVersion() < 9) {
+      return;
+    }
+
+    // Identical payloads are deduplicated when packing anyway, so only
+    // unique ones are decoded, sampled and counted.
+    std::vector<size_t> uniqueOf(ids.size());
+    std::vector<size_t> uniqueIds;
+    std::unordered_map<uint64_t, std::vector<size_t>> seen;
+    for (size_t i = 0; i < ids.size(); ++i) {
+      const auto &payload = data[ids[i]];
+      auto &candidates = seen[hashPayload(payload.data(), payload.size())];
+      uniqueOf[i] = SIZE_MAX;
+      for (size_t candidate : candidates) {
+        if (data[ids[uniqueIds[candidate]]] == payload) {
+          uniqueOf[i] = candidate;
+          break;
+        }
+      }
+      if (uniqueOf[i] == SIZE_MAX) {
+        uniqueOf[i] = uniqueIds.size();
+        candidates.push_back(uniqueIds.size());
+        uniqueIds.push_back(i);
+      }
+    }
+    if (uniqueIds.size() < kMinDictTrainingPayloads) {
+      return;
+    }
+
+    const size_t maxDecodedSize = maxPackedPayloadByteSize();
+    std::vector<std::vector<uint8_t>> decoded(uniqueIds.size());
+    size_t plainCompressedTotal = 0;
+    for (size_t u = 0; u < uniqueIds.size(); ++u) {
+      const auto &payload = data[ids[uniqueIds[u]]];
+      decoded[u].resize(maxDecodedSize);
+      const int size = decompressPayload(
+          payload.data(), static_cast<uint32_t>(payload.size()),
+          decoded[u].data(), maxDecodedSize);
+      if (size <= 0) {
+        return;  // Raw legacy payloads, leave the vector untouched.
+      }
+      decoded[u].resize(static_cast<size_t>(size));
+      plainCompressedTotal += payload.size();
+    }
+
+    // Scale the dictionary with the vector so small vectors do not pay for
+    // a dictionary larger than what it saves.
+    const size_t dictBudget =
+        std::clamp<size_t>(plainCompressedTotal / 8, kMinCompressionDictBytes,
+                           kMaxCompressionDictBytes);
+    const size_t samples = std::min(decoded.size(), kCompressionDictSamples);
+    const size_t sliceBytes = dictBudget / samples;
+    std::vector<uint8_t> dict;
+    dict.reserve(dictBudget);
+    for (size_t s = 0; s < samples; ++s) {
+      // Each sample contributes a window at a different offset so that the
+      // dictionary covers the whole element layout, not only its first rows.
+      const auto &sample = decoded[s * decoded.size() / samples];
+      const size_t take = std::min(sample.size(), sliceBytes);
+      const size_t start = (s * sliceBytes) % (sample.size() - take + 1);
+      dict.insert(dict.end(), sample.begin() + start,
+                  sample.begin() + start + take);
+    }
+
+    LZ4_streamHC_t *dictStream = LZ4_createStreamHC();
+    LZ4_streamHC_t *workStream = LZ4_createStreamHC();
+    if (!dictStream || !workStream) {
+      LZ4_freeStreamHC(dictStream);
+      LZ4_freeStreamHC(workStream);
+      return;
+    }
+    LZ4_resetStreamHC_fast(dictStream, compressionLevel());
+    LZ4_loadDictHC(dictStream, reinterpret_cast<const char *>(dict.data()),
+                   static_cast<int>(dict.size()));
+
+    std::vector<std::vector<uint8_t>> recompressed(decoded.size());
+    size_t dictTotal = dict.size();
+    bool ok = true;
+    for (size_t u = 0; u < decoded.size() && ok; ++u) {
+      const int bound = LZ4_compressBound(static_cast<int>(decoded[u].size()));
+      recompressed[u].resize(static_cast<size_t>(bound));
+      LZ4_resetStreamHC_fast(workStream, compressionLevel());
+      LZ4_attach_HC_dictionary(workStream, dictStream);
+      const int size = LZ4_compress_HC_continue(
+          workStream, reinterpret_cast<const char *>(decoded[u].data()),
+          reinterpret_cast<char *>(recompressed[u].data()),
+          static_cast<int>(decoded[u].size()), bound);
+      ok = size > 0;
+      recompressed[u].resize(ok ? static_cast<size_t>(size) : 0);
+      dictTotal += recompressed[u].size();
+    }
+    LZ4_freeStreamHC(workStream);
+    LZ4_freeStreamHC(dictStream);
+
+    // Require a few percent gain so marginal cases keep the cheaper decoder.
+    if (!ok || dictTotal >= plainCompressedTotal - plainCompressedTotal / 32) {
+      return;
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+      data[ids[i]] = recompressed[uniqueOf[i]];
+    }
+    compressionDict = std::move(dict);
+  }
+
   void buildPackedFromData() {
     if (useIndex || data.empty()) {
       return;
@@ -454,6 +1020,11 @@ class SparseVector {
       ids.push_back(entry.first);
     }
     std::sort(ids.begin(), ids.end());
+    const auto deltaRefs = applyDeltaEncoding(ids);
+    if (deltaRefs.empty()) {
+      applyTileEncoding(ids);
+    }
+    trainCompressionDict(ids);
 
     clearPacked();
     packedIds.reserve(ids.size());
@@ -468,6 +1039,12 @@ class SparseVector {
       }
 
       const auto &payload = it->second;
+      if (!deltaRefs.empty()) {
+        packedDeltaRefs.resize(packedIds.size(), UINT32_MAX);
+        const auto ref = deltaRefs.find(id);
+        packedDeltaRefs.push_back(ref != deltaRefs.end() ? ref->second
+                                                         : UINT32_MAX);
+      }
       packedIds.push_back(id);
       packedOffsets.push_back(offset);
       packedSizes.push_back(static_cast<uint32_t>(payload.size()));
@@ -487,17 +1064,44 @@ class SparseVector {
       return;
     }
 
+    const std::vector<uint8_t> &blob = activeBlob();
     for (size_t i = 0; i < packedIds.size(); ++i) {
       if (i >= packedOffsets.size() || i >= packedSizes.size()) {
         continue;
       }
       const uint32_t offset = packedOffsets[i];
       const uint32_t size = packedSizes[i];
-      if (offset > packedBlob.size() || size > packedBlob.size() - offset) {
+      if (offset > blob.size() || size > blob.size() - offset) {
         continue;
       }
-      data[packedIds[i]].assign(packedBlob.begin() + offset,
-                                packedBlob.begin() + offset + size);
+      data[packedIds[i]].assign(blob.begin() + offset,
+                                blob.begin() + offset + size);
+    }
+
+    // Delta and tile payloads are meaningless without the packed reference
+    // table or the tile pool, so turn them back into full payloads first.
+    if (!packedDeltaRefs.empty() || tilePlaneWidth != 0) {
+      const bool forced = forceDecodedReads;
+      forceDecodedReads = false;
+      ensurePackedIndex();
+      std::vector<uint8_t> encoded;
+      for (size_t i = 0; i < packedIds.size(); ++i) {
+        if (tilePlaneWidth == 0 && (i >= packedDeltaRefs.size() ||
+                                    packedDeltaRefs[i] == UINT32_MAX)) {
+          continue;
+        }
+        const T *values = (*this)[packedIds[i]];
+        if (values != noData.data() &&
+            compressPayload(reinterpret_cast<const uint8_t *>(values),
+                            rawByteSize(), encoded)) {
+          data[packedIds[i]] = encoded;
+        } else {
+          data.erase(packedIds[i]);
+        }
+      }
+      forceDecodedReads = forced;
+      tilePool.clear();
+      tilePlaneWidth = 0;
     }
   }
 
@@ -527,14 +1131,58 @@ class SparseVector {
       return nullptr;
     }
 
+    const std::vector<uint8_t> &blob = activeBlob();
     const uint32_t offset = packedOffsets[idx];
     const uint32_t size = packedSizes[idx];
-    if (offset > packedBlob.size() || size > packedBlob.size() - offset) {
+    if (offset > blob.size() || size > blob.size() - offset) {
       return nullptr;
     }
 
     *payloadSize = size;
-    return packedBlob.data() + offset;
+    return blob.data() + offset;
+  }
+
+  // The flat index is written with the exact layout cereal uses for a
+  // std::vector<std::vector<T>>, so cROMc files stay compatible in both
+  // directions without building a nested copy.
+  template <class Archive>
+  void saveIndex(Archive &ar) const {
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(indexCount)));
+    for (uint32_t i = 0; i < indexCount; ++i) {
+      ar(cereal::make_size_tag(static_cast<cereal::size_type>(indexStride)));
+      ar(cereal::binary_data(indexData.data() + i * indexStride,
+                             indexStride * sizeof(T)));
+    }
+  }
+
+  template <class Archive>
+  void loadIndex(Archive &ar) {
+    cereal::size_type count = 0;
+    ar(cereal::make_size_tag(count));
+    indexData.clear();
+    indexStride = 0;
+    indexCount = static_cast<uint32_t>(count);
+    std::vector<T> odd;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+      cereal::size_type size = 0;
+      ar(cereal::make_size_tag(size));
+      if (i == 0) {
+        indexStride = static_cast<size_t>(size);
+        indexData.assign(static_cast<size_t>(indexCount) * indexStride,
+                         noData.empty() ? T{} : noData[0]);
+      }
+      T *slot = indexData.data() + i * indexStride;
+      if (size == indexStride) {
+        ar(cereal::binary_data(slot, indexStride * sizeof(T)));
+        continue;
+      }
+      // Ragged entries never come out of the converter, but keep older files
+      // loadable: truncate or pad to the stride of the first element.
+      odd.resize(static_cast<size_t>(size));
+      ar(cereal::binary_data(odd.data(), odd.size() * sizeof(T)));
+      memcpy(slot, odd.data(),
+             std::min(odd.size(), indexStride) * sizeof(T));
+    }
   }
 
  public:
@@ -569,11 +1217,11 @@ class SparseVector {
       ++profileAccessCount;
     }
     if (useIndex) {
-      if (elementId >= index.size()) return noData.data();
+      if (elementId >= indexCount) return noData.data();
       if (isProfilingEnabled()) {
         ++profileDirectHitCount;
       }
-      return index[elementId].data();
+      return indexData.data() + static_cast<size_t>(elementId) * indexStride;
     } else {
       if (forceDecodedReads) {
         auto cached = forcedDecoded.find(elementId);
@@ -651,16 +1299,24 @@ class SparseVector {
           return lastDecompressed.data();
         }
 
+        if (!packedDeltaRefs.empty()) {
+          const uint32_t refId = deltaRefFor(elementId);
+          if (refId != UINT32_MAX) {
+            return resolveDeltaAndCache(elementId, refId, payload, payloadSize);
+          }
+        }
+        if (tilePlaneWidth != 0) {
+          return decodeTilesAndCache(elementId, payload, payloadSize);
+        }
+
         const size_t rawBytes = rawByteSize();
         const size_t maxDecodedSize = maxPackedPayloadByteSize();
         if (decodeScratch.size() < maxDecodedSize) {
           decodeScratch.resize(maxDecodedSize);
         }
 
-        int decompressedSize = LZ4_decompress_safe(
-            reinterpret_cast<const char *>(payload),
-            reinterpret_cast<char *>(decodeScratch.data()),
-            static_cast<int>(payloadSize), static_cast<int>(maxDecodedSize));
+        int decompressedSize = decompressPayload(
+            payload, payloadSize, decodeScratch.data(), maxDecodedSize);
 
         if (decompressedSize < 0) {
           if (isValuePackedPayload(payload, payloadSize)) {
@@ -722,8 +1378,9 @@ class SparseVector {
 
   bool hasData(uint32_t elementId) const {
     if (useIndex)
-      return elementId < index.size() && !index[elementId].empty() &&
-             index[elementId][0] != noData[0];
+      return elementId < indexCount && indexStride > 0 &&
+             indexData[static_cast<size_t>(elementId) * indexStride] !=
+                 noData[0];
     if (!packedIds.empty()) {
       ensurePackedIndex();
       if (elementId < packedDenseIndexById.size()) {
@@ -775,20 +1432,9 @@ class SparseVector {
         }
 
         if (useCompression) {
-          const size_t maxCompressedSize =
-              LZ4_compressBound(static_cast<int>(storeByteSize));
-          std::vector<uint8_t> compBuffer(maxCompressedSize);
-          const int compressionLevel =
-              is_real_machine() ? LZ4HC_CLEVEL_MIN : LZ4HC_CLEVEL_MAX;
-          int compressedSize = LZ4_compress_HC(
-              reinterpret_cast<const char *>(storeBytes),
-              reinterpret_cast<char *>(compBuffer.data()),
-              static_cast<int>(storeByteSize),
-              static_cast<int>(maxCompressedSize), compressionLevel);
-
-          if (compressedSize > 0) {
-            data[elementId].assign(compBuffer.begin(),
-                                   compBuffer.begin() + compressedSize);
+          std::vector<uint8_t> compBuffer;
+          if (compressPayload(storeBytes, storeByteSize, compBuffer)) {
+            data[elementId] = std::move(compBuffer);
           }
         } else {
           // Without compression, store directly.
@@ -802,13 +1448,15 @@ class SparseVector {
   void readFromCRomReader(size_t elementSize, uint32_t numElements,
                           Reader &reader, SparseVector<U> *parent = nullptr) {
     if (useIndex) {
-      index.resize(numElements);
-      for (uint32_t i = 0; i < numElements; ++i) {
-        index[i].resize(elementSize);
-        if (!reader.readExact(index[i].data(), elementSize * sizeof(T))) {
-          fprintf(stderr, "File read error\n");
-          exit(1);
-        }
+      // Elements are stored back to back in the cROM, so the whole table is
+      // fetched with a single read straight into the flat storage.
+      indexStride = elementSize;
+      indexCount = numElements;
+      indexData.resize(static_cast<size_t>(numElements) * elementSize);
+      if (!indexData.empty() &&
+          !reader.readExact(indexData.data(), indexData.size() * sizeof(T))) {
+        fprintf(stderr, "File read error\n");
+        exit(1);
       }
     } else {
       std::vector<T> tmp(elementSize);
@@ -842,12 +1490,20 @@ class SparseVector {
     }
   }
 
-  void clearIndex() { index.clear(); }
+  void clearIndex() {
+    indexData.clear();
+    indexData.shrink_to_fit();
+    indexStride = 0;
+    indexCount = 0;
+  }
 
   void clear() {
-    index.clear();
+    clearIndex();
     data.clear();
     clearPacked();
+    compressionDict.clear();
+    tilePool.clear();
+    tilePlaneWidth = 0;
     noData.resize(1);
     lastPayloadId = UINT32_MAX;
     lastPayloadPtr = nullptr;
@@ -865,9 +1521,11 @@ class SparseVector {
     }
 
     if (!packedIds.empty()) {
+      const std::vector<uint8_t> &blob = activeBlob();
       std::vector<uint32_t> newIds;
       std::vector<uint32_t> newOffsets;
       std::vector<uint32_t> newSizes;
+      std::vector<uint32_t> newDeltaRefs;
       std::vector<uint8_t> newBlob;
 
       newIds.reserve(packedIds.size());
@@ -887,24 +1545,35 @@ class SparseVector {
 
         const uint32_t oldOffset = packedOffsets[i];
         const uint32_t size = packedSizes[i];
-        if (oldOffset > packedBlob.size() ||
-            size > packedBlob.size() - oldOffset) {
+        if (oldOffset > blob.size() || size > blob.size() - oldOffset) {
           continue;
         }
 
         newIds.push_back(elementId);
-        newOffsets.push_back(offset);
         newSizes.push_back(size);
-        newBlob.insert(newBlob.end(), packedBlob.begin() + oldOffset,
-                       packedBlob.begin() + oldOffset + size);
+        if (!packedDeltaRefs.empty()) {
+          newDeltaRefs.push_back(
+              i < packedDeltaRefs.size() ? packedDeltaRefs[i] : UINT32_MAX);
+        }
+        if (sharedBlob) {
+          // Shared payloads may be referenced by other vectors, keep them.
+          newOffsets.push_back(oldOffset);
+          continue;
+        }
+        newOffsets.push_back(offset);
+        newBlob.insert(newBlob.end(), blob.begin() + oldOffset,
+                       blob.begin() + oldOffset + size);
         offset += size;
       }
 
       packedIds = std::move(newIds);
       packedOffsets = std::move(newOffsets);
       packedSizes = std::move(newSizes);
-      packedBlob = std::move(newBlob);
-      deduplicatePackedBlob();
+      packedDeltaRefs = std::move(newDeltaRefs);
+      if (!sharedBlob) {
+        packedBlob = std::move(newBlob);
+        deduplicatePackedBlob();
+      }
       packedIndexById.clear();
       packedDenseIndexById.clear();
       packedIndexReady = false;
@@ -940,6 +1609,58 @@ class SparseVector {
     forcedDecoded.clear();
   }
 
+  // Lets the converter store elements as patches against earlier elements.
+  void enableDeltaEncoding() { useDeltaEncoding = true; }
+
+  // Lets the converter store planes of the given width as 8x8 tile maps.
+  void enableTileEncoding(uint32_t planeWidth) {
+    tileEncodingWidth = planeWidth;
+  }
+
+  // Moves all payloads of this vector into the shared store and references
+  // them from there. The vector must not be modified while the store lives.
+  void internPayloads(SparsePayloadStore &store) {
+    if (useIndex) {
+      return;
+    }
+    if (packedIds.empty() && !data.empty()) {
+      buildPackedFromData();
+    }
+    if (packedIds.empty() || sharedBlob == &store.blob) {
+      return;
+    }
+
+    const std::vector<uint8_t> &blob = activeBlob();
+    for (size_t i = 0; i < packedIds.size(); ++i) {
+      const uint32_t offset = packedOffsets[i];
+      const uint32_t size = packedSizes[i];
+      if (offset > blob.size() || size > blob.size() - offset) {
+        packedSizes[i] = 0;
+        continue;
+      }
+      packedOffsets[i] = store.intern(blob.data() + offset, size);
+    }
+    packedBlob.clear();
+    packedBlob.shrink_to_fit();
+    sharedBlob = &store.blob;
+    lastPayloadId = UINT32_MAX;
+    lastPayloadPtr = nullptr;
+    lastPayloadSize = 0;
+    resetDecodedCaches();
+  }
+
+  // Attaches a vector loaded without its own blob to the shared store.
+  void bindSharedPayloads(const SparsePayloadStore &store) {
+    if (useIndex || packedIds.empty() || !packedBlob.empty()) {
+      return;
+    }
+    sharedBlob = &store.blob;
+    lastPayloadId = UINT32_MAX;
+    lastPayloadPtr = nullptr;
+    lastPayloadSize = 0;
+    resetDecodedCaches();
+  }
+
   void clearForcedDecodedCache() {
     forceDecodedReads = false;
     forcedDecoded.clear();
@@ -987,30 +1708,53 @@ class SparseVector {
         buildPackedFromData();
       }
 
-      ar(index, noData, elementSize, useIndex, useCompression,
-         useBinaryBitPacking, bitPackFalseValue, bitPackTrueValue);
+      saveIndex(ar);
+      ar(noData, elementSize, useIndex, useCompression, useBinaryBitPacking,
+         bitPackFalseValue, bitPackTrueValue);
       if (!useIndex) {
         ar(packedIds, packedOffsets, packedSizes, packedBlob);
+        if (sparse_vector_serialization::ArchiveVersion() >= 9) {
+          ar(compressionDict);
+        }
+        if (sparse_vector_serialization::ArchiveVersion() >= 10) {
+          ar(packedDeltaRefs);
+        }
+        if (sparse_vector_serialization::ArchiveVersion() >= 11) {
+          ar(tilePlaneWidth, tilePool);
+        }
       }
       return;
     }
 
+    compressionDict.clear();
+    tilePool.clear();
+    tilePlaneWidth = 0;
     if (sparse_vector_serialization::IsLegacyLoadExpected()) {
-      ar(index, data, noData, elementSize, decompBuffer, useIndex,
-         useCompression);
+      loadIndex(ar);
+      ar(data, noData, elementSize, decompBuffer, useIndex, useCompression);
       clearPacked();
       if (!useIndex && !data.empty()) {
         buildPackedFromData();
         ensurePackedIndex();
       }
     } else {
-      ar(index, noData, elementSize, useIndex, useCompression,
-         useBinaryBitPacking, bitPackFalseValue, bitPackTrueValue);
+      loadIndex(ar);
+      ar(noData, elementSize, useIndex, useCompression, useBinaryBitPacking,
+         bitPackFalseValue, bitPackTrueValue);
       data.clear();
       decompBuffer.clear();
       clearPacked();
       if (!useIndex) {
         ar(packedIds, packedOffsets, packedSizes, packedBlob);
+        if (sparse_vector_serialization::ArchiveVersion() >= 9) {
+          ar(compressionDict);
+        }
+        if (sparse_vector_serialization::ArchiveVersion() >= 10) {
+          ar(packedDeltaRefs);
+        }
+        if (sparse_vector_serialization::ArchiveVersion() >= 11) {
+          ar(tilePlaneWidth, tilePool);
+        }
         // v6 cROMc files are guaranteed to have sorted packedIds from save-time
         // enforcement. Only ensure indices are built, don't repair (saves RAM
         // on resource-constrained devices).